@@ -11,6 +11,9 @@ cxx=g++ # <--- GNU C++ compiler
 flags= -Wall -Wextra -pedantic -O3 # <--- GNU compiler flags
 #flags=-Wall -O3 # <--- Intel compiler flags
 
+#uncomment to compile in scoped tracing, for sweep.exe --trace (see src/trace.h)
+#flags+= -DMSC_TRACE
+
 #compilation flag for openmp
 omp=-fopenmp
 #omp=-qopenmp
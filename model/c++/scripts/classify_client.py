@@ -0,0 +1,77 @@
+import socket
+import struct
+import subprocess
+from numpy import *
+from os.path import join
+
+#-------------------------------------------------------------------------------
+# INPUT
+
+#path to the server executable
+exe = join('..', 'bin', 'server.exe')
+#parameter names, in the order used by server.exe
+pnames = ['kb', 'tauc', 'Cw', 'U', 'a', 'L', 'n', 'P', 'E', 'R']
+#reference parameter values, in the units used by server.exe
+pref = [8e-6, 50, 6, 4.9, 1.5, 100e3, 0.05, 0.6, 1.2, 16500.0]
+
+#-------------------------------------------------------------------------------
+# FUNCTIONS
+
+class ClassifyClient:
+    """sends batches of parameter sets to server.exe and receives their classifications
+
+    The server is started as a child process talking over pipes, unless the
+    path of a Unix socket with a running server is given."""
+
+    def __init__(self, path=None, mixed=False):
+        self.tag = 0
+        if path is None:
+            cmd = [exe] + (['--mixed'] if mixed else [])
+            self.proc = subprocess.Popen(cmd, stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+            self.wfile, self.rfile = self.proc.stdin, self.proc.stdout
+        else:
+            self.proc = None
+            self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            self.sock.connect(path)
+            self.wfile = self.sock.makefile('wb')
+            self.rfile = self.sock.makefile('rb')
+
+    def classify(self, par):
+        """classifies an array of parameter sets with one row per set, returning
+        the oscillation codes and the server's latency in seconds"""
+
+        par = ascontiguousarray(atleast_2d(par), dtype='float64')
+        assert par.shape[1] == len(pnames), 'parameter sets must have %d columns' % len(pnames)
+        self.tag += 1
+        self.wfile.write(b'MSCQ' + struct.pack('=IQ', par.shape[0], self.tag) + par.tobytes())
+        self.wfile.flush()
+        head = self.rfile.read(24)
+        assert head[:4] == b'MSCR', 'invalid response from server'
+        n, tag, lat = struct.unpack('=IQd', head[4:])
+        assert tag == self.tag, 'response out of order'
+        cla = frombuffer(self.rfile.read(4*n), dtype='int32')
+        return(cla, lat)
+
+    def close(self):
+        self.wfile.close()
+        if self.proc is None:
+            self.rfile.close()
+            self.sock.close()
+        else:
+            self.proc.wait()
+            self.rfile.close()
+
+#-------------------------------------------------------------------------------
+# MAIN
+
+if __name__ == '__main__':
+
+    #classify the reference parameters over a range of uplift rates, a few at a time
+    client = ClassifyClient()
+    for U in linspace(0.5, 5, 5):
+        par = tile(pref, (4, 1))
+        par[:,pnames.index('U')] = U
+        par[:,pnames.index('kb')] = logspace(-7, -4, 4)
+        cla, lat = client.classify(par)
+        print('U = %g mm/yr: %s in %g ms' % (U, cla, 1e3*lat))
+    client.close()
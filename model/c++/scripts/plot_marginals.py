@@ -0,0 +1,96 @@
+import sys
+from numpy import *
+from os.path import join
+import matplotlib.pyplot as plt
+
+#-------------------------------------------------------------------------------
+# INPUT
+
+#output directory
+dirout = join('..', 'out')
+#marginal maps file, taken from the command line if provided
+fn = sys.argv[1] if len(sys.argv) > 1 else join(dirout, 'marginals.bin')
+#plot folder
+dirplot = join('..', '..', '..', 'plots')
+#names of the swept parameters, in the order used by sweep.exe
+pnames = ['kb', 'tauc', 'Cw', 'U', 'a', 'L']
+#proper names
+lab = dict(zip(pnames, ['$\log_{10}(k_b)$', r'$\tau_c$', '$C_w$', '$U$', '$a$', '$L$ (km)']))
+
+#-------------------------------------------------------------------------------
+# FUNCTIONS
+
+def read_marginals(fn):
+    """reads the marginal maps written by sweep.exe into a dictionary with the
+    parameter values under 'values' and, for each pair of parameter indices
+    (j,k) with j < k, a dictionary of 'count' with shape (n_j, n_k, 3) for
+    oscillation codes -1, 0, and 1, 'nrange', and 'range', the mean
+    Mediterranean level range of the oscillating trials in each cell"""
+
+    with open(fn, 'rb') as ifile:
+        assert ifile.read(8) == b'MSCMARGS', 'not a marginal maps file'
+        np = int(fromfile(ifile, dtype='int64', count=1)[0])
+        values = []
+        for j in range(np):
+            n = int(fromfile(ifile, dtype='int64', count=1)[0])
+            values.append(fromfile(ifile, dtype='float64', count=n))
+        maps = {}
+        for j in range(np):
+            for k in range(j+1, np):
+                nj, nk = len(values[j]), len(values[k])
+                count = fromfile(ifile, dtype='int64', count=nj*nk*3).reshape(nj, nk, 3)
+                nrange = fromfile(ifile, dtype='int64', count=nj*nk).reshape(nj, nk)
+                srange = fromfile(ifile, dtype='float64', count=nj*nk).reshape(nj, nk)
+                with errstate(invalid='ignore', divide='ignore'):
+                    mrange = where(nrange > 0, srange/nrange, nan)
+                maps[j,k] = dict(count=count, nrange=nrange, range=mrange)
+
+    return(dict(values=values, maps=maps))
+
+def disp(k, x):
+    if k == 'kb':
+        return( log10(x) )
+    elif k == 'L':
+        return( x/1e3 )
+    else:
+        return(x)
+
+def savefig(fig, path):
+    for fmt in ['png', 'pdf']:
+        fn = path + '.' + fmt
+        print('saving figure:', fn)
+        fig.savefig(fn, format=fmt)
+
+#-------------------------------------------------------------------------------
+# MAIN
+
+print('reading marginal maps:', fn)
+m = read_marginals(fn)
+np = len(m['values'])
+
+#fraction of oscillating trials for every pair of parameters
+fig, axs = plt.subplots(np-1, np-1, figsize=(10,10))
+for j in range(np):
+    for k in range(j+1, np):
+        ax = axs[k-1,j]
+        count = m['maps'][j,k]['count']
+        with errstate(invalid='ignore'):
+            frac = count[:,:,1]/count.sum(axis=2)
+        x = disp(pnames[j], m['values'][j])
+        y = disp(pnames[k], m['values'][k])
+        r = ax.pcolormesh(x, y, frac.T, vmin=0, cmap='viridis', shading='auto')
+        if j == 0:
+            ax.set_ylabel(lab[pnames[k]])
+        else:
+            ax.set_yticklabels([])
+        if k == np - 1:
+            ax.set_xlabel(lab[pnames[j]])
+        else:
+            ax.set_xticklabels([])
+for j in range(np-1):
+    for k in range(j+1, np-1):
+        axs[j,k].axis('off')
+fig.colorbar(r, ax=axs, label='fraction oscillating', shrink=0.5)
+savefig(fig, join(dirplot, 'marginal_oscillating'))
+
+plt.show()
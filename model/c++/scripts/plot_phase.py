@@ -0,0 +1,62 @@
+import sys
+from numpy import *
+from os.path import join
+import matplotlib.pyplot as plt
+
+sys.path.append(join('..', '..', 'python'))
+from msc_gcv import *
+
+#-------------------------------------------------------------------------------
+# INPUT
+
+#output directory
+dirout = join('..', 'out')
+#portrait file, taken from the command line if provided
+fn = sys.argv[1] if len(sys.argv) > 1 else join(dirout, 'phase_0.bin')
+
+#-------------------------------------------------------------------------------
+# FUNCTIONS
+
+def read_phase(fn):
+    """reads a grid file written by phase.exe into a dictionary"""
+
+    with open(fn, 'rb') as ifile:
+        assert ifile.read(8) == b'MSCPHASE', 'not a phase portrait file'
+        nzs, nzm = fromfile(ifile, dtype='int64', count=2)
+        zslo, zshi, zmlo, zmhi = fromfile(ifile, dtype='float64', count=4)
+        par = fromfile(ifile, dtype='float64', count=10)
+        field = lambda: fromfile(ifile, dtype='float32', count=nzs*nzm).reshape(nzm, nzs)
+        dzs, dzm, div = field(), field(), field()
+        points = lambda: fromfile(ifile, dtype='float32', count=2*fromfile(ifile, dtype='int64', count=1)[0]).reshape(-1, 2)
+        ncs, ncm = points(), points()
+
+    return(dict(
+        zs=linspace(zslo, zshi, nzs),
+        zm=linspace(zmlo, zmhi, nzm),
+        par=dict(zip(['kb', 'tauc', 'Cw', 'U', 'a', 'L', 'n', 'P', 'E', 'R'], par)),
+        dzs=dzs,
+        dzm=dzm,
+        div=div,
+        ncs=ncs,
+        ncm=ncm
+    ))
+
+#-------------------------------------------------------------------------------
+# MAIN
+
+g = read_phase(fn)
+
+fig, ax = plt.subplots(1,1)
+r = ax.pcolormesh(g['zm'], g['zs'], g['div'].T*kyrsec, cmap='RdBu_r', shading='auto')
+plt.colorbar(r, ax=ax, label='Divergence (1/kyr)')
+ax.streamplot(g['zm'], g['zs'], g['dzm'].T, g['dzs'].T, color='k', density=1.5, linewidth=0.5)
+ax.plot(g['ncs'][:,1], g['ncs'][:,0], '.', color='C1', markersize=1, label='$dz_s/dt = 0$')
+ax.plot(g['ncm'][:,1], g['ncm'][:,0], '.', color='C2', markersize=1, label='$dz_m/dt = 0$')
+ax.plot(g['zm'], fzo(g['zm']), 'k--', label='$z_o$')
+ax.set_xlabel('$z_m$ (m)')
+ax.set_ylabel('$z_s$ (m)')
+ax.set_xlim(g['zm'][0], g['zm'][-1])
+ax.set_ylim(g['zs'][0], g['zs'][-1])
+ax.legend()
+
+show()
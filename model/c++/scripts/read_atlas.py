@@ -0,0 +1,60 @@
+import sys
+import struct
+from numpy import *
+from os.path import join
+
+#-------------------------------------------------------------------------------
+# INPUT
+
+#output directory
+dirout = join('..', 'out')
+#atlas file, taken from the command line if provided
+fn = sys.argv[1] if len(sys.argv) > 1 else join(dirout, 'atlas.bin')
+
+#-------------------------------------------------------------------------------
+# FUNCTIONS
+
+def read_atlas(fn):
+    """reads an atlas written by sweep.exe or atlas.exe, returning the axis
+    names, the axis values, and the oscillation codes as an int8 array with one
+    dimension per axis, where 2 marks grid points without a classification"""
+
+    with open(fn, 'rb') as ifile:
+        buf = ifile.read()
+    assert buf[:8] == b'MSCATLAS', 'not an atlas'
+    version, ndim, ntrial, nblock, bsize = struct.unpack('=IIQQI', buf[8:36])
+    assert version == 1, 'incompatible atlas format'
+    off = 64
+    names, counts = [], []
+    for d in range(ndim):
+        names.append(buf[off:off+16].split(b'\0')[0].decode())
+        counts.append(struct.unpack('=Q', buf[off+16:off+24])[0])
+        off += 24
+    values = []
+    for n in counts:
+        values.append(frombuffer(buf, dtype='float64', count=n, offset=off))
+        off += 8*n
+    block = frombuffer(buf, dtype='uint64', count=nblock, offset=off)
+    bits = frombuffer(buf, dtype='uint8', offset=off + 8*nblock)
+    #every block expanded to codes, uniform or packed
+    uniform = (block >> uint64(63)) == 1
+    code = empty((nblock, bsize), dtype='int8')
+    code[uniform] = (block[uniform] & uint64(3)).astype('int8')[:,None]
+    idx = block[~uniform].astype('int64')[:,None] + arange(bsize//4)[None,:]
+    packed = bits[idx]
+    for s in range(4):
+        code[~uniform,s::4] = (packed >> (2*s)) & 3
+    code = code.ravel()[:ntrial] - 1
+    #the first axis varies fastest
+    return(names, values, code.reshape(counts, order='F'))
+
+#-------------------------------------------------------------------------------
+# MAIN
+
+if __name__ == '__main__':
+
+    names, values, cla = read_atlas(fn)
+    for name, v in zip(names, values):
+        print('%10s | %6g | %6g | %5d' % (name, v[0], v[-1], len(v)))
+    for c, lab in zip([-1, 0, 1], ['stable with eroding sill', 'oscillating', 'stable after cutoff and desiccation']):
+        print('  %d %s' % (sum(cla == c), lab))
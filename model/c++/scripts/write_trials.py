@@ -0,0 +1,48 @@
+import sys
+import struct
+from numpy import *
+from os.path import join
+from pandas import read_csv
+
+#-------------------------------------------------------------------------------
+# INPUT
+
+#output directory
+dirout = join('..', 'out')
+#trial table of an earlier sweep, taken from the command line if provided
+fntrials = sys.argv[1] if len(sys.argv) > 1 else join(dirout, 'trials.csv')
+#trial list to write, for sweep.exe in place of the number of values
+fnlist = sys.argv[2] if len(sys.argv) > 2 else join(dirout, 'trials.bin')
+#classifications of the trials to rerun
+rerun = [0]
+#column names allowed in a trial list, in the order used by sweep.exe
+pnames = ['kb', 'tauc', 'Cw', 'U', 'a', 'L', 'n', 'P', 'E', 'R', 'zs0', 'zm0']
+
+#-------------------------------------------------------------------------------
+# FUNCTIONS
+
+def write_trials(fn, df):
+    """writes the columns of a data frame, which must be model parameters in
+    the units of sweep.exe or the initial levels zs0 and zm0, to a trial list
+    with one trial per row"""
+
+    cols = list(df.columns)
+    for col in cols:
+        assert col in pnames, "column '%s' can't be in a trial list" % col
+    val = ascontiguousarray(df.values, dtype='float64')
+    assert all(isfinite(val)), 'trial lists must have finite values'
+    with open(fn, 'wb') as ofile:
+        ofile.write(b'MSCTRIAL' + struct.pack('=IIQ8x', 1, len(cols), val.shape[0]))
+        for col in cols:
+            ofile.write(col.encode().ljust(16, b'\0'))
+        ofile.write(val.tobytes())
+
+#-------------------------------------------------------------------------------
+# MAIN
+
+if __name__ == '__main__':
+
+    df = read_csv(fntrials)
+    df = df[df['classification'].isin(rerun)]
+    write_trials(fnlist, df.drop(['trial', 'classification'], axis=1))
+    print('%d trials written to: %s' % (len(df), fnlist))
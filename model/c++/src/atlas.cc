@@ -0,0 +1,222 @@
+//! \file atlas.cc
+
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "atlas.h"
+
+//size of the fixed part of the header [bytes]
+#define ATLAS_HEADER 64
+//size of an axis name [bytes]
+#define ATLAS_NAME 16
+//version of the binary layout
+#define ATLAS_FORMAT 1
+//flag of a uniform block in the block table
+#define ATLAS_UNIFORM (uint64_t(1) << 63)
+
+Atlas::Atlas (const char *fn) :
+    ndim_ (0),
+    ntrial_ (0),
+    nblock_ (0),
+    nuniform_ (0),
+    block_ (NULL),
+    bits_ (NULL),
+    map_ (NULL),
+    mapsize_ (0) {
+
+    int fd = open(fn, O_RDONLY);
+    struct stat st;
+    if ( (fd < 0) || (fstat(fd, &st) != 0) ) {
+        printf("FAILURE: cannot open file %s\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    if ( st.st_size < ATLAS_HEADER ) {
+        printf("FAILURE: %s is not an atlas\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    mapsize_ = st.st_size;
+    map_ = mmap(NULL, mapsize_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if ( map_ == MAP_FAILED ) {
+        printf("FAILURE: cannot map atlas %s\n", fn);
+        exit(EXIT_FAILURE);
+    }
+
+    //header
+    const unsigned char *p = (const unsigned char*)map_;
+    uint32_t version, ndim, block;
+    uint64_t ntrial, nblock;
+    memcpy(&version, p + 8, 4);
+    memcpy(&ndim, p + 12, 4);
+    memcpy(&ntrial, p + 16, 8);
+    memcpy(&nblock, p + 24, 8);
+    memcpy(&block, p + 32, 4);
+    if ( (memcmp(p, "MSCATLAS", 8) != 0) || (version != ATLAS_FORMAT) || (block != ATLAS_BLOCK) ) {
+        printf("FAILURE: %s is not an atlas or has an incompatible format\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    ndim_ = ndim;
+    ntrial_ = ntrial;
+    nblock_ = nblock;
+
+    //axes
+    size_t off = ATLAS_HEADER + (ATLAS_NAME + 8)*(size_t)ndim_;
+    bool ok = (ndim_ > 0) && (off <= mapsize_) && (nblock_ == (ntrial_ + ATLAS_BLOCK - 1)/ATLAS_BLOCK);
+    long n = 1;
+    for (int d=0; ok && (d<ndim_); d++) {
+        const unsigned char *a = p + ATLAS_HEADER + (ATLAS_NAME + 8)*d;
+        uint64_t count;
+        memcpy(&count, a + ATLAS_NAME, 8);
+        name_.push_back((const char*)a);
+        count_.push_back(count);
+        value_.push_back((const double*)(p + off));
+        n *= count;
+        off += 8*count;
+        ok = (memchr(a, 0, ATLAS_NAME) != NULL) && (count > 0) && (off <= mapsize_);
+    }
+    ok = ok && (n == ntrial_) && (off + 8*nblock_ <= mapsize_);
+    if ( !ok ) {
+        printf("FAILURE: atlas %s is corrupt\n", fn);
+        exit(EXIT_FAILURE);
+    }
+
+    //blocks, checking that the packed ones are inside the file
+    block_ = (const uint64_t*)(p + off);
+    bits_ = p + off + 8*nblock_;
+    size_t nbits = mapsize_ - off - 8*nblock_;
+    for (long b=0; b<nblock_; b++) {
+        if ( block_[b] & ATLAS_UNIFORM ) {
+            nuniform_++;
+        } else if ( block_[b] + ATLAS_BLOCK/4 > nbits ) {
+            printf("FAILURE: atlas %s is corrupt\n", fn);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    //axes spaced geometrically, like kb, are searched by logarithm
+    for (int d=0; d<ndim_; d++) {
+        const double *v = value_[d];
+        bool geo = (count_[d] > 2) && (v[0] > 0);
+        for (long k=2; geo && (k<count_[d]); k++)
+            geo = (v[k] > 0) && (fabs(log(v[k]/v[k-1]) - log(v[1]/v[0])) < 1e-6*fabs(log(v[1]/v[0])));
+        geometric_.push_back(geo);
+    }
+}
+
+Atlas::~Atlas () {
+    if ( map_ ) munmap(map_, mapsize_);
+}
+
+size_t Atlas::write (const char *fn,
+                     const std::vector< std::string > &pname,
+                     const std::vector< std::vector<double> > &pvec,
+                     const int *cla) {
+
+    uint32_t ndim = pname.size();
+    uint64_t ntrial = 1;
+    for (uint32_t d=0; d<ndim; d++) ntrial *= pvec[d].size();
+    uint64_t nblock = (ntrial + ATLAS_BLOCK - 1)/ATLAS_BLOCK;
+
+    //classify the blocks, packing the ones that aren't uniform
+    std::vector<uint64_t> block(nblock);
+    std::vector<unsigned char> bits;
+    for (uint64_t b=0; b<nblock; b++) {
+        uint64_t i0 = b*ATLAS_BLOCK,
+                 i1 = std::min(i0 + ATLAS_BLOCK, ntrial);
+        unsigned char code[ATLAS_BLOCK] = {0};
+        bool uniform = true;
+        for (uint64_t i=i0; i<i1; i++) {
+            code[i-i0] = ((cla[i] >= -1) && (cla[i] <= 1)) ? cla[i] + 1 : 3;
+            if ( code[i-i0] != code[0] ) uniform = false;
+        }
+        if ( uniform ) {
+            block[b] = ATLAS_UNIFORM | code[0];
+        } else {
+            block[b] = bits.size();
+            bits.resize(bits.size() + ATLAS_BLOCK/4, 0);
+            for (uint64_t i=i0; i<i1; i++)
+                bits[block[b] + (i-i0)/4] |= code[i-i0] << (2*(i % 4));
+        }
+    }
+
+    check_file_write(fn);
+    FILE *ofile = fopen(fn, "wb");
+    unsigned char head[ATLAS_HEADER] = {0};
+    uint32_t version = ATLAS_FORMAT, bsize = ATLAS_BLOCK;
+    memcpy(head, "MSCATLAS", 8);
+    memcpy(head + 8, &version, 4);
+    memcpy(head + 12, &ndim, 4);
+    memcpy(head + 16, &ntrial, 8);
+    memcpy(head + 24, &nblock, 8);
+    memcpy(head + 32, &bsize, 4);
+    fwrite(head, 1, ATLAS_HEADER, ofile);
+    for (uint32_t d=0; d<ndim; d++) {
+        char name[ATLAS_NAME] = {0};
+        strncpy(name, pname[d].c_str(), ATLAS_NAME - 1);
+        uint64_t count = pvec[d].size();
+        fwrite(name, 1, ATLAS_NAME, ofile);
+        fwrite(&count, 8, 1, ofile);
+    }
+    for (uint32_t d=0; d<ndim; d++) fwrite(pvec[d].data(), 8, pvec[d].size(), ofile);
+    fwrite(block.data(), 8, nblock, ofile);
+    fwrite(bits.data(), 1, bits.size(), ofile);
+    size_t size = ftell(ofile);
+    fclose(ofile);
+
+    return(size);
+}
+
+int Atlas::get_axis (const char *name) const {
+    for (int d=0; d<ndim_; d++) if ( strcmp(name_[d], name) == 0 ) return(d);
+    return(-1);
+}
+
+long Atlas::nearest (int d, double x) const {
+    const double *v = value_[d];
+    long n = count_[d];
+    //the axis values can be in either order
+    bool up = (n < 2) || (v[n-1] > v[0]);
+    long k = up ? std::lower_bound(v, v + n, x) - v
+                : std::lower_bound(v, v + n, x, [](double a, double b) { return(a > b); }) - v;
+    if ( k == 0 ) return(0);
+    if ( k == n ) return(n-1);
+    double dlo, dhi;
+    if ( geometric_[d] && (x > 0) ) {
+        dlo = fabs(log(x/v[k-1]));
+        dhi = fabs(log(v[k]/x));
+    } else {
+        dlo = fabs(x - v[k-1]);
+        dhi = fabs(v[k] - x);
+    }
+    return( (dlo <= dhi) ? k-1 : k );
+}
+
+int Atlas::nearest (const double *p, long *k) const {
+    std::vector<long> kk(ndim_);
+    for (int d=0; d<ndim_; d++) {
+        kk[d] = nearest(d, p[d]);
+        if ( k ) k[d] = kk[d];
+    }
+    return(at(kk.data()));
+}
+
+void Atlas::slice (int d1, int d2, const long *k, int *out) const {
+    //stride of every axis in the trial index
+    std::vector<long> stride(ndim_);
+    long i0 = 0, s = 1;
+    for (int d=0; d<ndim_; d++) {
+        stride[d] = s;
+        if ( (d != d1) && (d != d2) ) i0 += k[d]*s;
+        s *= count_[d];
+    }
+    long n1 = count_[d1],
+         n2 = (d2 < 0) ? 1 : count_[d2],
+         s2 = (d2 < 0) ? 0 : stride[d2];
+    for (long k2=0; k2<n2; k2++)
+        for (long k1=0; k1<n1; k1++)
+            out[k1 + n1*k2] = get(i0 + k1*stride[d1] + k2*s2);
+}
@@ -0,0 +1,122 @@
+#ifndef ATLAS_H_
+#define ATLAS_H_
+
+//! \file atlas.h
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#include "util.h"
+
+//!oscillation code returned for grid points without a classification
+#define ATLAS_NONE 2
+//!number of trials in a block of the atlas, a multiple of four
+#define ATLAS_BLOCK 1024
+
+//!compact, memory mapped store of a sweep's classifications over its grid, with constant time lookups
+/*!
+A sweep's classifications are a three valued field over its grid, with long runs of the same value, so the atlas packs them in two bits per trial, in the order of the trial index of `sweep.exe` (the first axis varying fastest), and stores the grid axes once. The trials are grouped into blocks of ATLAS_BLOCK, and a block whose trials all have the same classification is stored in the block table alone, without any packed bits. The file is, in native byte order,
++ a 64 byte header: the characters "MSCATLAS", a uint32 format version, a uint32 axis count, a uint64 trial count, a uint64 block count, a uint32 ATLAS_BLOCK, and 28 zero bytes
++ for every axis, its name in 16 bytes, padded with zero bytes, and a uint64 count of values
++ the float64 values of every axis, one axis after the other
++ a uint64 for every block, which is the byte offset of its packed bits after the table or, with the highest bit set, the code shared by all its trials in the lowest bits
++ the packed bits of the blocks that aren't uniform, four trials to a byte, lowest bits first
+
+Codes are oscillation codes plus one, and code 3 marks a trial without a classification, which is returned as ATLAS_NONE. The file is memory mapped read-only, so opening an atlas of any size costs nothing until its blocks are read, and any number of threads can query it at the same time.
+*/
+class Atlas {
+
+public:
+
+    //!maps an atlas file
+    /*!
+    \param[in] fn path to the file
+    */
+    Atlas (const char *fn);
+    //!destructs, unmapping the file
+    ~Atlas ();
+
+    //!writes an atlas file
+    /*!
+    \param[in] fn path to the file
+    \param[in] pname names of the axes
+    \param[in] pvec values of the axes
+    \param[in] cla oscillation code of every trial in the order of the trial index of `sweep.exe`, or ATLAS_NONE for trials without one
+    \return size of the file [bytes]
+    */
+    static size_t write (const char *fn,
+                         const std::vector< std::string > &pname,
+                         const std::vector< std::vector<double> > &pvec,
+                         const int *cla);
+
+    //!number of axes
+    int get_ndim () const { return(ndim_); }
+    //!number of trials
+    long get_ntrial () const { return(ntrial_); }
+    //!name of an axis
+    const char *get_name (int d) const { return(name_[d]); }
+    //!index of an axis by its name, or -1 if there isn't one
+    int get_axis (const char *name) const;
+    //!number of values of an axis
+    long get_count (int d) const { return(count_[d]); }
+    //!a value of an axis
+    double get_value (int d, long k) const { return(value_[d][k]); }
+    //!number of blocks in which all trials have the same classification
+    long get_nuniform () const { return(nuniform_); }
+
+    //!oscillation code of a trial by its index
+    int get (long i) const {
+        uint64_t b = block_[i/ATLAS_BLOCK];
+        int code = (b >> 63) ? int(b & 3) : ((bits_[b + (i % ATLAS_BLOCK)/4] >> (2*(i % 4))) & 3);
+        return( (code == 3) ? ATLAS_NONE : code - 1 );
+    }
+    //!index of a trial by the indices of its values on every axis
+    long index (const long *k) const {
+        long i = 0;
+        for (int d=ndim_-1; d>=0; d--) i = i*count_[d] + k[d];
+        return(i);
+    }
+    //!oscillation code of a trial by the indices of its values on every axis
+    int at (const long *k) const { return(get(index(k))); }
+
+    //!index of the value of an axis nearest to a number, comparing logarithms on geometrically spaced axes
+    long nearest (int d, double x) const;
+    //!oscillation code of the grid point nearest to a parameter set
+    /*!
+    \param[in] p a value for every axis
+    \param[out] k indices of the nearest grid point on every axis, if not NULL
+    \return oscillation code of the nearest grid point
+    */
+    int nearest (const double *p, long *k=NULL) const;
+
+    //!extracts a one or two dimensional slice through the grid
+    /*!
+    \param[in] d1 first axis of the slice, varying fastest in the output
+    \param[in] d2 second axis of the slice, or -1 for a one dimensional slice
+    \param[in] k indices of the values of the other axes, where the entries of the slice axes are ignored
+    \param[out] out oscillation codes, `out[k1 + n1*k2]` for index `k1` on the first axis and `k2` on the second
+    */
+    void slice (int d1, int d2, const long *k, int *out) const;
+
+private:
+
+    //axes, with names and values pointing into the map
+    int ndim_;
+    long ntrial_, nblock_, nuniform_;
+    std::vector<const char*> name_;
+    std::vector<long> count_;
+    std::vector<const double*> value_;
+    std::vector<bool> geometric_;
+    //block table and packed bits, in the map
+    const uint64_t *block_;
+    const unsigned char *bits_;
+    //memory map
+    void *map_;
+    size_t mapsize_;
+};
+
+#endif
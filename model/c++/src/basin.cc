@@ -0,0 +1,213 @@
+//! \file basin.cc
+
+#include "basin.h"
+
+//------------------------------------------------------------------------------
+//AttractorSet
+
+AttractorSet::AttractorSet (double tolzs, double tolzm) {
+    tolzs_ = tolzs;
+    tolzm_ = tolzm;
+}
+
+bool AttractorSet::near (double zs1, double zm1, double zs2, double zm2) {
+    return( (fabs(zs1 - zs2) < tolzs_) && (fabs(zm1 - zm2) < tolzm_) );
+}
+
+double AttractorSet::segdist (double zs, double zm,
+                              double zs1, double zm1,
+                              double zs2, double zm2) {
+
+    //scaled coordinates relative to the first end of the segment
+    double px = (zs - zs1)/tolzs_, py = (zm - zm1)/tolzm_;
+    double sx = (zs2 - zs1)/tolzs_, sy = (zm2 - zm1)/tolzm_;
+    //projection onto the segment, clamped to its ends
+    double s2 = sx*sx + sy*sy;
+    double f = (s2 > 0.0) ? (px*sx + py*sy)/s2 : 0.0;
+    f = min(max(f, 0.0), 1.0);
+    px -= f*sx;
+    py -= f*sy;
+    return( sqrt(px*px + py*py) );
+}
+
+bool AttractorSet::near_polyline (double zs, double zm,
+                                  const std::vector<double> &pzs,
+                                  const std::vector<double> &pzm) {
+    for (unsigned long j=1; j<pzs.size(); j++)
+        if ( segdist(zs, zm, pzs[j-1], pzm[j-1], pzs[j], pzm[j]) < 1.0 )
+            return(true);
+    return(false);
+}
+
+void AttractorSet::add_point (double zs, double zm, int osc) {
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    //only add points that aren't already stored
+    bool found = false;
+    for (unsigned long i=0; i<pzs_.size(); i++)
+        if ( near(zs, zm, pzs_[i], pzm_[i]) ) found = true;
+    if ( !found ) {
+        pzs_.push_back(zs);
+        pzm_.push_back(zm);
+        posc_.push_back(osc);
+    }
+}
+
+void AttractorSet::add_cycle (const std::vector<double> &zs,
+                              const std::vector<double> &zm) {
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    //only add cycles that aren't already stored
+    bool found = false;
+    for (unsigned long i=0; i<czs_.size(); i++)
+        if ( near_polyline(zs[0], zm[0], czs_[i], czm_[i]) )
+            found = true;
+    if ( !found ) {
+        czs_.push_back(zs);
+        czm_.push_back(zm);
+    }
+}
+
+bool AttractorSet::find (double zs, double zm, int *osc) {
+
+    bool found = false;
+    std::shared_lock<std::shared_mutex> lock(mtx_);
+    //fixed points
+    for (unsigned long i=0; (i<pzs_.size()) && !found; i++) {
+        if ( near(zs, zm, pzs_[i], pzm_[i]) ) {
+            *osc = posc_[i];
+            found = true;
+        }
+    }
+    //limit cycles
+    for (unsigned long i=0; (i<czs_.size()) && !found; i++) {
+        if ( near_polyline(zs, zm, czs_[i], czm_[i]) ) {
+            *osc = 0;
+            found = true;
+        }
+    }
+    return(found);
+}
+
+void AttractorSet::print () {
+    printf("%lu fixed point(s)\n", pzs_.size());
+    for (unsigned long i=0; i<pzs_.size(); i++)
+        printf("  zs = %g, zm = %g, code %d\n", pzs_[i], pzm_[i], posc_[i]);
+    printf("%lu limit cycle(s)\n", czs_.size());
+    for (unsigned long i=0; i<czs_.size(); i++) {
+        double zslo = INFINITY, zshi = -INFINITY, zmlo = INFINITY, zmhi = -INFINITY;
+        for (unsigned long j=0; j<czs_[i].size(); j++) {
+            zslo = min(zslo, czs_[i][j]); zshi = max(zshi, czs_[i][j]);
+            zmlo = min(zmlo, czm_[i][j]); zmhi = max(zmhi, czm_[i][j]);
+        }
+        printf("  %g < zs < %g, %g < zm < %g, %lu points\n",
+            zslo, zshi, zmlo, zmhi, czs_[i].size());
+    }
+}
+
+//------------------------------------------------------------------------------
+//MscGcvBasin
+
+bool MscGcvBasin::known_attractor (double zs, double zm, int *osc) {
+    return( (att != NULL) && att->find(zs, zm, osc) );
+}
+
+void MscGcvBasin::after_step (double t) {
+
+    MscGcv::after_step(t);
+    if ( !trace_ || closed_ ) return;
+    double zs = get_sol(0), zm = get_sol(1), zs0 = (*tzs_)[0], zm0 = (*tzm_)[0];
+    //watch for the trajectory leaving and then returning to its start, which ends a lap
+    if ( !att->near(zs, zm, zs0, zm0) ) {
+        left_ = true;
+    } else if ( left_ ) {
+        left_ = false;
+        tzs_->push_back(zs0);
+        tzm_->push_back(zm0);
+        //the cycle is settled if every state of this lap is on the previous one
+        closed_ = !lzs_.empty();
+        for (unsigned long i=0; (i<tzs_->size()) && closed_; i++)
+            closed_ = att->near_polyline((*tzs_)[i], (*tzm_)[i], lzs_, lzm_);
+        if ( !closed_ ) {
+            lzs_.swap(*tzs_);
+            lzm_.swap(*tzm_);
+            tzs_->assign(1, zs0);
+            tzm_->assign(1, zm0);
+        }
+        return;
+    }
+    tzs_->push_back(zs);
+    tzm_->push_back(zm);
+}
+
+bool MscGcvBasin::trace_cycle (double zs0, double zm0, double tint, double tlim,
+                               std::vector<double> &zs, std::vector<double> &zm) {
+
+    double tprev = get_t(), zsprev = get_sol(0), zmprev = get_sol(1);
+
+    //start the trace
+    zs.assign(1, zs0);
+    zm.assign(1, zm0);
+    tzs_ = &zs;
+    tzm_ = &zm;
+    lzs_.clear();
+    lzm_.clear();
+    trace_ = true;
+    left_ = false;
+    closed_ = false;
+    set_t(0.0);
+    set_sol(0, zs0);
+    set_sol(1, zm0);
+    //integrate until two successive laps match
+    solve_adaptive(YRSEC, YRSEC/100, false);
+    while ( !closed_ && (get_t() < tlim) )
+        solve_adaptive(tint, get_dt(), true);
+    trace_ = false;
+
+    //put things back where they were found
+    set_t(tprev);
+    set_sol(0, zsprev);
+    set_sol(1, zmprev);
+
+    return(closed_);
+}
+
+//------------------------------------------------------------------------------
+
+void basin_map (MscGcvBasin *sys, AttractorSet *att,
+                const std::vector<double> &zs,
+                const std::vector<double> &zm,
+                signed char *cla,
+                unsigned long *nearly) {
+
+    long nzs = zs.size(), nzm = zm.size();
+    unsigned long ne = 0;
+
+    #pragma omp parallel for schedule(dynamic) reduction(+:ne)
+    for (long k=0; k<nzs*nzm; k++) {
+        int n = omp_get_thread_num();
+        std::vector<double> czs, czm;
+        double tint = 25*KYRSEC, tlim = 1e8*YRSEC;
+        //initial state, which may itself sit on a known attractor
+        int osc;
+        if ( att->find(zs[k % nzs], zm[k / nzs], &osc) ) {
+            cla[k] = osc;
+            ne++;
+            continue;
+        }
+        //classify
+        sys[n].att = att;
+        osc = sys[n].has_oscillation(zs[k % nzs], zm[k / nzs], tint, tlim);
+        cla[k] = osc;
+        //record new attractors
+        double zsf = sys[n].get_zs_fin(), zmf = sys[n].get_zm_fin();
+        int a;
+        if ( att->find(zsf, zmf, &a) ) {
+            ne++;
+        } else if ( osc == -1 ) {
+            att->add_point(zsf, zmf, osc);
+        } else if ( osc == 0 ) {
+            if ( sys[n].trace_cycle(zsf, zmf, tint, 80*tint, czs, czm) )
+                att->add_cycle(czs, czm);
+        }
+    }
+    *nearly = ne;
+}
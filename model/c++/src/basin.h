@@ -0,0 +1,136 @@
+#ifndef BASIN_H_
+#define BASIN_H_
+
+//! \file basin.h
+
+#include <cmath>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <shared_mutex>
+
+#include "omp.h"
+
+#include "util.h"
+#include "msc_gcv.h"
+
+//!collection of classified attractors, shared by all threads mapping a basin
+/*!
+Fixed points are stored as single points and limit cycles as closed polylines through the integrator's steps around one period. Distances are measured after scaling each coordinate by its tolerance, so a state belongs to an attractor when its scaled distance from it is less than one. Lookups only take a shared lock, so any number of threads can check the set at once, and adding an attractor, which is rare, takes an exclusive one.
+*/
+class AttractorSet {
+
+public:
+
+    //!constructs
+    /*!
+    \param[in] tolzs sill level tolerance for belonging to an attractor [m]
+    \param[in] tolzm Mediterranean level tolerance for belonging to an attractor [m]
+    */
+    AttractorSet (double tolzs=0.1, double tolzm=1.0);
+
+    //!adds a fixed point with its oscillation code
+    void add_point (double zs, double zm, int osc);
+    //!adds a closed limit cycle, which has oscillation code 0
+    void add_cycle (const std::vector<double> &zs, const std::vector<double> &zm);
+    //!checks whether a state belongs to a stored attractor
+    /*!
+    \param[in] zs sill level
+    \param[in] zm Mediterranean level
+    \param[out] osc oscillation code of the attractor, if one is found
+    \return whether the state belongs to a stored attractor
+    */
+    bool find (double zs, double zm, int *osc);
+    //!checks whether two states are within the tolerances of each other
+    bool near (double zs1, double zm1, double zs2, double zm2);
+    //!checks whether a state is within the tolerances of a polyline
+    bool near_polyline (double zs, double zm, const std::vector<double> &pzs, const std::vector<double> &pzm);
+
+    //!number of stored fixed points
+    unsigned long get_npoint () { return(pzs_.size()); }
+    //!number of stored limit cycles
+    unsigned long get_ncycle () { return(czs_.size()); }
+    //!prints a summary of the stored attractors
+    void print ();
+
+private:
+
+    //tolerances
+    double tolzs_, tolzm_;
+    //lock shared by lookups and held alone by additions
+    std::shared_mutex mtx_;
+    //fixed points
+    std::vector<double> pzs_, pzm_;
+    std::vector<int> posc_;
+    //limit cycles
+    std::vector< std::vector<double> > czs_, czm_;
+    //scaled distance from a state to a segment
+    double segdist (double zs, double zm,
+                    double zs1, double zm1,
+                    double zs2, double zm2);
+};
+
+//!model class used for basin mapping, stopping classifications at known attractors
+class MscGcvBasin : public MscGcv {
+
+public:
+
+    //!constructs
+    MscGcvBasin () : MscGcv (), att (NULL), trace_ (false) {}
+
+    //!shared attractor collection, which must be set before classifying
+    AttractorSet *att;
+
+    //!traces one period of a limit cycle from a point on it
+    /*!
+    Each return of the trajectory to within the attractor tolerances of its start ends a lap. The cycle is accepted when every state of a lap is within the same tolerances of the previous lap, which is the resolution at which lookups tell attractors apart, so a transient loop that is still converging onto the cycle isn't stored.
+    \param[in] zs0 sill level on the cycle
+    \param[in] zm0 Mediterranean level on the cycle
+    \param[in] tint integration interval between closure checks
+    \param[in] tlim longest time to search for two matching laps
+    \param[out] zs sill levels around the cycle
+    \param[out] zm Mediterranean levels around the cycle
+    \return whether two successive laps matched within tlim
+    */
+    bool trace_cycle (double zs0, double zm0, double tint, double tlim,
+                      std::vector<double> &zs, std::vector<double> &zm);
+
+protected:
+
+    //checks the shared attractor collection
+    bool known_attractor (double zs, double zm, int *osc);
+    //records states while tracing a cycle
+    void after_step (double t);
+
+private:
+
+    //whether a cycle is being traced
+    bool trace_;
+    //whether the traced trajectory has left the neighborhood of its start
+    bool left_;
+    //whether two successive laps of the traced trajectory have matched
+    bool closed_;
+    //traced states of the current lap
+    std::vector<double> *tzs_, *tzm_;
+    //states of the previous lap
+    std::vector<double> lzs_, lzm_;
+};
+
+//!classifies a grid of initial conditions for a single set of parameters
+/*!
+Initial conditions are distributed dynamically over threads, each using its own model object from the pool. Every classified fixed point and limit cycle is added to the shared attractor set, and later trajectories stop as soon as they reach one of them.
+\param[in] sys pool of model objects, one for each thread, with identical parameters
+\param[in] att shared attractor collection
+\param[in] zs initial sill levels
+\param[in] zm initial Mediterranean levels
+\param[out] cla oscillation codes with shape (zm.size(), zs.size())
+\param[out] nearly number of classifications ending at an attractor that was already known
+*/
+void basin_map (MscGcvBasin *sys, AttractorSet *att,
+                const std::vector<double> &zs,
+                const std::vector<double> &zm,
+                signed char *cla,
+                unsigned long *nearly);
+
+#endif
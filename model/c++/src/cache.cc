@@ -0,0 +1,285 @@
+//! \file cache.cc
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+
+//size of file header and slots [bytes]
+#define CACHE_HEADER 32
+#define CACHE_SLOT 24
+//version of the file layout
+#define CACHE_FORMAT 1
+
+//------------------------------------------------------------------------------
+//keys
+
+//final mixing function of MurmurHash3
+static uint64_t fmix64 (uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return(k);
+}
+
+//hashes a word into both key words
+static void hash_word (uint64_t *h, uint64_t w) {
+    h[0] = fmix64(h[0] ^ w) + 0x9e3779b97f4a7c15ULL;
+    h[1] = fmix64(h[1] + w*0xbf58476d1ce4e5b9ULL) ^ 0x94d049bb133111ebULL;
+}
+
+//hashes the bits of a double into both key words
+static void hash_double (uint64_t *h, double x) {
+    uint64_t w;
+    if ( x == 0.0 ) x = 0.0; //negative zero
+    if ( std::isnan(x) ) x = NAN;
+    memcpy(&w, &x, sizeof(w));
+    hash_word(h, w);
+}
+
+CacheKey cache_key (MscGcv *sys, int method,
+                    double zs0, double zm0,
+                    double tint, double tlim, double rootrate) {
+
+    CacheKey key;
+    key.h[0] = 0x6d73635f67637631ULL ^ CACHE_MODEL_VERSION;
+    key.h[1] = 0x63616368655f6b31ULL ^ (uint64_t)method;
+    //parameters in SI units
+    hash_double(key.h, sys->kb);
+    hash_double(key.h, sys->tauc);
+    hash_double(key.h, sys->Cw);
+    hash_double(key.h, sys->U);
+    hash_double(key.h, sys->a);
+    hash_double(key.h, sys->L);
+    hash_double(key.h, sys->n);
+    hash_double(key.h, sys->P);
+    hash_double(key.h, sys->E);
+    hash_double(key.h, sys->R);
+    //initial condition and solver settings
+    hash_double(key.h, zs0);
+    hash_double(key.h, zm0);
+    hash_double(key.h, sys->get_tol());
+    hash_double(key.h, tint);
+    hash_double(key.h, tlim);
+    hash_double(key.h, rootrate);
+    //tabulated hypsometry
+    const Hypsometry *hyps = sys->get_hypsometry();
+    if ( hyps ) {
+        hash_double(key.h, hyps->get_dz());
+        hash_double(key.h, hyps->get_zlo());
+        hash_double(key.h, hyps->get_zhi());
+        for (unsigned long i=0; i<hyps->get_ntab(); i++) {
+            hash_double(key.h, hyps->get_ztab(i));
+            hash_double(key.h, hyps->get_atab(i));
+        }
+    }
+    //forcing table, by the hash of its whole grid
+    const Forcing *forc = sys->get_forcing();
+    if ( forc ) hash_word(key.h, forc->get_hash());
+    //laws of the right-hand side, only when they aren't the default so older keys stay valid
+    if ( sys->get_policy() != 0 ) hash_word(key.h, (uint64_t)sys->get_policy());
+    //the fast-slow reduction, which changes results within the tolerance, likewise only when it's on
+    if ( sys->get_reduced() ) hash_word(key.h, 0x736c6f77ULL);
+    //finalize, reserving the all zero key for empty slots
+    key.h[0] = fmix64(key.h[0] ^ key.h[1]);
+    key.h[1] = fmix64(key.h[1] + key.h[0]);
+    if ( (key.h[0] == 0) && (key.h[1] == 0) ) key.h[1] = 1;
+
+    return(key);
+}
+
+//------------------------------------------------------------------------------
+//slot access
+
+static void read_slot (const unsigned char *slots, uint64_t i, CacheKey *key, int32_t *osc) {
+    const unsigned char *p = slots + i*CACHE_SLOT;
+    memcpy(key->h, p, 16);
+    memcpy(osc, p + 16, 4);
+}
+
+static void write_slot (unsigned char *slots, uint64_t i, const CacheKey &key, int32_t osc) {
+    unsigned char *p = slots + i*CACHE_SLOT;
+    int32_t flags = 0;
+    memcpy(p, key.h, 16);
+    memcpy(p + 16, &osc, 4);
+    memcpy(p + 20, &flags, 4);
+}
+
+static bool is_empty (const CacheKey &key) {
+    return( (key.h[0] == 0) && (key.h[1] == 0) );
+}
+
+//places a result in a table that is known to have free slots, returning whether it was new
+static bool place (unsigned char *slots, uint64_t nslot, const CacheKey &key, int32_t osc) {
+    CacheKey k;
+    int32_t o;
+    uint64_t i = key.h[0] & (nslot - 1);
+    while ( true ) {
+        read_slot(slots, i, &k, &o);
+        if ( is_empty(k) ) {
+            write_slot(slots, i, key, osc);
+            return(true);
+        }
+        if ( (k.h[0] == key.h[0]) && (k.h[1] == key.h[1]) ) {
+            write_slot(slots, i, key, osc);
+            return(false);
+        }
+        i = (i + 1) & (nslot - 1);
+    }
+}
+
+//------------------------------------------------------------------------------
+//cache
+
+ResultCache::ResultCache (const char *fn) :
+    fn_ (fn),
+    map_ (NULL),
+    size_ (0),
+    slots_ (NULL),
+    nslot_ (0),
+    nold_ (0) {
+
+    map();
+}
+
+ResultCache::~ResultCache () {
+    unmap();
+}
+
+void ResultCache::map () {
+
+    const char *fn = fn_.c_str();
+    int fd = open(fn, O_RDONLY);
+    //a missing file is an empty cache
+    if ( fd < 0 ) return;
+    struct stat st;
+    if ( fstat(fd, &st) != 0 ) {
+        printf("\nfailed to stat cache file '%s'\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    size_ = st.st_size;
+    if ( size_ < CACHE_HEADER ) {
+        printf("\ncache file '%s' is too short\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    map_ = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if ( map_ == MAP_FAILED ) {
+        printf("\nfailed to map cache file '%s'\n", fn);
+        exit(EXIT_FAILURE);
+    }
+
+    //check the header
+    const unsigned char *p = (const unsigned char*)map_;
+    uint32_t format, version;
+    uint64_t nocc;
+    memcpy(&format, p + 8, 4);
+    memcpy(&version, p + 12, 4);
+    memcpy(&nslot_, p + 16, 8);
+    memcpy(&nocc, p + 24, 8);
+    if ( (memcmp(p, "MSCCACHE", 8) != 0) || (format != CACHE_FORMAT) ) {
+        printf("\n'%s' is not a cache file\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    if ( (nslot_ == 0) || (nslot_ & (nslot_ - 1))
+        || (size_ != CACHE_HEADER + nslot_*CACHE_SLOT) || (nocc >= nslot_) ) {
+        printf("\ncache file '%s' is corrupt\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    //results from another model version can't be used and are dropped at the next write
+    if ( version != CACHE_MODEL_VERSION ) {
+        printf("cache file '%s' is from model version %u, ignoring it\n", fn, version);
+        unmap();
+        return;
+    }
+    slots_ = p + CACHE_HEADER;
+    nold_ = nocc;
+}
+
+void ResultCache::unmap () {
+    if ( map_ != NULL ) munmap(map_, size_);
+    map_ = NULL;
+    size_ = 0;
+    slots_ = NULL;
+    nslot_ = 0;
+    nold_ = 0;
+}
+
+bool ResultCache::find (const CacheKey &key, int *osc) {
+
+    if ( slots_ == NULL ) return(false);
+    CacheKey k;
+    int32_t o;
+    uint64_t i = key.h[0] & (nslot_ - 1);
+    //the table always has empty slots, so probing ends
+    while ( true ) {
+        read_slot(slots_, i, &k, &o);
+        if ( is_empty(k) ) return(false);
+        if ( (k.h[0] == key.h[0]) && (k.h[1] == key.h[1]) ) {
+            *osc = o;
+            return(true);
+        }
+        i = (i + 1) & (nslot_ - 1);
+    }
+}
+
+void ResultCache::insert (const CacheKey &key, int osc) {
+    #pragma omp critical(result_cache)
+    {
+        newkey_.push_back(key);
+        newosc_.push_back(osc);
+    }
+}
+
+void ResultCache::write () {
+
+    //size the new table to be at most half full
+    uint64_t nmax = nold_ + newkey_.size(),
+             nslot = 64;
+    while ( nslot < 2*nmax ) nslot *= 2;
+    std::vector<unsigned char> buf(CACHE_HEADER + nslot*CACHE_SLOT, 0);
+    unsigned char *slots = buf.data() + CACHE_HEADER;
+
+    //copy the mapped results, then the new ones
+    uint64_t nocc = 0;
+    CacheKey k;
+    int32_t o;
+    for (uint64_t i=0; i<nslot_; i++) {
+        read_slot(slots_, i, &k, &o);
+        if ( !is_empty(k) && place(slots, nslot, k, o) ) nocc++;
+    }
+    for (unsigned long i=0; i<newkey_.size(); i++)
+        if ( place(slots, nslot, newkey_[i], newosc_[i]) ) nocc++;
+
+    //header
+    uint32_t format = CACHE_FORMAT,
+             version = CACHE_MODEL_VERSION;
+    memcpy(buf.data(), "MSCCACHE", 8);
+    memcpy(buf.data() + 8, &format, 4);
+    memcpy(buf.data() + 12, &version, 4);
+    memcpy(buf.data() + 16, &nslot, 8);
+    memcpy(buf.data() + 24, &nocc, 8);
+
+    //write a temporary file and rename it over the old one
+    std::string fntmp = fn_ + ".tmp";
+    check_file_write(fntmp.c_str());
+    FILE *ofile = fopen(fntmp.c_str(), "wb");
+    if ( fwrite(buf.data(), 1, buf.size(), ofile) != buf.size() ) {
+        printf("\nfailed to write cache file '%s'\n", fntmp.c_str());
+        exit(EXIT_FAILURE);
+    }
+    fclose(ofile);
+    unmap();
+    if ( rename(fntmp.c_str(), fn_.c_str()) != 0 ) {
+        printf("\nfailed to rename '%s' to '%s'\n", fntmp.c_str(), fn_.c_str());
+        exit(EXIT_FAILURE);
+    }
+    newkey_.clear();
+    newosc_.clear();
+    map();
+    printf("cache file '%s' written with %lu results\n", fn_.c_str(), (unsigned long)nocc);
+}
@@ -0,0 +1,107 @@
+#ifndef CACHE_H_
+#define CACHE_H_
+
+//! \file cache.h
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "util.h"
+#include "msc_gcv.h"
+
+//!version of the model equations and classification procedure, changed whenever cached results would no longer be reproduced
+#define CACHE_MODEL_VERSION 6
+
+//!classification methods distinguished by cache keys
+enum CacheMethod {
+    //!MscGcv::has_oscillation
+    CACHE_DOUBLE = 0,
+    //!has_oscillation_mixed
+    CACHE_MIXED = 1,
+    //!has_oscillation_fidelity
+    CACHE_FIDELITY = 2
+};
+
+//!128 bit key identifying a classification by all of its inputs
+struct CacheKey {
+    //!hash words, never both zero
+    uint64_t h[2];
+};
+
+//!computes the key of a classification
+/*!
+The key is a hash of all ten model parameters (in SI units), the tabulated hypsometry (if any), the forcing table (if any, by Forcing::get_hash), the laws of the right-hand side (if not the default ones, by MscGcv::get_policy), whether the fast-slow reduction is on (if it is, by MscGcv::get_reduced), the initial condition, the integrator tolerance from MscGcv::get_tol, the arguments of has_oscillation, the classification method, and CACHE_MODEL_VERSION. Values are hashed bit for bit, except that negative zero and NAN are first made canonical, so any parameter change, however small, produces a different key.
+\param[in] sys model object with parameters and tolerance set
+\param[in] method classification method
+\param[in] zs0 initial sill level
+\param[in] zm0 initial Mediterranean level
+\param[in] tint shorter integration interval duration
+\param[in] tlim total integration time limit
+\param[in] rootrate maximum magnitude of both time derivatives for assuming stationary state
+\return key of the classification
+*/
+CacheKey cache_key (MscGcv *sys, int method,
+                    double zs0, double zm0,
+                    double tint, double tlim, double rootrate);
+
+//!persistent, content-addressed store of classification results shared by sweep runs
+/*!
+The cache file is a 32 byte header (the characters "MSCCACHE", a uint32 format version, a uint32 CACHE_MODEL_VERSION, a uint64 slot count that is a power of two, and a uint64 count of occupied slots) followed by an open addressing hash table of 24 byte slots (two uint64 key words, an int32 oscillation code, and an int32 of flags). Empty slots have all zero keys and collisions are resolved by linear probing from the slot given by the low bits of the first key word.
+
+The file is memory mapped read only when the cache is opened, so lookups are lock free and any number of threads can call find at the same time. New results are collected in memory by insert and merged into a new table, at most half full, by write, which replaces the file atomically by renaming a temporary file. Concurrent sweeps sharing a file never corrupt it, but only the results of the last one to write are kept in addition to those it read when opened.
+*/
+class ResultCache {
+
+public:
+
+    //!opens a cache file, which doesn't need to exist yet
+    /*!
+    \param[in] fn path to the cache file
+    */
+    ResultCache (const char *fn);
+    //!destructs, unmapping the file without writing new results
+    ~ResultCache ();
+
+    //!looks up a classification result, safe to call from many threads at once
+    /*!
+    \param[in] key key of the classification
+    \param[out] osc oscillation code, if found
+    \return whether the result was found
+    */
+    bool find (const CacheKey &key, int *osc);
+    //!stores a new classification result in memory until write is called, safe to call from many threads at once
+    void insert (const CacheKey &key, int osc);
+    //!merges the new results with the mapped table, replaces the cache file, and maps the new file
+    void write ();
+
+    //!number of results in the mapped file
+    unsigned long get_nold () { return(nold_); }
+    //!number of new results waiting to be written
+    unsigned long get_nnew () { return(newkey_.size()); }
+
+private:
+
+    //path to cache file
+    std::string fn_;
+    //mapped file and its size in bytes
+    void *map_;
+    size_t size_;
+    //slot table inside the mapped file
+    const unsigned char *slots_;
+    uint64_t nslot_;
+    unsigned long nold_;
+    //new results
+    std::vector<CacheKey> newkey_;
+    std::vector<int> newosc_;
+    //maps the file, if it exists
+    void map ();
+    //unmaps the file
+    void unmap ();
+};
+
+#endif
@@ -0,0 +1,270 @@
+//! \file calibrate.cc
+
+#include "calibrate.h"
+
+const char *obs_names[NOBS] = {"t_isolation", "zm_min", "period"};
+
+int obs_index (const char *name) {
+    for (int i=0; i<NOBS; i++)
+        if ( std::string(name) == obs_names[i] )
+            return(i);
+    return(-1);
+}
+
+//number of the last maxima averaged for the period
+#define NPERIOD 4
+
+void MscGcvObserver::observe (double zs0, double zm0, double tobs, double *obs) {
+
+    set_t(0.0);
+    set_sol(0, zs0);
+    set_sol(1, zm0);
+    tp_ = 0.0;
+    zsp_ = zs0;
+    zmp_ = zm0;
+    tpp_ = 0.0;
+    zmpp_ = zm0;
+    nstep_ = 0;
+    tiso_ = NAN;
+    zmmin_ = zm0;
+    zmlast_ = NAN;
+    tmax_.clear();
+    record_ = true;
+    solve_adaptive(tobs, YRSEC, true);
+    record_ = false;
+
+    //emergence time, censored at the end of the window
+    obs[0] = (std::isnan(tiso_) ? tobs : tiso_)/KYRSEC;
+    obs[1] = zmmin_;
+    //mean interval between the last maxima
+    long nmax = tmax_.size();
+    if ( nmax < 2 ) {
+        obs[2] = tobs/KYRSEC;
+    } else {
+        long i0 = (nmax > NPERIOD) ? nmax - NPERIOD : 0;
+        obs[2] = (tmax_[nmax-1] - tmax_[i0])/(nmax - 1 - i0)/KYRSEC;
+    }
+}
+
+void MscGcvObserver::after_step (double t) {
+
+    MscGcv::after_step(t);
+    if ( !record_ ) return;
+
+    double zs = get_sol(0),
+           zm = get_sol(1),
+           zo = fzo(zm);
+    //first emergence of the sill, interpolated linearly between steps
+    if ( std::isnan(tiso_) && (zs >= zo) ) {
+        double dp = zsp_ - fzo(zmp_),
+               d = zs - zo;
+        tiso_ = (d > dp) ? tp_ + (t - tp_)*(-dp)/(d - dp) : t;
+    }
+    if ( zm < zmmin_ ) zmmin_ = zm;
+    //extrema at the previous step are placed at the vertex of the parabola through the last three steps
+    if ( nstep_ >= 2 ) {
+        double h1 = tp_ - tpp_,
+               h2 = t - tp_,
+               s1 = (zmp_ - zmpp_)/h1,
+               s2 = (zm - zmp_)/h2,
+               c = (s2 - s1)/(h1 + h2),
+               tv = (c != 0) ? (tpp_ + tp_)/2 - s1/(2*c) : tp_,
+               zv = zmpp_ + (tv - tpp_)*(s1 + c*(tv - tp_));
+        //a minimum, which might be the lowest level
+        if ( (zmp_ < zmpp_) && (zmp_ <= zm) ) {
+            zmlast_ = zv;
+            if ( zv < zmmin_ ) zmmin_ = zv;
+        }
+        //a large enough maximum
+        if ( (zmp_ > zmpp_) && (zmp_ >= zm) && (zv - zmlast_ >= ampmin) ) tmax_.push_back(tv);
+    }
+    //store the step
+    tpp_ = tp_;
+    zmpp_ = zmp_;
+    tp_ = t;
+    zsp_ = zs;
+    zmp_ = zm;
+    nstep_++;
+}
+
+//------------------------------------------------------------------------------
+
+Calibration::Calibration (MscGcv *sys) :
+    sys_ (sys),
+    zs0_ (-60.0),
+    zm0_ (0.0),
+    tobs_ (1e3*KYRSEC),
+    misfit_ (NAN),
+    nit_ (0),
+    ntraj_ (0) {
+
+    nthread_ = omp_get_max_threads();
+    obs_ = new MscGcvObserver[nthread_];
+    for (int i=0; i<nthread_; i++) {
+        obs_[i].copy_param(*sys);
+        obs_[i].set_tol(sys->get_tol());
+    }
+}
+
+Calibration::~Calibration () {
+    delete [] obs_;
+}
+
+void Calibration::add_target (int k, double value, double sigma) {
+    if ( (k < 0) || (k >= NOBS) || !(sigma > 0) ) {
+        printf("FAILURE: calibration targets need a valid observable and a positive uncertainty\n");
+        exit(EXIT_FAILURE);
+    }
+    tidx_.push_back(k);
+    tval_.push_back(value);
+    tsig_.push_back(sigma);
+}
+
+double Calibration::residuals (const double *x, double *r, int thread) {
+
+    MscGcvObserver &o = obs_[thread];
+    double obs[NOBS], misfit = 0;
+    for (unsigned long j=0; j<pidx_.size(); j++) o.set_param(pidx_[j], exp(x[j]));
+    o.observe(zs0_, zm0_, tobs_, obs);
+    for (unsigned long k=0; k<tidx_.size(); k++) {
+        r[k] = (obs[tidx_[k]] - tval_[k])/tsig_[k];
+        misfit += r[k]*r[k];
+    }
+    return(misfit);
+}
+
+double Calibration::evaluate (const double *p, double *obs) {
+
+    int np = pidx_.size();
+    double misfit = 0;
+    MscGcvObserver &o = obs_[0];
+    for (int j=0; j<np; j++) o.set_param(pidx_[j], p[j]);
+    o.observe(zs0_, zm0_, tobs_, obs);
+    for (unsigned long k=0; k<tidx_.size(); k++)
+        misfit += pow((obs[tidx_[k]] - tval_[k])/tsig_[k], 2);
+    return(misfit);
+}
+
+int Calibration::solve (double *p, int maxit, double tol, FILE *flog) {
+
+    //relative step of the finite differences, in log space
+    const double hfd = 1e-3;
+    //damping factors tried around the current one
+    const int nlam = 4;
+    const double lamfac[nlam] = {0.1, 1.0, 10.0, 100.0};
+    int np = pidx_.size(),
+        nr = tidx_.size(),
+        suc = 1;
+    if ( (np == 0) || (nr == 0) ) {
+        printf("FAILURE: calibration needs at least one free parameter and one target\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int j=0; j<np; j++) {
+        if ( !(p[j] > 0) ) {
+            printf("FAILURE: calibrated parameter %s must be positive\n", param_names[pidx_[j]]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    //current point, residuals, and Jacobian, with a row for every perturbed point
+    std::vector<double> x(np), xt(nlam*np), rt(nlam*nr), mt(nlam);
+    std::vector< std::vector<double> > rj(np + 1, std::vector<double>(nr));
+    double **A = new double*[np];
+    for (int j=0; j<np; j++) A[j] = new double[np];
+    std::vector<double> g(np);
+    for (int j=0; j<np; j++) x[j] = log(p[j]);
+
+    double lam = 1e-3, misfit = NAN;
+    ntraj_ = 0;
+    for (nit_=0; nit_<maxit; nit_++) {
+        //current residuals and perturbed residuals for the Jacobian, all at once
+        std::vector<double> mis(np + 1);
+        #pragma omp parallel for schedule(dynamic)
+        for (int j=0; j<=np; j++) {
+            std::vector<double> xj(x);
+            if ( j > 0 ) xj[j-1] += hfd;
+            mis[j] = residuals(xj.data(), rj[j].data(), omp_get_thread_num());
+        }
+        ntraj_ += np + 1;
+        misfit = mis[0];
+        if ( !std::isfinite(misfit) ) {
+            suc = 2;
+            break;
+        }
+        //the targets are matched far inside their uncertainties
+        if ( misfit < tol ) {
+            suc = 0;
+            break;
+        }
+        //normal equations
+        for (int j=0; j<np; j++) {
+            g[j] = 0;
+            for (int k=0; k<nr; k++) g[j] -= (rj[j+1][k] - rj[0][k])/hfd*rj[0][k];
+            for (int l=0; l<np; l++) {
+                A[j][l] = 0;
+                for (int k=0; k<nr; k++)
+                    A[j][l] += (rj[j+1][k] - rj[0][k])*(rj[l+1][k] - rj[0][k])/(hfd*hfd);
+            }
+        }
+        //trial steps for several damping factors, all at once
+        #pragma omp parallel for schedule(dynamic)
+        for (int m=0; m<nlam; m++) {
+            double **B = new double*[np];
+            for (int j=0; j<np; j++) {
+                B[j] = new double[np];
+                for (int l=0; l<np; l++) B[j][l] = A[j][l];
+                B[j][j] += lam*lamfac[m]*(A[j][j] > 0 ? A[j][j] : 1.0);
+            }
+            int *pm = new int[np];
+            double *d = new double[np];
+            mt[m] = INFINITY;
+            if ( crout_LU(B, np, pm) == 0 ) {
+                solve_LU(B, pm, g.data(), np, d);
+                for (int j=0; j<np; j++) xt[m*np+j] = x[j] + d[j];
+                mt[m] = residuals(xt.data() + m*np, rt.data() + m*nr, omp_get_thread_num());
+                if ( !std::isfinite(mt[m]) ) mt[m] = INFINITY;
+            }
+            for (int j=0; j<np; j++) delete [] B[j];
+            delete [] B;
+            delete [] pm;
+            delete [] d;
+        }
+        ntraj_ += nlam;
+        //take the best step, if it improves the fit
+        int best = 0;
+        for (int m=1; m<nlam; m++) if ( mt[m] < mt[best] ) best = m;
+        if ( flog ) {
+            fprintf(flog, "iteration %d: misfit %g, lambda %g", nit_, misfit, lam);
+            for (int j=0; j<np; j++) fprintf(flog, ", %s %g", param_names[pidx_[j]], exp(x[j]));
+            fprintf(flog, "\n");
+            fflush(flog);
+        }
+        if ( mt[best] < misfit ) {
+            double red = (misfit - mt[best])/misfit;
+            for (int j=0; j<np; j++) x[j] = xt[best*np+j];
+            lam *= lamfac[best];
+            misfit = mt[best];
+            if ( red < tol ) {
+                suc = 0;
+                nit_++;
+                break;
+            }
+        } else {
+            //no damping helped, so try much stronger damping next time
+            lam *= 1e3;
+            if ( lam > 1e12 ) {
+                //the current point is as good as the local model can do
+                suc = (misfit == 0) ? 0 : 2;
+                nit_++;
+                break;
+            }
+        }
+    }
+
+    for (int j=0; j<np; j++) {
+        p[j] = exp(x[j]);
+        delete [] A[j];
+    }
+    delete [] A;
+    misfit_ = misfit;
+    return(suc);
+}
@@ -0,0 +1,161 @@
+#ifndef CALIBRATE_H_
+#define CALIBRATE_H_
+
+//! \file calibrate.h
+
+#include <cmath>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+#include "omp.h"
+
+#include "util.h"
+#include "linalg.h"
+#include "msc_gcv.h"
+
+//!number of observables computed by MscGcvObserver
+#define NOBS 3
+
+//!names of the observables, in the order computed by MscGcvObserver::observe
+/*!
++ `t_isolation`, time when the sill first emerges above the ocean [kyr], or the length of the window if it never does
++ `zm_min`, lowest Mediterranean level, the depth of desiccation [m]
++ `period`, mean time between the last few maxima of the Mediterranean level rising at least MscGcvObserver::ampmin above the preceding minimum [kyr], or the length of the window if there are fewer than two, so that rounding noise around a stable fixed point isn't mistaken for a cycle
+*/
+extern const char *obs_names[NOBS];
+
+//!finds the index of an observable name in obs_names
+/*!
+\param[in] name name of an observable
+\return index of the observable or -1 if the name isn't an observable
+*/
+int obs_index (const char *name);
+
+//!model class that integrates a trajectory and measures observables that can be compared with the geological record
+class MscGcvObserver : public MscGcv {
+
+public:
+
+    //!constructs
+    MscGcvObserver () : MscGcv (), ampmin (0.1), record_ (false) {}
+
+    //!smallest rise of the Mediterranean level from a minimum to the next maximum counted for the period [m]
+    double ampmin;
+
+    //!integrates from an initial state over a window of time and computes the observables
+    /*!
+    \param[in] zs0 initial sill level
+    \param[in] zm0 initial Mediterranean level
+    \param[in] tobs length of the window
+    \param[out] obs observables, in the order of obs_names
+    */
+    void observe (double zs0, double zm0, double tobs, double *obs);
+
+protected:
+
+    //watches for sill emergence and Mediterranean level extrema
+    void after_step (double t);
+
+private:
+
+    //whether steps are being watched
+    bool record_;
+    //previous two steps
+    double tp_, zsp_, zmp_, tpp_, zmpp_;
+    //most recent minimum of the Mediterranean level
+    double zmlast_;
+    //number of steps watched
+    long nstep_;
+    //first emergence, lowest level, and times of the last few maxima
+    double tiso_, zmmin_;
+    std::vector<double> tmax_;
+};
+
+//!fits model parameters to target observables with a parallel Levenberg-Marquardt method
+/*!
+The misfit is the sum of squared residuals `(obs - target)/sigma` over the targets. The free parameters are varied in log space, so they must be positive, and the remaining parameters keep the values of the model object given to the constructor.
+
+Every iteration needs the Jacobian of the residuals, found by forward differences. The trajectories of the current parameters and of every perturbed parameter are independent, so they're integrated at the same time, one per OpenMP thread. The damped normal equations
+
+    (J^T J + lambda*diag(J^T J)) dx = -J^T r
+
+are then solved with the Crout LU routines in `linalg.h` for several damping factors `lambda` around the current one, and the trial steps are also integrated at the same time. The step with the smallest misfit is taken if it improves on the current misfit, and the damping factor moves to the one that produced it, so each iteration costs two rounds of parallel integrations no matter how the damping needs to change.
+*/
+class Calibration {
+
+public:
+
+    //!constructs
+    /*!
+    \param[in] sys model object with the parameters that aren't calibrated, its tolerance, and its hypsometry
+    */
+    Calibration (MscGcv *sys);
+    //!destructs
+    ~Calibration ();
+
+    //!sets the initial state and length of the integrations
+    void set_window (double zs0, double zm0, double tobs) { zs0_ = zs0; zm0_ = zm0; tobs_ = tobs; }
+    //!adds a free parameter
+    /*!
+    \param[in] i index of the parameter in param_names
+    */
+    void add_param (int i) { pidx_.push_back(i); }
+    //!adds a target
+    /*!
+    \param[in] k index of the observable in obs_names
+    \param[in] value target value of the observable, in the units of obs_names
+    \param[in] sigma uncertainty of the target, in the same units
+    */
+    void add_target (int k, double value, double sigma);
+
+    //!minimizes the misfit
+    /*!
+    \param[in,out] p initial and final values of the free parameters, in the units of MscGcv::set_param
+    \param[in] maxit largest number of iterations
+    \param[in] tol relative misfit reduction, or misfit, below which the fit has converged
+    \param[in] flog file for a line of progress per iteration, or NULL
+    \return zero if converged, one if the iteration limit was reached, or two if no step could reduce the misfit
+    */
+    int solve (double *p, int maxit=50, double tol=1e-6, FILE *flog=NULL);
+
+    //!computes the observables and misfit for values of the free parameters
+    /*!
+    \param[in] p values of the free parameters
+    \param[out] obs observables, in the order of obs_names
+    \return misfit
+    */
+    double evaluate (const double *p, double *obs);
+
+    //!gets the misfit at the end of the last solve
+    double get_misfit () { return(misfit_); }
+    //!gets the number of iterations in the last solve
+    int get_nit () { return(nit_); }
+    //!gets the number of trajectories integrated in the last solve
+    long get_ntraj () { return(ntraj_); }
+    //!gets the number of free parameters
+    int get_np () { return((int)pidx_.size()); }
+    //!gets the index in param_names of a free parameter
+    int get_pidx (int j) { return(pidx_[j]); }
+
+private:
+
+    //model object with the fixed parameters
+    MscGcv *sys_;
+    //one observer per thread
+    int nthread_;
+    MscGcvObserver *obs_;
+    //window
+    double zs0_, zm0_, tobs_;
+    //free parameters and targets
+    std::vector<int> pidx_, tidx_;
+    std::vector<double> tval_, tsig_;
+    //results
+    double misfit_;
+    int nit_;
+    long ntraj_;
+    //computes the residuals for log parameter values on one thread, returning the misfit
+    double residuals (const double *x, double *r, int thread);
+};
+
+#endif
@@ -0,0 +1,158 @@
+//! \file cycle.cc
+
+#include "cycle.h"
+
+//------------------------------------------------------------------------------
+//MscGcvSection
+
+void MscGcvSection::after_step (double t) {
+
+    MscGcv::after_step(t);
+    if ( !record_ || crossed_ ) return;
+    double zs = get_sol(0), zm = get_sol(1);
+    //upward crossing of the section
+    if ( (zmp_ < zsec) && (zm >= zsec) ) {
+        crossed_ = true;
+        ta_ = tp_; zsa_ = zsp_; zma_ = zmp_;
+        tb_ = t; zmb_ = zm;
+        return;
+    }
+    //extremes between crossings
+    zslo_ = min(zslo_, zs); zshi_ = max(zshi_, zs);
+    zmlo_ = min(zmlo_, zm); zmhi_ = max(zmhi_, zm);
+    //store the state for the next step
+    tp_ = t; zsp_ = zs; zmp_ = zm;
+}
+
+bool MscGcvSection::next_crossing (double zs, double zm, double tmax,
+                                   double *zs1, double *T) {
+
+    double tprev = get_t(), zsprev = get_sol(0), zmprev = get_sol(1);
+    double tint, tau, f[3];
+
+    //initial state
+    set_t(0.0);
+    set_sol(0, zs);
+    set_sol(1, zm);
+    tp_ = 0.0; zsp_ = zs; zmp_ = zm;
+    zslo_ = zshi_ = zs;
+    zmlo_ = zmhi_ = zm;
+    record_ = true;
+    crossed_ = false;
+    //integrate over growing intervals until the section is crossed
+    tint = 100*YRSEC;
+    solve_adaptive(YRSEC, YRSEC/100, true);
+    while ( !crossed_ && (get_t() < tmax) ) {
+        solve_adaptive(tint, get_dt(), true);
+        tint *= 2;
+    }
+    record_ = false;
+    if ( crossed_ ) {
+        //refine the crossing time with Newton's method, always integrating from
+        //the start of the step that contains the crossing
+        tau = (tb_ - ta_)*(zsec - zma_)/(zmb_ - zma_);
+        for (int i=0; i<20; i++) {
+            set_t(ta_);
+            set_sol(0, zsa_);
+            set_sol(1, zma_);
+            if ( tau > 0 ) solve_adaptive(tau, tau, false);
+            ode_fun(get_sol(), f);
+            if ( fabs(get_sol(1) - zsec) < 1e-10*(1 + fabs(zsec)) ) break;
+            tau += (zsec - get_sol(1))/f[1];
+            tau = min(max(tau, 0.0), tb_ - ta_);
+        }
+        *zs1 = get_sol(0);
+        *T = get_t();
+    }
+
+    //put things back where they were found
+    set_t(tprev);
+    set_sol(0, zsprev);
+    set_sol(1, zmprev);
+
+    return(crossed_);
+}
+
+//------------------------------------------------------------------------------
+//CycleSolver
+
+CycleSolver::CycleSolver (MscGcvSection *sys, double tmax, double ampmin) : Newton (1) {
+    sys_ = sys;
+    tmax_ = tmax;
+    ampmin_ = ampmin;
+    period_ = NAN;
+    zs_ = NAN;
+    mult_ = NAN;
+    nmap_ = 0;
+    //tolerance on the crossing sill level [m]
+    set_tol_Newton(1e-6);
+    //finite difference step, well above the integration error
+    set_absjacdel(1e-4);
+    set_reljacdel(1e-5);
+}
+
+void CycleSolver::f_Newton (double *x, double *f) {
+
+    double zs1, T;
+    nmap_++;
+    if ( sys_->return_map(x[0], tmax_, &zs1, &T) ) {
+        f[0] = zs1 - x[0];
+        period_ = T;
+    } else {
+        f[0] = NAN;
+    }
+}
+
+int CycleSolver::solve (double zs0, double zm0) {
+
+    double x[1], zs1, T;
+
+    nmap_ = 0;
+    //put the section through the guess and move onto the upward branch
+    sys_->zsec = zm0;
+    nmap_ += 2;
+    if ( !sys_->return_map(zs0, tmax_, &zs1, &T) ) return(-1);
+    //one more loop to find the range of Mediterranean levels
+    if ( !sys_->return_map(zs1, tmax_, &zs1, &T) ) return(-1);
+    //move to a section through the middle of the range
+    sys_->zsec = (sys_->get_zmlo() + sys_->get_zmhi())/2;
+    nmap_++;
+    if ( !sys_->next_crossing(zs1, zm0, tmax_, &zs1, &T) ) return(-1);
+    //iterate on the crossing
+    x[0] = zs1;
+    return(iterate(x));
+}
+
+int CycleSolver::resolve () {
+
+    double x[1] = {zs_};
+
+    nmap_ = 0;
+    return(iterate(x));
+}
+
+int CycleSolver::iterate (double *x) {
+
+    double J[1], *Jp[1];
+    int suc;
+
+    period_ = NAN;
+    zs_ = NAN;
+    mult_ = NAN;
+    suc = solve_Newton(x);
+    if ( suc != 0 ) return(suc);
+    zs_ = x[0];
+    //derivative of the return map, which also leaves the period and extremes
+    //of the converged cycle in place
+    Jp[0] = J;
+    J_Newton(x, Jp);
+    mult_ = J[0] + 1.0;
+    f_Newton(x, J);
+    //reject orbits that aren't really cycles
+    if ( sys_->get_zmhi() - sys_->get_zmlo() < ampmin_ ) {
+        zs_ = NAN;
+        return(-2);
+    }
+
+    return(0);
+}
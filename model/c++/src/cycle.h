@@ -0,0 +1,131 @@
+#ifndef CYCLE_H_
+#define CYCLE_H_
+
+//! \file cycle.h
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "util.h"
+#include "newton.h"
+#include "msc_gcv.h"
+
+//!model class that integrates between crossings of a Poincaré section
+/*!
+The section is the line `zm = zsec`, crossed with increasing Mediterranean level. The return map takes a sill level on the section to the sill level at the next crossing.
+*/
+class MscGcvSection : public MscGcv {
+
+public:
+
+    //!constructs, with the clock of the forcing if `clock`
+    MscGcvSection (bool clock=false) : MscGcv (clock), zsec (0.0), record_ (false) {}
+
+    //!Mediterranean level of the section [m]
+    double zsec;
+
+    //!integrates from any state to the next crossing of the section
+    /*!
+    Integration intervals start at one century and double until a crossing is found, so no guess of the period is needed. The crossing is refined by reintegrating from the start of the step containing it.
+    \param[in] zs initial sill level
+    \param[in] zm initial Mediterranean level
+    \param[in] tmax longest time to search for
+    \param[out] zs1 sill level at the next crossing
+    \param[out] T time to the crossing
+    \return whether a crossing was found
+    */
+    bool next_crossing (double zs, double zm, double tmax, double *zs1, double *T);
+
+    //!evaluates the return map, integrating from a sill level on the section to the next crossing
+    bool return_map (double zs, double tmax, double *zs1, double *T) {
+        return( next_crossing(zs, zsec, tmax, zs1, T) );
+    }
+
+    //!lowest sill level before the crossing in the last call to next_crossing
+    double get_zslo () { return(zslo_); }
+    //!highest sill level before the crossing in the last call to next_crossing
+    double get_zshi () { return(zshi_); }
+    //!lowest Mediterranean level before the crossing in the last call to next_crossing
+    double get_zmlo () { return(zmlo_); }
+    //!highest Mediterranean level before the crossing in the last call to next_crossing
+    double get_zmhi () { return(zmhi_); }
+
+protected:
+
+    //watches for crossings and tracks extremes
+    void after_step (double t);
+
+private:
+
+    //whether steps are being watched
+    bool record_;
+    //whether a crossing has been found
+    bool crossed_;
+    //state at the end of the previous step
+    double tp_, zsp_, zmp_;
+    //states at the ends of the step containing the crossing
+    double ta_, zsa_, zma_, tb_, zmb_;
+    //extremes
+    double zslo_, zshi_, zmlo_, zmhi_;
+};
+
+//!finds periodic orbits by shooting, as fixed points of the return map of MscGcvSection
+/*!
+The single unknown is the sill level where the cycle crosses the section and the equation zeroed is `P(zs) - zs`, where `P` is the return map. The Jacobian is found by finite differences, so the model's integration tolerance should be tight relative to the Newton tolerance. After convergence, the derivative of the return map is the nontrivial Floquet multiplier of the cycle, which is less than one in magnitude for a stable cycle.
+*/
+class CycleSolver : public Newton {
+
+public:
+
+    //!constructs
+    /*!
+    \param[in] sys model object with parameters set, used for all integrations
+    \param[in] tmax longest period to search for
+    \param[in] ampmin smallest range of Mediterranean levels for a valid cycle [m]
+    */
+    CycleSolver (MscGcvSection *sys, double tmax=1e7*YRSEC, double ampmin=1e-3);
+
+    //!finds the limit cycle passing near a point
+    /*!
+    The section is first placed at the Mediterranean level of the point and one loop around the cycle is integrated to find its range of Mediterranean levels. The section is then moved to the middle of that range, where it crosses the cycle transversally and still crosses nearby cycles after small parameter changes, before iterating.
+    \param[in] zs0 sill level near the cycle
+    \param[in] zm0 Mediterranean level near the cycle
+    \return success code of solve_Newton, -1 if the trajectory never returned to the section, or -2 if the converged orbit is degenerate (a point or a single step, which happens near fixed points sitting on the section)
+    */
+    int solve (double zs0, double zm0);
+
+    //!continues a converged cycle after the model's parameters have changed, using the previous crossing and section as the guess
+    int resolve ();
+
+    //!gets the period of the cycle
+    double get_period () { return(period_); }
+    //!gets the sill level where the cycle crosses the section
+    double get_zs () { return(zs_); }
+    //!gets the nontrivial Floquet multiplier of the cycle
+    double get_multiplier () { return(mult_); }
+    //!gets the number of return map evaluations in the last solve
+    unsigned long get_nmap () { return(nmap_); }
+
+protected:
+
+    //return map residual
+    void f_Newton (double *x, double *f);
+    //Newton iteration on the current section and post-processing
+    int iterate (double *x);
+
+private:
+
+    //model object
+    MscGcvSection *sys_;
+    //longest period
+    double tmax_;
+    //smallest amplitude
+    double ampmin_;
+    //results
+    double period_, zs_, mult_;
+    //return map evaluation counter
+    unsigned long nmap_;
+};
+
+#endif
@@ -0,0 +1,246 @@
+//! \file ensemble.cc
+
+#include "ensemble.h"
+
+const char *metric_names[NMETRIC] = {"range", "zm_min", "period", "t_isolation", "zm_fixed"};
+
+const char *dist_names[NDIST] = {"uniform", "loguniform", "normal", "lognormal"};
+
+int dist_index (const char *name) {
+    for (int k=0; k<NDIST; k++)
+        if ( std::string(name) == dist_names[k] )
+            return(k);
+    return(-1);
+}
+
+//------------------------------------------------------------------------------
+
+//finalizer of MurmurHash3, spreading the bits of the seed and index
+static uint64_t mix64 (uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return(k);
+}
+
+EnsembleRng::EnsembleRng (uint64_t seed, uint64_t stream) :
+    s_ (mix64(seed ^ mix64(stream + 0x9e3779b97f4a7c15ULL))) {}
+
+uint64_t EnsembleRng::next () {
+    uint64_t z = (s_ += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+    return( z ^ (z >> 31) );
+}
+
+double EnsembleRng::uniform () {
+    //53 random bits, offset by half an ulp so neither end is reached
+    return( (double(next() >> 11) + 0.5)*(1.0/9007199254740992.0) );
+}
+
+double EnsembleRng::normal () {
+    double u = uniform(), v = uniform();
+    return( sqrt(-2*log(u))*cos(2*PI*v) );
+}
+
+double ParamDist::draw (EnsembleRng &rng) const {
+    for (int k=0; k<10000; k++) {
+        double x;
+        switch (kind) {
+            case 0: x = a + (b - a)*rng.uniform(); break;
+            case 1: x = exp(log(a) + (log(b) - log(a))*rng.uniform()); break;
+            case 2: x = a + b*rng.normal(); break;
+            case 3: x = a*exp(b*rng.normal()); break;
+            default:
+                printf("FAILURE: distribution code %d out of range\n", kind);
+                exit(EXIT_FAILURE);
+        }
+        if ( (x >= lo) && (x <= hi) ) return(x);
+    }
+    printf("FAILURE: the bounds of %s exclude nearly all of its %s distribution\n", param_names[i], dist_names[kind]);
+    exit(EXIT_FAILURE);
+}
+
+//------------------------------------------------------------------------------
+
+void EnsembleStats::clear () {
+    for (int c=0; c<3; c++) count_[c] = 0;
+    for (int k=0; k<NMETRIC; k++) {
+        stats_[k].clear();
+        sketch_[k].clear();
+    }
+}
+
+void EnsembleStats::add (int osc, const double *metric) {
+    count_[osc+1]++;
+    for (int k=0; k<NMETRIC; k++) {
+        if ( std::isnan(metric[k]) ) continue;
+        stats_[k].add(metric[k]);
+        sketch_[k].add(metric[k]);
+    }
+}
+
+void EnsembleStats::merge (const EnsembleStats &o) {
+    for (int c=0; c<3; c++) count_[c] += o.count_[c];
+    for (int k=0; k<NMETRIC; k++) {
+        stats_[k].merge(o.stats_[k]);
+        sketch_[k].merge(o.sketch_[k]);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+Ensemble::Ensemble (MscGcv *sys) :
+    sys_ (sys),
+    nthread_ (omp_get_max_threads()),
+    seed_ (1),
+    zs0_ (-60.0),
+    zm0_ (0.0),
+    period_ (false),
+    part_ (nthread_) {
+
+    set_stop(0.02, 0.95, 100, 100000, 256);
+    mod_ = new MscGcv[nthread_];
+    sec_ = new MscGcvSection[nthread_];
+    for (int t=0; t<nthread_; t++) {
+        mod_[t].copy_param(*sys);
+        mod_[t].set_tol(sys->get_tol());
+        mod_[t].set_reduced(sys->get_reduced());
+        //shooting needs a tight tolerance, as in main_single.cc
+        sec_[t].set_tol(1e-10);
+    }
+}
+
+Ensemble::~Ensemble () {
+    delete [] mod_;
+    delete [] sec_;
+}
+
+void Ensemble::set_stop (double halfwidth, double conf, int64_t nmin, int64_t nmax, int64_t nbatch, double relerr) {
+    if ( !(halfwidth > 0) || (nmin < 1) || (nmax < nmin) || (nbatch < 1) || (relerr < 0) ) {
+        printf("FAILURE: invalid ensemble stopping criteria\n");
+        exit(EXIT_FAILURE);
+    }
+    halfwidth_ = halfwidth;
+    z_ = normal_quantile(conf);
+    nmin_ = nmin;
+    nmax_ = nmax;
+    nbatch_ = nbatch;
+    relerr_ = relerr;
+}
+
+void Ensemble::draw (int64_t i, MscGcv *sys) {
+    EnsembleRng rng(seed_, (uint64_t)i);
+    for (unsigned long j=0; j<dist_.size(); j++) sys->set_param(dist_[j].i, dist_[j].draw(rng));
+}
+
+int Ensemble::classify (int64_t i, int thread, double *metric) {
+
+    MscGcv *sys = mod_ + thread;
+    draw(i, sys);
+    //same arguments as sweep.exe
+    int osc = sys->has_oscillation(zs0_, zm0_, 25*KYRSEC, 1e8*YRSEC, 1e-3/MMYR);
+    for (int k=0; k<NMETRIC; k++) metric[k] = NAN;
+    switch (osc) {
+        case 0:
+            metric[0] = sys->get_zm_max() - sys->get_zm_min();
+            metric[1] = sys->get_zm_min();
+            if ( period_ ) {
+                MscGcvSection *sec = sec_ + thread;
+                sec->copy_param(*sys);
+                CycleSolver cyc(sec);
+                if ( cyc.solve(sys->get_zs_fin(), sys->get_zm_fin()) == 0 )
+                    metric[2] = cyc.get_period()/KYRSEC;
+            }
+            break;
+        case 1:
+            metric[3] = sys->get_t_fin()/KYRSEC;
+            break;
+        case -1:
+            metric[4] = sys->get_zm_fin();
+            break;
+    }
+    return(osc);
+}
+
+bool Ensemble::converged () {
+    int64_t n = tot_.get_n();
+    if ( n < nmin_ ) return(false);
+    double lo, hi;
+    for (int osc=-1; osc<=1; osc++) {
+        wilson_interval(tot_.get_count(osc), n, z_, &lo, &hi);
+        if ( (hi - lo)/2 > halfwidth_ ) return(false);
+    }
+    if ( relerr_ > 0 ) {
+        for (int k=0; k<NMETRIC; k++) {
+            const RunningStats &s = tot_.get_stats(k);
+            if ( s.get_n() < 2 ) continue;
+            if ( !(z_*s.get_sem() <= relerr_*fabs(s.get_mean())) ) return(false);
+        }
+    }
+    return(true);
+}
+
+int Ensemble::run (FILE *flog) {
+
+    double tstart = omp_get_wtime();
+    while ( tot_.get_n() < nmax_ ) {
+        int64_t i0 = tot_.get_n(),
+                i1 = std::min(i0 + nbatch_, nmax_);
+        #pragma omp parallel for schedule(dynamic)
+        for (int64_t i=i0; i<i1; i++) {
+            int thread = omp_get_thread_num();
+            double metric[NMETRIC];
+            int osc = classify(i, thread, metric);
+            part_[thread].add(osc, metric);
+        }
+        for (int t=0; t<nthread_; t++) {
+            tot_.merge(part_[t]);
+            part_[t].clear();
+        }
+        if ( flog ) {
+            int64_t n = tot_.get_n();
+            double lo, hi;
+            fprintf(flog, "  %8ld samples", (long)n);
+            for (int osc=-1; osc<=1; osc++) {
+                wilson_interval(tot_.get_count(osc), n, z_, &lo, &hi);
+                fprintf(flog, "  P(%2d) = %.4f [%.4f, %.4f]", osc, double(tot_.get_count(osc))/n, lo, hi);
+            }
+            fprintf(flog, "  %g s\n", omp_get_wtime() - tstart);
+            fflush(flog);
+        }
+        if ( converged() ) return(0);
+    }
+    return(1);
+}
+
+void Ensemble::write (const char *fnclass, const char *fnmetric) {
+
+    int64_t n = tot_.get_n();
+    double lo, hi;
+    check_file_write(fnclass);
+    FILE *ofile = fopen(fnclass, "w");
+    fprintf(ofile, "classification,count,probability,lo,hi\n");
+    for (int osc=-1; osc<=1; osc++) {
+        wilson_interval(tot_.get_count(osc), n, z_, &lo, &hi);
+        fprintf(ofile, "%d,%ld,%.10g,%.10g,%.10g\n", osc, (long)tot_.get_count(osc),
+            (n > 0) ? double(tot_.get_count(osc))/n : NAN, lo, hi);
+    }
+    fclose(ofile);
+
+    const double q[5] = {0.05, 0.25, 0.5, 0.75, 0.95};
+    check_file_write(fnmetric);
+    ofile = fopen(fnmetric, "w");
+    fprintf(ofile, "metric,count,mean,sd,sem,min,q05,q25,q50,q75,q95,max\n");
+    for (int k=0; k<NMETRIC; k++) {
+        const RunningStats &s = tot_.get_stats(k);
+        const QuantileSketch &sk = tot_.get_sketch(k);
+        fprintf(ofile, "%s,%ld,%.10g,%.10g,%.10g,%.10g", metric_names[k], (long)s.get_n(),
+            s.get_mean(), sqrt(s.get_var()), s.get_sem(), s.get_min());
+        for (int j=0; j<5; j++) fprintf(ofile, ",%.10g", sk.quantile(q[j]));
+        fprintf(ofile, ",%.10g\n", s.get_max());
+    }
+    fclose(ofile);
+}
@@ -0,0 +1,216 @@
+#ifndef ENSEMBLE_H_
+#define ENSEMBLE_H_
+
+//! \file ensemble.h
+
+#include <cmath>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#include "omp.h"
+
+#include "util.h"
+#include "stats.h"
+#include "msc_gcv.h"
+#include "cycle.h"
+
+//!number of metrics computed for each ensemble sample
+#define NMETRIC 5
+
+//!names of the metrics of a sample, each of which is only defined for one class of samples
+/*!
++ `range`, range of the Mediterranean level over the last cycle of an oscillating sample [m]
++ `zm_min`, lowest Mediterranean level over the last cycle of an oscillating sample [m]
++ `period`, period of the limit cycle of an oscillating sample, found by shooting (see `cycle.h`) only if Ensemble::set_period is on [kyr]
++ `t_isolation`, time when the sill emerges above the ocean in a sample that's cut off [kyr]
++ `zm_fixed`, Mediterranean level at the fixed point reached by a sample with an eroding sill [m]
+*/
+extern const char *metric_names[NMETRIC];
+
+//!number of parameter distributions
+#define NDIST 4
+
+//!names of the parameter distributions, in the order of their codes
+/*!
++ `uniform <lo> <hi>`
++ `loguniform <lo> <hi>`, uniform in the logarithm
++ `normal <mean> <sd>`
++ `lognormal <median> <sigma>`, where `sigma` is the standard deviation of the natural logarithm
+*/
+extern const char *dist_names[NDIST];
+
+//!finds the code of a distribution name in dist_names
+/*!
+\param[in] name name of a distribution
+\return code of the distribution or -1 if the name isn't a distribution
+*/
+int dist_index (const char *name);
+
+//!stream of pseudo-random numbers from the SplitMix64 generator
+/*!
+Every ensemble sample has its own stream, started from a hash of the ensemble's seed and the sample's index, so the parameters of a sample are the same whichever thread draws them and however many threads there are.
+*/
+class EnsembleRng {
+
+public:
+
+    //!constructs the stream of a sample
+    /*!
+    \param[in] seed seed of the ensemble
+    \param[in] stream index of the sample
+    */
+    EnsembleRng (uint64_t seed, uint64_t stream);
+
+    //!next 64 random bits
+    uint64_t next ();
+    //!uniform value in (0, 1)
+    double uniform ();
+    //!standard normal value, by the Box-Muller transform
+    double normal ();
+
+private:
+
+    uint64_t s_;
+};
+
+//!distribution of an uncertain model parameter
+struct ParamDist {
+    //!index of the parameter in param_names
+    int i;
+    //!code of the distribution in dist_names
+    int kind;
+    //!the two arguments of the distribution, in the units of MscGcv::set_param
+    double a, b;
+    //!bounds of the parameter, with values outside them drawn again
+    double lo, hi;
+    //!draws a value of the parameter
+    double draw (EnsembleRng &rng) const;
+};
+
+//!streaming statistics of the classes and metrics of ensemble samples, mergeable with others
+/*!
+Samples are counted by class, and each metric has a RunningStats and a QuantileSketch, so the statistics take the same memory whatever the number of samples and no sample is stored.
+*/
+class EnsembleStats {
+
+public:
+
+    //!empties
+    void clear ();
+    //!adds a sample
+    /*!
+    \param[in] osc oscillation code of the sample, from MscGcv::has_oscillation
+    \param[in] metric metrics of the sample in the order of metric_names, NAN where undefined
+    */
+    void add (int osc, const double *metric);
+    //!adds all the samples of another set of statistics
+    void merge (const EnsembleStats &o);
+
+    //!number of samples
+    int64_t get_n () const { return(count_[0] + count_[1] + count_[2]); }
+    //!number of samples with an oscillation code
+    int64_t get_count (int osc) const { return(count_[osc+1]); }
+    //!running statistics of a metric
+    const RunningStats &get_stats (int k) const { return(stats_[k]); }
+    //!quantile sketch of a metric
+    const QuantileSketch &get_sketch (int k) const { return(sketch_[k]); }
+
+private:
+
+    int64_t count_[3] = {0, 0, 0};
+    RunningStats stats_[NMETRIC];
+    QuantileSketch sketch_[NMETRIC];
+};
+
+//!Monte Carlo ensemble of classifications with uncertain parameters, stopping once its statistics reach a target confidence
+/*!
+Every sample draws the uncertain parameters from their distributions, with the random stream of its index (see EnsembleRng), and is classified by MscGcv::has_oscillation with the arguments used by `sweep.exe`, after which the metrics defined for its class are measured. Samples are classified in batches, in parallel over OpenMP threads with dynamic scheduling, and each thread adds its samples to its own EnsembleStats, which are merged into the totals at the end of every batch.
+
+After every batch with at least the smallest number of samples, the ensemble stops if, for every class, the Wilson score interval of the probability of the class has a half-width within the target at the target confidence level and, if a relative error is set, the confidence interval of the mean of every metric with at least two values has a half-width within that fraction of the mean. Otherwise it continues up to the largest number of samples. With a fixed batch size, the samples and the number of samples are the same for any number of threads, and so are the class counts and the quantiles, while the means and variances can differ by rounding from the order of the merges.
+*/
+class Ensemble {
+
+public:
+
+    //!constructs
+    /*!
+    \param[in] sys model object with the parameters that aren't uncertain, its tolerance, its hypsometry, and whether it's reduced on the slow manifold
+    */
+    Ensemble (MscGcv *sys);
+    //!destructs
+    ~Ensemble ();
+
+    //!adds an uncertain parameter
+    void add_param (const ParamDist &d) { dist_.push_back(d); }
+    //!sets the seed of the random streams
+    void set_seed (uint64_t seed) { seed_ = seed; }
+    //!sets the initial state of every sample
+    void set_initial (double zs0, double zm0) { zs0_ = zs0; zm0_ = zm0; }
+    //!sets whether the period of every oscillating sample's limit cycle is found, which costs a few more integrations of a cycle
+    void set_period (bool period) { period_ = period; }
+    //!sets the stopping criteria
+    /*!
+    \param[in] halfwidth largest half-width of the interval of every class probability
+    \param[in] conf confidence level of the intervals
+    \param[in] nmin smallest number of samples
+    \param[in] nmax largest number of samples
+    \param[in] nbatch number of samples between checks
+    \param[in] relerr largest half-width of the interval of every metric mean relative to the mean, or zero for no criterion on the metrics
+    */
+    void set_stop (double halfwidth, double conf, int64_t nmin, int64_t nmax, int64_t nbatch, double relerr=0.0);
+
+    //!draws the uncertain parameters of a sample into a model object
+    /*!
+    \param[in] i index of the sample
+    \param[out] sys model object
+    */
+    void draw (int64_t i, MscGcv *sys);
+
+    //!classifies samples until the stopping criteria are met
+    /*!
+    \param[in] flog file for a line of progress per batch, or NULL
+    \return zero if the target confidence was reached, or one if the largest number of samples was reached first
+    */
+    int run (FILE *flog=NULL);
+
+    //!checks the stopping criteria against the current statistics
+    bool converged ();
+
+    //!gets the statistics of all samples so far
+    const EnsembleStats &get_stats () { return(tot_); }
+    //!gets the standard normal quantile of the confidence level
+    double get_z () { return(z_); }
+
+    //!writes the class probabilities with their intervals, and the statistics and quantiles of the metrics
+    /*!
+    \param[in] fnclass path of the class table, with a row per class
+    \param[in] fnmetric path of the metric table, with a row per metric
+    */
+    void write (const char *fnclass, const char *fnmetric);
+
+private:
+
+    //model object with the fixed parameters
+    MscGcv *sys_;
+    //one model and one section model per thread
+    int nthread_;
+    MscGcv *mod_;
+    MscGcvSection *sec_;
+    //uncertain parameters
+    std::vector<ParamDist> dist_;
+    uint64_t seed_;
+    double zs0_, zm0_;
+    bool period_;
+    //stopping criteria
+    double halfwidth_, z_, relerr_;
+    int64_t nmin_, nmax_, nbatch_;
+    //statistics of each thread in the current batch, and of all samples
+    std::vector<EnsembleStats> part_;
+    EnsembleStats tot_;
+    //classifies a sample and measures its metrics
+    int classify (int64_t i, int thread, double *metric);
+};
+
+#endif
@@ -0,0 +1,51 @@
+//! \file fidelity.cc
+
+#include "fidelity.h"
+
+const double fidelity_tlim[NFIDELITY] = {1e5, 1e6, 1e7, 1e8};
+const double fidelity_tolfac[NFIDELITY] = {1.0, 1.0, 1.0, 1.0};
+
+int has_oscillation_fidelity (MscGcv *sys, int *level,
+                              double zs0, double zm0,
+                              double tint, double rootrate,
+                              int nlev, const double *tlim,
+                              const double *tolfac, double ampmin,
+                              double rtol) {
+
+    double tol = sys->get_tol();
+    //result, cycle amplitude, and sill margin below the ocean of the previous level
+    int oscp = 2;
+    double ampp = NAN, margp = NAN;
+    int osc = 0;
+
+    for (int k=0; k<nlev; k++) {
+        *level = k;
+        sys->set_tol(tol*tolfac[k]);
+        osc = sys->has_oscillation(zs0, zm0, tint, tlim[k]*YRSEC, rootrate);
+        if ( k == nlev - 1 ) break;
+        if ( osc != 0 ) {
+            //decisions at the full tolerance are those of the last level
+            if ( (tolfac[k] == tolfac[nlev-1]) || (osc == oscp) ) break;
+        } else {
+            //a cycle that isn't growing, drifting toward cutoff, or decaying too fast to last through the last level
+            double amp = sys->get_zm_max() - sys->get_zm_min();
+            double marg = sys->fzo(sys->get_zm_max()) - sys->get_zs_at_zm_max();
+            if ( (oscp == 0) && (amp > ampmin) && (ampp > ampmin) ) {
+                bool grow = amp > ampp*(1.0 + rtol);
+                bool drift = marg < margp - rtol*fabs(margp);
+                if ( !grow && !drift ) {
+                    double amplast = amp;
+                    if ( amp < ampp*(1.0 - rtol) )
+                        amplast = amp*pow(amp/ampp, (tlim[nlev-1] - tlim[k])/(tlim[k] - tlim[k-1]));
+                    if ( amplast > ampmin ) break;
+                }
+            }
+            ampp = amp;
+            margp = marg;
+        }
+        oscp = osc;
+    }
+    sys->set_tol(tol);
+
+    return(osc);
+}
@@ -0,0 +1,50 @@
+#ifndef FIDELITY_H_
+#define FIDELITY_H_
+
+//! \file fidelity.h
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "util.h"
+#include "msc_gcv.h"
+
+//!number of fidelity levels of the default ladder
+#define NFIDELITY 4
+
+//!integration time limits of the default fidelity levels [yr], increasing to the full horizon of has_oscillation
+extern const double fidelity_tlim[NFIDELITY];
+//!tolerances of the default fidelity levels, as multiples of the model's tolerance, all one because looser tolerances made classifications slower
+extern const double fidelity_tolfac[NFIDELITY];
+
+//!classifies a model with a ladder of increasing integration horizons and tolerances, stopping at the first level whose result can be trusted
+/*!
+Level `k` runs MscGcv::has_oscillation with the time limit `tlim[k]` and the tolerance `tolfac[k]` times the model's own, and the last level must be the full fidelity classification. Because the step sizes don't depend on the time limit, a fixed point or cutoff found at a level with the full tolerance is exactly the decision the full classification would make, and it's accepted at once. Most trials are decided within a few hundred kyr, so they cost a small fraction of what the full horizon would for the ones that aren't. A decision at a looser tolerance is only accepted if the level before it made the same decision, since a loose trajectory can settle on the wrong side of a marginal check.
+
+An undecided result at a level short of the last one is either a sustained oscillation or a trajectory that hasn't settled yet, like a weakly damped spiral around a fixed point. It's accepted as an oscillation only when the Mediterranean level's most recent cycle amplitude is stable between this level and the previous one, or is decaying but stays above `ampmin` when extrapolated geometrically to the last level's time limit, and when the sill's margin below the ocean at the most recent Mediterranean maximum hasn't shrunk. Otherwise the next level is tried, so a trial whose class changes between levels, whose cycle is growing or decaying too fast, or whose sill drifts toward cutoff always escalates. Every level restarts from the initial condition, so escalating wastes the cost of the shorter levels, which is small when the time limits grow geometrically.
+
+The model's tolerance is restored before returning, and the model holds the final state and extrema of the accepted level, as after has_oscillation.
+\param[in] sys model object with parameters and tolerance set
+\param[out] level index of the level whose result was accepted
+\param[in] zs0 initial sill level
+\param[in] zm0 initial Mediterranean level
+\param[in] tint shorter integration interval duration
+\param[in] rootrate maximum magnitude of both time derivatives for assuming stationary state
+\param[in] nlev number of levels
+\param[in] tlim time limit of each level, increasing [yr]
+\param[in] tolfac tolerance of each level as a multiple of the model's tolerance, which should be one at the last level
+\param[in] ampmin smallest extrapolated cycle amplitude accepted as an oscillation before the last level [m]
+\param[in] rtol largest relative change of the cycle amplitude and of the sill margin between levels counted as no change
+\return oscillation code, as returned by has_oscillation
+*/
+int has_oscillation_fidelity (MscGcv *sys, int *level,
+                              double zs0=-60.0, double zm0=0.0,
+                              double tint=25*KYRSEC, double rootrate=1e-3/MMYR,
+                              int nlev=NFIDELITY,
+                              const double *tlim=fidelity_tlim,
+                              const double *tolfac=fidelity_tolfac,
+                              double ampmin=0.5,
+                              double rtol=1e-3);
+
+#endif
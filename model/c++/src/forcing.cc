@@ -0,0 +1,302 @@
+//! \file forcing.cc
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "forcing.h"
+
+//size of the binary header [bytes]
+#define FORCING_HEADER 64
+//version of the binary layout
+#define FORCING_FORMAT 1
+
+const char *forcing_names[NFORCE] = {"P", "E", "R", "U"};
+
+//seconds in a year and in 1000 years, as in msc_gcv.h
+static const double yr = 31557600.0,
+                    kyr = 31557600000.0;
+//conversions from table units to SI units, in the order of forcing_names
+static const double forcing_scale[NFORCE] = {1.0/yr, 1.0/yr, 1.0, 1e-3/yr};
+
+Forcing::Forcing (const char *fn, double dt) :
+    mask_ (0),
+    ncell_ (0),
+    njump_ (0),
+    cell_ (NULL),
+    jump_ (NULL),
+    map_ (NULL),
+    mapsize_ (0) {
+
+    //binary grids start with a magic string
+    char magic[8] = {0};
+    FILE *ifile = fopen(fn, "rb");
+    if ( !ifile ) {
+        printf("FAILURE: cannot open file %s\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    size_t nread = fread(magic, 1, 8, ifile);
+    fclose(ifile);
+    if ( (nread == 8) && (memcmp(magic, "MSCFORCE", 8) == 0) ) {
+        load_grid(fn);
+    } else {
+        load_table(fn, dt);
+    }
+    idt_ = 1.0/dt_;
+
+    //hash every byte of the grid once, so cache keys don't have to
+    hash_ = 0xcbf29ce484222325ULL ^ mask_;
+    const unsigned char *p = (const unsigned char*)cell_;
+    for (size_t i=0; i<4*NFORCE*ncell_*sizeof(double); i++) hash_ = (hash_ ^ p[i])*0x100000001b3ULL;
+    p = (const unsigned char*)jump_;
+    for (size_t i=0; i<njump_*sizeof(int64_t); i++) hash_ = (hash_ ^ p[i])*0x100000001b3ULL;
+    for (double x : {t0_, dt_}) {
+        p = (const unsigned char*)&x;
+        for (size_t i=0; i<sizeof(double); i++) hash_ = (hash_ ^ p[i])*0x100000001b3ULL;
+    }
+}
+
+Forcing::~Forcing () {
+    if ( map_ ) munmap(map_, mapsize_);
+}
+
+void Forcing::load_grid (const char *fn) {
+
+    int fd = open(fn, O_RDONLY);
+    struct stat st;
+    if ( (fd < 0) || (fstat(fd, &st) != 0) || (st.st_size < FORCING_HEADER) ) {
+        printf("FAILURE: cannot read forcing grid %s\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    mapsize_ = st.st_size;
+    map_ = mmap(NULL, mapsize_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if ( map_ == MAP_FAILED ) {
+        printf("FAILURE: cannot map forcing grid %s\n", fn);
+        exit(EXIT_FAILURE);
+    }
+
+    //header
+    const unsigned char *p = (const unsigned char*)map_;
+    uint32_t version;
+    uint64_t ncell, njump;
+    memcpy(&version, p + 8, 4);
+    memcpy(&mask_, p + 12, 4);
+    memcpy(&ncell, p + 16, 8);
+    memcpy(&njump, p + 24, 8);
+    memcpy(&t0_, p + 32, 8);
+    memcpy(&dt_, p + 40, 8);
+    ncell_ = ncell;
+    njump_ = njump;
+    if ( (version != FORCING_FORMAT) || (ncell_ < 1) || !(dt_ > 0)
+      || (mapsize_ != (size_t)(FORCING_HEADER + (4*NFORCE*ncell_ + njump_)*8)) ) {
+        printf("FAILURE: forcing grid %s is corrupt or has an incompatible format\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    //the cells and jumps are used in place
+    cell_ = (const double*)(p + FORCING_HEADER);
+    jump_ = (const int64_t*)(p + FORCING_HEADER + 4*NFORCE*ncell_*8);
+}
+
+//computes the slopes of the natural cubic spline through a run of lines with increasing times
+static void spline_slopes (const double *t, const double *y, long n, double *d) {
+    //tridiagonal system for continuous second derivatives, solved by elimination
+    std::vector<double> c(n);
+    double h = t[1] - t[0], s = (y[1] - y[0])/h;
+    c[0] = 0.5;
+    d[0] = 1.5*s;
+    for (long i=1; i<n; i++) {
+        double hl = h, sl = s, a, b, r;
+        if ( i < n - 1 ) {
+            h = t[i+1] - t[i];
+            s = (y[i+1] - y[i])/h;
+            a = 1/hl;
+            b = 2/hl + 2/h;
+            r = 3*(sl/hl + s/h);
+            c[i] = (1/h)/(b - a*c[i-1]);
+        } else {
+            a = 1;
+            b = 2;
+            r = 3*sl;
+        }
+        d[i] = (r - a*d[i-1])/(b - a*c[i-1]);
+    }
+    for (long i=n-2; i>=0; i--) d[i] -= c[i]*d[i+1];
+}
+
+//interpolates one column of a table and its time derivative, taking the later side of a jump if side is positive
+static void interp_column (const std::vector<double> &tt, const std::vector<double> &v,
+                           const std::vector<double> &d, double t, int side,
+                           double *y, double *dy) {
+    long n = tt.size(), i;
+    if ( side > 0 ) {
+        //last line at or before t
+        i = (std::upper_bound(tt.begin(), tt.end(), t) - tt.begin()) - 1;
+    } else {
+        //line before the first line at or after t
+        i = (std::lower_bound(tt.begin(), tt.end(), t) - tt.begin()) - 1;
+    }
+    if ( (i < 0) || (i >= n - 1) ) {
+        *y = (i < 0) ? v[0] : v[n-1];
+        *dy = 0.0;
+        return;
+    }
+    //cubic Hermite segment
+    double h = tt[i+1] - tt[i],
+           u = (t - tt[i])/h;
+    *y = (1 + 2*u)*(1 - u)*(1 - u)*v[i] + u*u*(3 - 2*u)*v[i+1]
+       + h*(u*(1 - u)*(1 - u)*d[i] + u*u*(u - 1)*d[i+1]);
+    *dy = 6*u*(u - 1)*(v[i] - v[i+1])/h
+        + (1 - u)*(1 - 3*u)*d[i] + u*(3*u - 2)*d[i+1];
+}
+
+void Forcing::load_table (const char *fn, double dt) {
+
+    std::ifstream ifile(fn);
+    if ( !ifile.is_open() ) {
+        printf("FAILURE: cannot open file %s\n", fn);
+        exit(EXIT_FAILURE);
+    }
+
+    //header, naming the columns
+    std::string line, name;
+    std::getline(ifile, line);
+    std::vector<int> col;
+    std::istringstream hs(line);
+    while ( std::getline(hs, name, ',') ) {
+        name.erase(0, name.find_first_not_of(" \t\r"));
+        name.erase(name.find_last_not_of(" \t\r") + 1);
+        int k = -1;
+        for (int j=0; j<NFORCE; j++) if ( name == forcing_names[j] ) k = j;
+        if ( (col.empty() && (name != "t")) || (!col.empty() && (k < 0)) ) {
+            printf("FAILURE: forcing table %s needs a header starting with t and naming only P, E, R, or U\n", fn);
+            exit(EXIT_FAILURE);
+        }
+        if ( (k >= 0) && forces(k) ) {
+            printf("FAILURE: forcing table %s has two %s columns\n", fn, forcing_names[k]);
+            exit(EXIT_FAILURE);
+        }
+        if ( k >= 0 ) mask_ |= 1u << k;
+        col.push_back(k);
+    }
+
+    //values, in SI units
+    std::vector<double> tt, v[NFORCE];
+    while ( std::getline(ifile, line) ) {
+        if ( line.find_first_not_of(" \t\r") == std::string::npos ) continue;
+        std::istringstream ls(line);
+        std::string x;
+        unsigned long j = 0;
+        while ( std::getline(ls, x, ',') && (j < col.size()) ) {
+            double y = std::stod(x);
+            if ( col[j] < 0 ) {
+                tt.push_back(y*kyr);
+            } else {
+                v[col[j]].push_back(y*forcing_scale[col[j]]);
+            }
+            j++;
+        }
+        if ( j != col.size() ) {
+            printf("FAILURE: line of forcing table %s has the wrong number of columns: %s\n", fn, line.c_str());
+            exit(EXIT_FAILURE);
+        }
+    }
+    long n = tt.size();
+    for (int k=0; k<NFORCE; k++) if ( !forces(k) ) v[k].assign(n, 0.0);
+    if ( (n < 2) || (col.size() < 2) ) {
+        printf("FAILURE: forcing table %s needs at least two lines and one forced parameter\n", fn);
+        exit(EXIT_FAILURE);
+    }
+
+    //grid, with cells no longer than the shortest interval
+    double dmin = INFINITY;
+    for (long i=1; i<n; i++) {
+        if ( tt[i] < tt[i-1] || ((i > 1) && (tt[i] == tt[i-1]) && (tt[i-1] == tt[i-2])) ) {
+            printf("FAILURE: forcing table %s needs increasing times, with at most two lines at any time\n", fn);
+            exit(EXIT_FAILURE);
+        }
+        if ( tt[i] > tt[i-1] ) dmin = std::min(dmin, tt[i] - tt[i-1]);
+    }
+    dt_ = (dt > 0) ? dt*kyr : dmin;
+    if ( !std::isfinite(dt_) ) {
+        printf("FAILURE: forcing table %s needs at least two distinct times\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    t0_ = tt[0];
+    ncell_ = (long)ceil((tt[n-1] - t0_)/dt_ - 1e-6);
+    if ( ncell_ < 1 ) ncell_ = 1;
+
+    //jumps move to the nearest cell boundary, which must keep the table in order
+    for (long i=1; i<n; i++) {
+        if ( tt[i] != tt[i-1] ) continue;
+        if ( (i == 1) || (i == n - 1) ) {
+            printf("FAILURE: jumps of forcing table %s must be between its first and last times\n", fn);
+            exit(EXIT_FAILURE);
+        }
+        long b = lround((tt[i] - t0_)/dt_);
+        double tb = t0_ + b*dt_;
+        if ( (tb <= tt[i-2]) || (tb >= tt[i+1]) ) {
+            printf("FAILURE: cells of forcing table %s are too long to place the jump at %g kyr\n", fn, tt[i]/kyr);
+            exit(EXIT_FAILURE);
+        }
+        tt[i-1] = tt[i] = tb;
+        jumpv_.push_back(b);
+    }
+
+    //slopes of a separate spline through every run of lines between jumps
+    std::vector<double> d[NFORCE];
+    for (int k=0; k<NFORCE; k++) {
+        d[k].resize(n);
+        for (long i0=0, i1=1; i1<=n; i1++) {
+            if ( (i1 < n) && (tt[i1] != tt[i1-1]) ) continue;
+            spline_slopes(tt.data() + i0, v[k].data() + i0, i1 - i0, d[k].data() + i0);
+            i0 = i1;
+        }
+    }
+
+    //values and slopes, over the whole cell, at both ends of every cell
+    cellv_.resize(4*NFORCE*ncell_);
+    for (long i=0; i<ncell_; i++) {
+        double *c = cellv_.data() + 4*NFORCE*i;
+        for (int k=0; k<NFORCE; k++) {
+            interp_column(tt, v[k], d[k], t0_ + i*dt_, 1, c + 4*k, c + 4*k + 2);
+            interp_column(tt, v[k], d[k], t0_ + (i + 1)*dt_, -1, c + 4*k + 1, c + 4*k + 3);
+            c[4*k+2] *= dt_;
+            c[4*k+3] *= dt_;
+        }
+    }
+    njump_ = jumpv_.size();
+    cell_ = cellv_.data();
+    jump_ = jumpv_.data();
+}
+
+void Forcing::write (const char *fn) const {
+
+    check_file_write(fn);
+    FILE *ofile = fopen(fn, "wb");
+    unsigned char header[FORCING_HEADER] = {0};
+    uint32_t version = FORCING_FORMAT;
+    uint64_t ncell = ncell_, njump = njump_;
+    memcpy(header, "MSCFORCE", 8);
+    memcpy(header + 8, &version, 4);
+    memcpy(header + 12, &mask_, 4);
+    memcpy(header + 16, &ncell, 8);
+    memcpy(header + 24, &njump, 8);
+    memcpy(header + 32, &t0_, 8);
+    memcpy(header + 40, &dt_, 8);
+    fwrite(header, 1, FORCING_HEADER, ofile);
+    fwrite(cell_, sizeof(double), 4*NFORCE*ncell_, ofile);
+    fwrite(jump_, sizeof(int64_t), njump_, ofile);
+    fclose(ofile);
+}
+
+long Forcing::next_jump (double t) const {
+    //a jump within a millionth of a cell counts as already passed, so rounding can't revisit it
+    double tj = t + 1e-6*dt_;
+    long j = 0;
+    while ( (j < njump_) && (get_tjump(j) <= tj) ) j++;
+    return(j);
+}
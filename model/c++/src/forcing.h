@@ -0,0 +1,109 @@
+#ifndef FORCING_H_
+#define FORCING_H_
+
+//! \file forcing.h
+
+#include <cmath>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#include "util.h"
+
+//!number of parameters that can be forced, in the order of forcing_names
+#define NFORCE 4
+
+//!names of the parameters that can be forced, `P`, `E`, `R`, and `U`
+extern const char *forcing_names[NFORCE];
+
+//!time series of precipitation, evaporation, river input, and uplift with constant time lookups
+/*!
+A forcing table is loaded either from a text table or from a binary lookup grid written earlier by write. The text table has a header line naming its columns, which must start with `t` and can include any of `P`, `E`, `R`, and `U` in any order, followed by one line of comma separated numbers per time. Times are in kyr and the values are in the units of MscGcv::set_param, so `P` and `E` are in m/yr, `R` is in m^3/s, and `U` is in mm/yr. Parameters without a column aren't forced and keep the constant values of the model object. Between times of the table the values are interpolated by a natural cubic spline, and two lines with the same time make a jump from the values of the first to those of the second, with separate splines on either side.
+
+The table is resampled onto a uniform grid of cells, and each cell stores the values and slopes at both of its ends for all four parameters in SI units, 128 bytes in a row, so a lookup finds its cell directly from the grid spacing and reads two cache lines. Within a cell the values are cubic Hermite polynomials, so the forcing has continuous slopes across cells, and continuous second derivatives too when the cells line up with the times of the table, as they do by default for evenly spaced tables. That matters for the speed of forced integrations, because the integrator's error estimate sees every kink of the forcing, and linear interpolation between the lines of an orbital forcing table rejected twenty times more steps than the spline, which rejects as few as the exact sinusoid. Jumps are moved to the nearest cell boundary, where the two neighboring cells hold the values on either side. Before the first time and after the last, the values are held constant.
+
+The binary file is the 64 byte header (the characters "MSCFORCE", a uint32 format version, a uint32 bit mask of the forced parameters, a uint64 cell count, a uint64 jump count, and float64 start time and cell length in seconds, then 16 zero bytes) followed by the cells and the int64 index of the cell boundary of every jump. It is memory mapped read-only rather than copied. All members are set by the constructor, so one object can be shared by any number of threads and model objects.
+*/
+class Forcing {
+
+public:
+
+    //!loads a text table or a binary lookup grid
+    /*!
+    \param[in] fn path to the table or grid
+    \param[in] dt cell length for a text table [kyr], where zero uses the shortest interval between distinct times of the table
+    */
+    Forcing (const char *fn, double dt=0.0);
+    //!destructs, unmapping a binary grid
+    ~Forcing ();
+
+    //!writes the lookup grid to a binary file that can be memory mapped by later runs
+    void write (const char *fn) const;
+
+    //!computes the forced values at a time, from a range of cells
+    /*!
+    Keeping the lookup inside the cells between two jumps makes the values on the correct side of a jump at its exact time, and immune to rounding across it.
+    \param[in] t time [s]
+    \param[out] f values of the four parameters in SI units, in the order of forcing_names, which are zero for parameters that aren't forced
+    \param[in] ilo lowest cell that can be used
+    \param[in] ihi highest cell that can be used
+    */
+    void eval (double t, double *f, long ilo, long ihi) const {
+        double x = (t - t0_)*idt_;
+        long i = (x <= ilo) ? ilo : ((x >= ihi) ? ihi : (long)x);
+        double u = x - i;
+        u = (u < 0.0) ? 0.0 : ((u > 1.0) ? 1.0 : u);
+        double v = 1 - u,
+               h0 = (1 + 2*u)*v*v,
+               h1 = u*u*(3 - 2*u),
+               g0 = u*v*v,
+               g1 = -u*u*v;
+        const double *c = cell_ + 4*NFORCE*i;
+        for (int k=0; k<NFORCE; k++) f[k] = h0*c[4*k] + h1*c[4*k+1] + g0*c[4*k+2] + g1*c[4*k+3];
+    }
+
+    //!whether a parameter, by its index in forcing_names, is forced
+    bool forces (int k) const { return( (mask_ >> k) & 1 ); }
+    //!number of cells in the grid
+    long get_ncell () const { return(ncell_); }
+    //!start time of the grid [s]
+    double get_t0 () const { return(t0_); }
+    //!cell length [s]
+    double get_dt () const { return(dt_); }
+    //!number of jumps
+    long get_njump () const { return(njump_); }
+    //!index of the cell boundary of a jump, which is also the first cell after it
+    long get_jump (long j) const { return(jump_[j]); }
+    //!time of a jump [s]
+    double get_tjump (long j) const { return(t0_ + jump_[j]*dt_); }
+    //!index of the first jump after a time, or the number of jumps if there are none
+    long next_jump (double t) const;
+    //!hash of the whole grid, computed when it's loaded, for identifying the forcing in cache keys
+    uint64_t get_hash () const { return(hash_); }
+
+private:
+
+    //forced parameters
+    uint32_t mask_;
+    //grid
+    long ncell_, njump_;
+    double t0_, dt_, idt_;
+    //cells and jumps, pointing into the memory map or the vectors
+    const double *cell_;
+    const int64_t *jump_;
+    std::vector<double> cellv_;
+    std::vector<int64_t> jumpv_;
+    //memory map of a binary grid
+    void *map_;
+    size_t mapsize_;
+    //hash of the grid
+    uint64_t hash_;
+    //loads a binary grid
+    void load_grid (const char *fn);
+    //loads and resamples a text table
+    void load_table (const char *fn, double dt);
+};
+
+#endif
@@ -0,0 +1,105 @@
+//! \file hypsometry.cc
+
+#include <algorithm>
+
+#include "hypsometry.h"
+
+Hypsometry::Hypsometry (const char *fn, double dz, double zlo, double zhi) :
+    dz_ (dz),
+    idz_ (1.0/dz),
+    zlo_ (zlo),
+    zhi_ (zhi) {
+
+    //read the table
+    std::ifstream ifile(fn);
+    std::string line;
+    if ( !ifile.is_open() ) {
+        std::cout << "FAILURE: cannot open file " << fn << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::vector< std::pair<double,double> > tab;
+    while ( std::getline(ifile, line) ) {
+        double z, A;
+        if ( sscanf(line.c_str(), "%lf , %lf", &z, &A) == 2 )
+            tab.push_back(std::make_pair(z, A));
+    }
+    std::sort(tab.begin(), tab.end());
+    for (unsigned long i=0; i<tab.size(); i++) {
+        ztab_.push_back(tab[i].first);
+        atab_.push_back(tab[i].second);
+    }
+
+    //check the table and grid
+    unsigned long n = ztab_.size();
+    if ( n < 2 ) {
+        printf("FAILURE: hypsometry table %s has fewer than two points\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    for (unsigned long i=0; i<n; i++) {
+        if ( !(atab_[i] > 0) || ((i > 0) && !(ztab_[i] > ztab_[i-1])) ) {
+            printf("FAILURE: hypsometry table %s needs distinct levels and positive areas\n", fn);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if ( !(dz > 0) || !(zlo < 0) || !(zhi > 0) ) {
+        printf("FAILURE: hypsometry grid needs a positive spacing and must include sea level\n");
+        exit(EXIT_FAILURE);
+    }
+
+    //Fritsch-Carlson slopes of the monotone interpolant
+    std::vector<double> s(n-1), d(n);
+    for (unsigned long i=0; i<n-1; i++)
+        s[i] = (atab_[i+1] - atab_[i])/(ztab_[i+1] - ztab_[i]);
+    d[0] = s[0];
+    d[n-1] = s[n-2];
+    for (unsigned long i=1; i<n-1; i++)
+        d[i] = (s[i-1]*s[i] > 0) ? (s[i-1] + s[i])/2 : 0.0;
+    for (unsigned long i=0; i<n-1; i++) {
+        if ( s[i] == 0 ) {
+            d[i] = 0.0;
+            d[i+1] = 0.0;
+        } else {
+            double al = d[i]/s[i],
+                   be = d[i+1]/s[i],
+                   r = al*al + be*be;
+            if ( r > 9 ) {
+                d[i] = 3*al*s[i]/sqrt(r);
+                d[i+1] = 3*be*s[i]/sqrt(r);
+            }
+        }
+    }
+
+    //sample the area on the grid and integrate it
+    nz_ = (long)ceil((zhi - zlo)/dz) + 1;
+    zhi_ = zlo + (nz_ - 1)*dz;
+    A_.resize(nz_);
+    W_.resize(nz_);
+    for (long i=0; i<nz_; i++) A_[i] = interp(zlo + i*dz, d);
+    W_[0] = 0.0;
+    for (long i=1; i<nz_; i++) W_[i] = W_[i-1] + dz*(A_[i-1] + A_[i])/2;
+    //integral up to sea level, using the same formula as volume()
+    W0_ = 0.0;
+    W0_ = -volume(0.0);
+}
+
+double Hypsometry::interp (double z, const std::vector<double> &d) const {
+
+    unsigned long n = ztab_.size();
+    //exponential extrapolation
+    if ( z <= ztab_[0] ) {
+        double r = log(atab_[1]/atab_[0])/(ztab_[1] - ztab_[0]);
+        return( atab_[0]*exp(r*(z - ztab_[0])) );
+    }
+    if ( z >= ztab_[n-1] ) {
+        double r = log(atab_[n-1]/atab_[n-2])/(ztab_[n-1] - ztab_[n-2]);
+        return( atab_[n-1]*exp(r*(z - ztab_[n-1])) );
+    }
+    //cubic Hermite interpolation in the containing interval
+    unsigned long i = std::upper_bound(ztab_.begin(), ztab_.end(), z) - ztab_.begin() - 1;
+    double h = ztab_[i+1] - ztab_[i],
+           t = (z - ztab_[i])/h,
+           t2 = t*t,
+           t3 = t2*t;
+    return( (2*t3 - 3*t2 + 1)*atab_[i] + (t3 - 2*t2 + t)*h*d[i]
+          + (-2*t3 + 3*t2)*atab_[i+1] + (t3 - t2)*h*d[i+1] );
+}
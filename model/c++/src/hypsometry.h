@@ -0,0 +1,90 @@
+#ifndef HYPSOMETRY_H_
+#define HYPSOMETRY_H_
+
+//! \file hypsometry.h
+
+#include <cmath>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+
+#include "util.h"
+
+//!tabulated Mediterranean hypsometry with constant time lookups
+/*!
+A table of basin area against level, like `data/hypsometry.csv`, is interpolated with a monotone piecewise cubic (Fritsch-Carlson) curve, which is sampled once on a uniform grid of levels. The area at any level is then interpolated linearly from the two nearest grid samples, found directly from the grid spacing, and the volume below sea level is the exact integral of that piecewise linear area, accumulated over the grid when the table is loaded. The volume is therefore conserved exactly by the model, unlike with the two exponential fit, and neither lookup needs any transcendental functions.
+
+Below the deepest tabulated level the area decays exponentially at the rate of the deepest table interval, and above the highest level it grows at the rate of the highest interval. Beyond the ends of the grid the area is held constant. All members are set by the constructor, so one object can be shared by any number of threads and model objects.
+*/
+class Hypsometry {
+
+public:
+
+    //!loads a table and builds the lookup grid
+    /*!
+    Lines of the file that don't start with two comma separated numbers, like titles and headers, are skipped. The first number is a level [m] and the second is the basin area at that level [m^2].
+    \param[in] fn path to the table
+    \param[in] dz grid spacing [m]
+    \param[in] zlo lowest level of the grid [m]
+    \param[in] zhi highest level of the grid [m]
+    */
+    Hypsometry (const char *fn, double dz=1.0, double zlo=-6000.0, double zhi=1000.0);
+
+    //!computes the basin area at a level [m^2]
+    double area (double z) const {
+        double x = (z - zlo_)*idz_;
+        if ( x <= 0.0 ) return(A_[0]);
+        if ( x >= nz_ - 1 ) return(A_[nz_-1]);
+        long i = (long)x;
+        double f = x - i;
+        return( A_[i] + f*(A_[i+1] - A_[i]) );
+    }
+
+    //!computes the derivative of the basin area with respect to level [m]
+    double darea (double z) const {
+        double x = (z - zlo_)*idz_;
+        if ( (x <= 0.0) || (x >= nz_ - 1) ) return(0.0);
+        long i = (long)x;
+        return( (A_[i+1] - A_[i])*idz_ );
+    }
+
+    //!computes the basin volume between a level and sea level, which is negative for levels above sea level [m^3]
+    double volume (double z) const {
+        double x = (z - zlo_)*idz_;
+        if ( x <= 0.0 ) return( W0_ + A_[0]*(zlo_ - z) );
+        if ( x >= nz_ - 1 ) return( W0_ - W_[nz_-1] - A_[nz_-1]*(z - zhi_) );
+        long i = (long)x;
+        double f = x - i;
+        return( W0_ - W_[i] - dz_*f*(A_[i] + 0.5*f*(A_[i+1] - A_[i])) );
+    }
+
+    //!number of points in the table
+    unsigned long get_ntab () const { return(ztab_.size()); }
+    //!level of a table point [m]
+    double get_ztab (unsigned long i) const { return(ztab_[i]); }
+    //!area of a table point [m^2]
+    double get_atab (unsigned long i) const { return(atab_[i]); }
+    //!grid spacing [m]
+    double get_dz () const { return(dz_); }
+    //!lowest level of the grid [m]
+    double get_zlo () const { return(zlo_); }
+    //!highest level of the grid [m]
+    double get_zhi () const { return(zhi_); }
+
+private:
+
+    //table, sorted by increasing level
+    std::vector<double> ztab_, atab_;
+    //grid
+    double dz_, idz_, zlo_, zhi_;
+    long nz_;
+    //area and its integral from the bottom of the grid at each grid level
+    std::vector<double> A_, W_;
+    //integral of the area from the bottom of the grid to sea level
+    double W0_;
+    //evaluates the monotone cubic interpolant and its extrapolation
+    double interp (double z, const std::vector<double> &d) const;
+};
+
+#endif
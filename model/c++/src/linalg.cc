@@ -1,6 +1,7 @@
 //! \file linalg.cc
 
 #include "linalg.h"
+#include "trace.h"
 
 void crout_forw_sub (double **L, double *b, int *p, int n, double *out) {
 
@@ -26,6 +27,8 @@ void back_sub (double **U, double *b, int n, double *out) {
 
 int crout_LU (double **A, int n, int *p) {
 
+    TRACE_ZONE("crout_LU");
+
     int i, j, k, idx, ti;
     double m, td;
 
@@ -72,6 +75,8 @@ int crout_LU (double **A, int n, int *p) {
 
 void solve_LU (double **LU, int *p, double *b, int n, double *out) {
 
+    TRACE_ZONE("solve_LU");
+
     //run forward substitution, handling the permutation along the way
     crout_forw_sub(LU, b, p, n, out);
     //run backward substitution, overwriting "out" along the way
@@ -0,0 +1,187 @@
+//! \file main_atlas.cc
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+
+#include "omp.h"
+
+#include "util.h"
+#include "atlas.h"
+
+//reads fixed axis values given as name=value arguments, by the index of the nearest value
+static void read_fixed (const Atlas &atl, int argc, char **argv, int k0, long *k, bool *set) {
+    for (int d=0; d<atl.get_ndim(); d++) set[d] = false;
+    for (int i=k0; i<argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        int d = (eq == std::string::npos) ? -1 : atl.get_axis(arg.substr(0, eq).c_str());
+        if ( d < 0 ) {
+            printf("FAILURE: '%s' isn't of the form axis=value with an axis of the atlas\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+        k[d] = atl.nearest(d, std::stod(arg.substr(eq+1)));
+        set[d] = true;
+    }
+}
+
+//packs the classifications of a sweep's output directory into an atlas
+static void pack (const std::string &dir) {
+
+    //axes, from a line of parameters.txt for each
+    std::vector< std::string > pname;
+    std::vector< std::vector<double> > pvec;
+    std::string fn = dir + "/parameters.txt", line;
+    std::ifstream ifile(fn);
+    if ( !ifile.is_open() ) {
+        printf("FAILURE: cannot open file %s\n", fn.c_str());
+        exit(EXIT_FAILURE);
+    }
+    while ( std::getline(ifile, line) ) {
+        std::istringstream ss(line);
+        std::string name;
+        double x;
+        if ( !(ss >> name) ) continue;
+        pname.push_back(name);
+        pvec.push_back(std::vector<double>());
+        while ( ss >> x ) pvec.back().push_back(x);
+    }
+    ifile.close();
+
+    //classifications, from the last column of trials.csv
+    std::vector<std::string> cols;
+    std::vector< std::vector<double> > rows;
+    fn = dir + "/trials.csv";
+    double ts = omp_get_wtime();
+    read_csv(fn.c_str(), cols, rows);
+    ts = omp_get_wtime() - ts;
+    unsigned long ntrial = 1;
+    for (unsigned long d=0; d<pvec.size(); d++) ntrial *= pvec[d].size();
+    if ( (rows.size() != ntrial) || (cols.back() != "classification") ) {
+        printf("FAILURE: %s doesn't have a classification for every point of the grid in %s/parameters.txt\n",
+            fn.c_str(), dir.c_str());
+        exit(EXIT_FAILURE);
+    }
+    std::vector<int> cla(ntrial);
+    for (unsigned long i=0; i<ntrial; i++) cla[(long)rows[i][0]] = (int)rows[i].back();
+
+    //write and reopen, comparing every classification
+    fn = dir + "/atlas.bin";
+    size_t size = Atlas::write(fn.c_str(), pname, pvec, cla.data());
+    double tl = omp_get_wtime();
+    Atlas atl(fn.c_str());
+    tl = omp_get_wtime() - tl;
+    for (unsigned long i=0; i<ntrial; i++) {
+        if ( atl.get(i) != cla[i] ) {
+            printf("FAILURE: trial %lu of the atlas doesn't match\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    FILE *f = fopen((dir + "/trials.csv").c_str(), "rb");
+    fseek(f, 0, SEEK_END);
+    long csize = ftell(f);
+    fclose(f);
+    printf("%lu trials written to: %s\n", ntrial, fn.c_str());
+    printf("  %lu bytes, %g times smaller than trials.csv\n", (unsigned long)size, double(csize)/size);
+    printf("  %g seconds to read trials.csv and %g seconds to open the atlas\n", ts, tl);
+}
+
+//!packs sweep results into compact atlases and queries them
+/*!
++ `atlas.exe pack <dir>` packs the classifications in `trials.csv` of a `sweep.exe` output directory, over the grid in its `parameters.txt`, into `atlas.bin` (see `atlas.h`), which `sweep.exe` also writes itself
++ `atlas.exe info <atlas>` prints the axes, the number of uniform blocks, and a classification summary
++ `atlas.exe point <atlas> axis=value ...` prints the classification at the grid point nearest to a value on every axis
++ `atlas.exe slice <atlas> <csv> <axis1> [axis2] axis=value ...` writes a one or two dimensional slice along one or two axes, at the grid points nearest to a value on every other axis, to a csv file with columns for the slice axes and the classification
+*/
+int main (int argc, char **argv) {
+
+    if ( argc < 3 ) {
+        printf("\ninvalid number of command line arguments\n");
+        printf("must supply one of:\n  pack <sweep output directory>\n  info <atlas>\n");
+        printf("  point <atlas> axis=value ...\n  slice <atlas> <csv> <axis1> [axis2] axis=value ...\n");
+        exit(EXIT_FAILURE);
+    }
+    std::string cmd = argv[1];
+
+    if ( cmd == "pack" ) {
+        pack(argv[2]);
+        return(0);
+    }
+
+    Atlas atl(argv[2]);
+    int ndim = atl.get_ndim();
+    std::vector<long> k(ndim, 0);
+    bool *set = new bool[ndim];
+
+    if ( cmd == "info" ) {
+        printf("%ld trials over %d axes\n", atl.get_ntrial(), ndim);
+        for (int d=0; d<ndim; d++)
+            printf(" %10s | %6g | %6g | %5ld\n", atl.get_name(d), atl.get_value(d, 0),
+                atl.get_value(d, atl.get_count(d)-1), atl.get_count(d));
+        long nblock = (atl.get_ntrial() + ATLAS_BLOCK - 1)/ATLAS_BLOCK;
+        printf("%ld of %ld blocks uniform\n", atl.get_nuniform(), nblock);
+        long n[4] = {0, 0, 0, 0};
+        for (long i=0; i<atl.get_ntrial(); i++) n[atl.get(i) + 1]++;
+        printf("  %ld stable with eroding sill\n", n[0]);
+        printf("  %ld oscillating\n", n[1]);
+        printf("  %ld stable after cutoff and desiccation\n", n[2]);
+        if ( n[3] > 0 ) printf("  %ld without a classification\n", n[3]);
+
+    } else if ( cmd == "point" ) {
+        read_fixed(atl, argc, argv, 3, k.data(), set);
+        for (int d=0; d<ndim; d++) {
+            if ( !set[d] ) {
+                printf("FAILURE: no value given for axis '%s'\n", atl.get_name(d));
+                exit(EXIT_FAILURE);
+            }
+            printf("%s = %g\n", atl.get_name(d), atl.get_value(d, k[d]));
+        }
+        printf("classification = %d\n", atl.at(k.data()));
+
+    } else if ( (cmd == "slice") && (argc >= 5) ) {
+        int d1 = atl.get_axis(argv[4]), d2 = -1, k0 = 5;
+        if ( (argc > 5) && (std::string(argv[5]).find('=') == std::string::npos) ) {
+            d2 = atl.get_axis(argv[5]);
+            k0 = 6;
+            if ( d2 < 0 ) d1 = -1;
+        }
+        if ( (d1 < 0) || (d1 == d2) ) {
+            printf("FAILURE: the slice axes must be two different axes of the atlas\n");
+            exit(EXIT_FAILURE);
+        }
+        read_fixed(atl, argc, argv, k0, k.data(), set);
+        for (int d=0; d<ndim; d++) {
+            if ( (d != d1) && (d != d2) && !set[d] ) {
+                printf("FAILURE: no value given for axis '%s'\n", atl.get_name(d));
+                exit(EXIT_FAILURE);
+            }
+        }
+        long n1 = atl.get_count(d1), n2 = (d2 < 0) ? 1 : atl.get_count(d2);
+        std::vector<int> out(n1*n2);
+        atl.slice(d1, d2, k.data(), out.data());
+        check_file_write(argv[3]);
+        FILE *ofile = fopen(argv[3], "w");
+        fprintf(ofile, "%s,", atl.get_name(d1));
+        if ( d2 >= 0 ) fprintf(ofile, "%s,", atl.get_name(d2));
+        fprintf(ofile, "classification\n");
+        for (long k2=0; k2<n2; k2++) {
+            for (long k1=0; k1<n1; k1++) {
+                fprintf(ofile, "%g,", atl.get_value(d1, k1));
+                if ( d2 >= 0 ) fprintf(ofile, "%g,", atl.get_value(d2, k2));
+                fprintf(ofile, "%d\n", out[k1 + n1*k2]);
+            }
+        }
+        fclose(ofile);
+        printf("%ld point slice written to: %s\n", n1*n2, argv[3]);
+
+    } else {
+        printf("FAILURE: unknown command '%s' or missing arguments\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+
+    delete [] set;
+    return(0);
+}
@@ -0,0 +1,125 @@
+//! \file main_basin.cc
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+#include "omp.h"
+
+#include "util.h"
+#include "msc_gcv.h"
+#include "basin.h"
+
+//!maps the basins of attraction of the model over a grid of initial sill and Mediterranean levels
+/*!
++ requires three command line arguments, the number of initial sill levels, the number of initial Mediterranean levels, and the output directory
++ an optional fourth argument is a csv file of parameter sets, like the `trials.csv` file written by `sweep.exe`, with one map computed for each row
++ columns of the csv file named after model parameters (see `param_names`) override the reference values and other columns are ignored
++ each initial condition is classified with the `has_oscillation` method of a `MscGcvBasin` object, which stops early when the trajectory reaches a fixed point or limit cycle classified earlier in the same map
++ each map is written to `basin_<row>.bin` in the output directory, with the layout
+    - 8 byte identifier `MSCBASIN`
+    - int64 `nzs`, `nzm`
+    - float64 `zslo`, `zshi`, `zmlo`, `zmhi`
+    - float64 model parameters in the order and units of `MscGcv::get_param`
+    - int8 oscillation codes, shape (nzm, nzs)
+*/
+int main (int argc, char **argv) {
+
+    //get number of threads being used
+    int nthread = omp_get_max_threads();
+
+    //--------------------------------------------------------------------------
+    // IMPORTANT INPUT VARIABLES
+
+    if ( (argc != 4) && (argc != 5) ) {
+        printf("\ninvalid number of command line arguments\n");
+        printf("must supply:\n  1) number of initial sill levels\n  2) number of initial Mediterranean levels\n  3) output directory\n");
+        printf("and optionally:\n  4) csv file of parameter sets\n");
+        exit(EXIT_FAILURE);
+    }
+    long nzs = std::stol(argv[1]);
+    long nzm = std::stol(argv[2]);
+    std::string dirout = argv[3];
+    //range of initial sill levels [m]
+    double zslo = -100.0, zshi = -1.0;
+    //range of initial Mediterranean levels [m]
+    double zmlo = -1000.0, zmhi = 0.0;
+    //tolerances for reaching a known attractor [m]
+    double tolzs = 0.1, tolzm = 1.0;
+
+    //--------------------------------------------------------------------------
+    // PARAMETER SETS
+
+    std::vector<std::string> cols;
+    std::vector< std::vector<double> > rows;
+    if ( argc == 5 ) {
+        read_csv(argv[4], cols, rows);
+    } else {
+        rows.push_back(std::vector<double>());
+    }
+    std::vector<int> pidx;
+    for (unsigned long j=0; j<cols.size(); j++)
+        pidx.push_back(param_index(cols[j].c_str()));
+
+    //--------------------------------------------------------------------------
+    // MAPS
+
+    std::vector<double> zs = linspace(zslo, zshi, nzs);
+    std::vector<double> zm = linspace(zmlo, zmhi, nzm);
+    std::vector<signed char> cla(nzs*nzm);
+    MscGcvBasin *sys = new MscGcvBasin[nthread];
+    std::string fnout;
+    FILE *ofile;
+    unsigned long nearly;
+
+    printf("\nmapping %lu basin(s) on %ld x %ld grids with %d threads\n",
+        rows.size(), nzs, nzm, nthread);
+    for (unsigned long i=0; i<rows.size(); i++) {
+        //set parameters for every thread
+        for (int k=0; k<nthread; k++) {
+            sys[k].reference();
+            for (unsigned long j=0; j<rows[i].size(); j++)
+                if ( pidx[j] >= 0 )
+                    sys[k].set_param(pidx[j], rows[i][j]);
+        }
+        //classify the grid
+        AttractorSet att(tolzs, tolzm);
+        double ts = omp_get_wtime();
+        basin_map(sys, &att, zs, zm, cla.data(), &nearly);
+        ts = omp_get_wtime() - ts;
+        //summarize
+        long unsigned nsta = 0, nosc = 0, ndes = 0;
+        for (long k=0; k<nzs*nzm; k++) {
+            switch (cla[k]) {
+              case -1: nsta++; break;
+              case  0: nosc++; break;
+              case  1: ndes++; break;
+            }
+        }
+        printf("\nmap %lu finished in %g seconds\n", i, ts);
+        printf("  %g %% stable with eroding sill\n", 100*double(nsta)/(nzs*nzm));
+        printf("  %g %% oscillating\n", 100*double(nosc)/(nzs*nzm));
+        printf("  %g %% stable after cutoff and desiccation\n", 100*double(ndes)/(nzs*nzm));
+        printf("  %lu classifications ended at an already known attractor\n", nearly);
+        att.print();
+        //write the map
+        long long dims[2] = {nzs, nzm};
+        double lims[4] = {zslo, zshi, zmlo, zmhi};
+        double par[NPARAM];
+        for (int j=0; j<NPARAM; j++) par[j] = sys[0].get_param(j);
+        fnout = dirout + "/basin_" + std::to_string(i) + ".bin";
+        check_file_write(fnout.c_str());
+        ofile = fopen(fnout.c_str(), "wb");
+        fwrite("MSCBASIN", 1, 8, ofile);
+        fwrite(dims, sizeof(long long), 2, ofile);
+        fwrite(lims, sizeof(double), 4, ofile);
+        fwrite(par, sizeof(double), NPARAM, ofile);
+        fwrite(cla.data(), 1, cla.size(), ofile);
+        fclose(ofile);
+        printf("map written to: %s\n", fnout.c_str());
+    }
+    delete [] sys;
+
+    return(0);
+}
@@ -0,0 +1,134 @@
+//! \file main_calibrate.cc
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+#include "omp.h"
+
+#include "util.h"
+#include "msc_gcv.h"
+#include "calibrate.h"
+
+//!fits model parameters to target observables (see `calibrate.h`)
+/*!
++ requires two command line arguments, a calibration file and the output directory
++ the calibration file has one setting per line, with `#` starting a comment
+    - `target <observable> <value> <sigma>` adds a target, where the observable is one of `obs_names`
+    - `param <name> <value>` frees a parameter, starting from the given value in the units of `MscGcv::set_param`
+    - `fix <name> <value>` changes a parameter that isn't calibrated from its reference value
+    - `window <zs0> <zm0> <kyr>` sets the initial state and length of the integrations, -60 m, 0 m, and 1000 kyr by default
+    - `tol <tol>` sets the integrator tolerance, 1e-9 by default
+    - `maxit <n>` sets the largest number of iterations, 50 by default
++ progress is printed after every iteration and the fitted parameters and observables are written to `calibration.csv` in the output directory
+*/
+int main (int argc, char **argv) {
+
+    if (argc != 3) {
+        printf("\ninvalid number of command line arguments\n");
+        printf("must supply:\n  1) calibration file\n  2) output directory\n");
+        exit(EXIT_FAILURE);
+    }
+    std::string dirout = argv[2];
+
+    //model object with the fixed parameters
+    MscGcv sys;
+    sys.reference();
+    sys.set_tol(1e-9);
+
+    //read the calibration file
+    std::ifstream ifile(argv[1]);
+    if ( !ifile.is_open() ) {
+        printf("FAILURE: cannot open file %s\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+    std::vector<int> pidx, tidx;
+    std::vector<double> p, tval, tsig;
+    double zs0 = -60.0, zm0 = 0.0, tobs = 1e3*KYRSEC;
+    int maxit = 50;
+    std::string line;
+    while ( std::getline(ifile, line) ) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream ss(line);
+        std::string key, name;
+        if ( !(ss >> key) ) continue;
+        double x, y, z;
+        if ( (key == "target") && (ss >> name >> x >> y) ) {
+            tidx.push_back(obs_index(name.c_str()));
+            tval.push_back(x);
+            tsig.push_back(y);
+            if ( tidx.back() < 0 ) {
+                printf("FAILURE: unknown observable '%s'\n", name.c_str());
+                exit(EXIT_FAILURE);
+            }
+        } else if ( ((key == "param") || (key == "fix")) && (ss >> name >> x) ) {
+            int i = param_index(name.c_str());
+            if ( i < 0 ) {
+                printf("FAILURE: unknown parameter '%s'\n", name.c_str());
+                exit(EXIT_FAILURE);
+            }
+            sys.set_param(i, x);
+            if ( key == "param" ) {
+                pidx.push_back(i);
+                p.push_back(x);
+            }
+        } else if ( (key == "window") && (ss >> x >> y >> z) ) {
+            zs0 = x;
+            zm0 = y;
+            tobs = z*KYRSEC;
+        } else if ( (key == "tol") && (ss >> x) ) {
+            sys.set_tol(x);
+        } else if ( (key == "maxit") && (ss >> x) ) {
+            maxit = (int)x;
+        } else {
+            printf("FAILURE: invalid line in calibration file: %s\n", line.c_str());
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    //set up the calibration
+    Calibration cal(&sys);
+    cal.set_window(zs0, zm0, tobs);
+    for (unsigned long j=0; j<pidx.size(); j++) cal.add_param(pidx[j]);
+    for (unsigned long k=0; k<tidx.size(); k++) cal.add_target(tidx[k], tval[k], tsig[k]);
+    printf("\ncalibrating %lu parameters against %lu targets with %d threads\n",
+        pidx.size(), tidx.size(), omp_get_max_threads());
+
+    //fit
+    double ts = omp_get_wtime();
+    int suc = cal.solve(p.data(), maxit, 1e-6, stdout);
+    ts = omp_get_wtime() - ts;
+    switch (suc) {
+        case 0: printf("converged"); break;
+        case 1: printf("iteration limit reached"); break;
+        default: printf("no step could reduce the misfit");
+    }
+    printf(" after %d iterations and %ld integrations in %g seconds\n",
+        cal.get_nit(), cal.get_ntraj(), ts);
+
+    //final observables
+    double obs[NOBS];
+    double misfit = cal.evaluate(p.data(), obs);
+    printf("misfit = %g\n", misfit);
+    for (unsigned long j=0; j<pidx.size(); j++)
+        printf("  %s = %g\n", param_names[pidx[j]], p[j]);
+    for (unsigned long k=0; k<tidx.size(); k++)
+        printf("  %s = %g (target %g +- %g)\n", obs_names[tidx[k]], obs[tidx[k]], tval[k], tsig[k]);
+
+    //write the fitted parameters and observables
+    std::string fnout = dirout + "/calibration.csv";
+    check_file_write(fnout.c_str());
+    FILE *ofile = fopen(fnout.c_str(), "w");
+    for (int j=0; j<NPARAM; j++) fprintf(ofile, "%s,", param_names[j]);
+    for (int k=0; k<NOBS; k++) fprintf(ofile, "%s,", obs_names[k]);
+    fprintf(ofile, "misfit,success\n");
+    for (unsigned long j=0; j<pidx.size(); j++) sys.set_param(pidx[j], p[j]);
+    for (int j=0; j<NPARAM; j++) fprintf(ofile, "%.10g,", sys.get_param(j));
+    for (int k=0; k<NOBS; k++) fprintf(ofile, "%.10g,", obs[k]);
+    fprintf(ofile, "%g,%d\n", misfit, suc);
+    fclose(ofile);
+    printf("results written to: %s\n", fnout.c_str());
+
+    return(0);
+}
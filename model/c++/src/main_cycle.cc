@@ -0,0 +1,91 @@
+//! \file main_cycle.cc
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+#include "omp.h"
+
+#include "util.h"
+#include "msc_gcv.h"
+#include "cycle.h"
+
+//!finds the limit cycles of a sequence of parameter sets, continuing each cycle into the next set
+/*!
++ requires two command line arguments, a csv file of parameter sets and the output directory
++ columns of the csv file named after model parameters (see `param_names`) override the reference values and other columns are ignored, so rows of `trials.csv` from `sweep.exe` can be used directly
++ if the previous row had a cycle, it is continued to the current row with `CycleSolver::resolve`, which takes a few short integrations
++ otherwise, the row is classified with `has_oscillation` and, if it oscillates, the cycle is found with `CycleSolver::solve` starting from the final state
++ results are written to `cycles.csv` in the output directory, with columns for all model parameters, whether a cycle was found, its period [yr], the section level and crossing sill level [m], the ranges of both levels [m], the Floquet multiplier, and the number of return map evaluations
+*/
+int main (int argc, char **argv) {
+
+    if (argc != 3) {
+        printf("\ninvalid number of command line arguments\n");
+        printf("must supply:\n  1) csv file of parameter sets\n  2) output directory\n");
+        exit(EXIT_FAILURE);
+    }
+    std::string dirout = argv[2];
+
+    //parameter sets
+    std::vector<std::string> cols;
+    std::vector< std::vector<double> > rows;
+    read_csv(argv[1], cols, rows);
+    std::vector<int> pidx;
+    for (unsigned long j=0; j<cols.size(); j++)
+        pidx.push_back(param_index(cols[j].c_str()));
+
+    //model objects, one for classification and one with a tight tolerance for shooting
+    MscGcv sys;
+    MscGcvSection sec;
+    sec.set_tol(1e-10);
+    CycleSolver cyc(&sec);
+
+    //output table
+    std::string fnout = dirout + "/cycles.csv";
+    check_file_write(fnout.c_str());
+    FILE *ofile = fopen(fnout.c_str(), "w");
+    for (int j=0; j<NPARAM; j++) fprintf(ofile, "%s,", param_names[j]);
+    fprintf(ofile, "cycle,period,zsec,zs,zslo,zshi,zmlo,zmhi,multiplier,nmap\n");
+
+    printf("\nfinding cycles for %lu parameter sets\n", rows.size());
+    double ts = omp_get_wtime();
+    bool prev = false;
+    unsigned long ncyc = 0, ncont = 0;
+    for (unsigned long i=0; i<rows.size(); i++) {
+        //set parameters
+        sys.reference();
+        for (unsigned long j=0; j<rows[i].size(); j++)
+            if ( pidx[j] >= 0 )
+                sys.set_param(pidx[j], rows[i][j]);
+        for (int j=0; j<NPARAM; j++) sec.set_param(j, sys.get_param(j));
+        //continue the previous cycle, or classify and start from scratch
+        bool found = false;
+        if ( prev && (cyc.resolve() == 0) ) {
+            found = true;
+            ncont++;
+        } else if ( sys.has_oscillation() == 0 ) {
+            found = (cyc.solve(sys.get_zs_fin(), sys.get_zm_fin()) == 0);
+        }
+        prev = found;
+        if ( found ) ncyc++;
+        //write the row
+        for (int j=0; j<NPARAM; j++) fprintf(ofile, "%g,", sys.get_param(j));
+        if ( found ) {
+            fprintf(ofile, "1,%.10g,%.10g,%.10g,%g,%g,%g,%g,%.8g,%lu\n",
+                cyc.get_period()/YRSEC, sec.zsec, cyc.get_zs(),
+                sec.get_zslo(), sec.get_zshi(), sec.get_zmlo(), sec.get_zmhi(),
+                cyc.get_multiplier(), cyc.get_nmap());
+        } else {
+            fprintf(ofile, "0,nan,nan,nan,nan,nan,nan,nan,nan,%lu\n", cyc.get_nmap());
+        }
+    }
+    fclose(ofile);
+    ts = omp_get_wtime() - ts;
+    printf("finished in %g seconds\n", ts);
+    printf("  %lu cycles found, %lu by continuation\n", ncyc, ncont);
+    printf("table written to: %s\n", fnout.c_str());
+
+    return(0);
+}
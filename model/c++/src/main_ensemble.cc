@@ -0,0 +1,165 @@
+//! \file main_ensemble.cc
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+#include "omp.h"
+
+#include "util.h"
+#include "msc_gcv.h"
+#include "ensemble.h"
+
+//!classifies a Monte Carlo ensemble of parameter sets drawn from distributions, until the class probabilities are known to a target confidence (see `ensemble.h`)
+/*!
++ requires two command line arguments, an ensemble file and the output directory
++ the ensemble file has one setting per line, with `#` starting a comment
+    - `param <name> <distribution> <a> <b> [<lo> <hi>]` makes a parameter uncertain, with a distribution from `dist_names` and its two arguments in the units of `MscGcv::set_param`, optionally bounded to `[lo, hi]`
+    - `fix <name> <value>` changes a parameter that isn't uncertain from its reference value
+    - `seed <n>` sets the seed of the random streams, 1 by default
+    - `initial <zs0> <zm0>` sets the initial state, -60 m and 0 m by default
+    - `halfwidth <h>` sets the largest half-width of the interval of every class probability, 0.02 by default
+    - `confidence <c>` sets the confidence level of the intervals, 0.95 by default
+    - `relerr <r>` also requires the interval of every metric mean to be within a fraction `r` of the mean, which is off by default
+    - `samples <nmin> <nmax>` sets the smallest and largest number of samples, 100 and 100000 by default
+    - `batch <n>` sets the number of samples between checks of the stopping criteria, 256 by default
+    - `period` also finds the period of every oscillating sample's limit cycle by shooting
+    - `reduced` integrates the slow manifold alone where the Mediterranean level is slaved (see `slow.h`)
+    - `hypsometry <file>` uses a tabulated hypsometry (see `hypsometry.h`)
+    - `tol <tol>` sets the integrator tolerance
++ progress is printed after every batch, and the class probabilities and metric statistics are written to `ensemble_classes.csv` and `ensemble_metrics.csv` in the output directory
+*/
+int main (int argc, char **argv) {
+
+    if (argc != 3) {
+        printf("\ninvalid number of command line arguments\n");
+        printf("must supply:\n  1) ensemble file\n  2) output directory\n");
+        exit(EXIT_FAILURE);
+    }
+    std::string dirout = argv[2];
+
+    //model object with the fixed parameters, as in sweep.exe
+    MscGcv sys;
+    sys.reference();
+    sys.n = 0.05;
+    sys.P = 0.6/YRSEC;
+    sys.E = 1.2/YRSEC;
+    sys.R = 4500.0 + 12000.0;
+    Hypsometry *hyps = NULL;
+
+    //read the ensemble file
+    std::ifstream ifile(argv[1]);
+    if ( !ifile.is_open() ) {
+        printf("FAILURE: cannot open file %s\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+    std::vector<ParamDist> dist;
+    uint64_t seed = 1;
+    double zs0 = -60.0, zm0 = 0.0, halfwidth = 0.02, conf = 0.95, relerr = 0.0;
+    long nmin = 100, nmax = 100000, nbatch = 256;
+    bool period = false;
+    std::string line;
+    while ( std::getline(ifile, line) ) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream ss(line);
+        std::string key, name, kind;
+        if ( !(ss >> key) ) continue;
+        double x, y;
+        long m, k;
+        if ( (key == "param") && (ss >> name >> kind >> x >> y) ) {
+            ParamDist d;
+            d.i = param_index(name.c_str());
+            d.kind = dist_index(kind.c_str());
+            d.a = x;
+            d.b = y;
+            d.lo = -INFINITY;
+            d.hi = INFINITY;
+            if ( ss >> x >> y ) {
+                d.lo = x;
+                d.hi = y;
+            }
+            if ( d.i < 0 ) {
+                printf("FAILURE: unknown parameter '%s'\n", name.c_str());
+                exit(EXIT_FAILURE);
+            }
+            if ( d.kind < 0 ) {
+                printf("FAILURE: unknown distribution '%s'\n", kind.c_str());
+                exit(EXIT_FAILURE);
+            }
+            dist.push_back(d);
+        } else if ( (key == "fix") && (ss >> name >> x) ) {
+            int i = param_index(name.c_str());
+            if ( i < 0 ) {
+                printf("FAILURE: unknown parameter '%s'\n", name.c_str());
+                exit(EXIT_FAILURE);
+            }
+            sys.set_param(i, x);
+        } else if ( (key == "seed") && (ss >> m) ) {
+            seed = (uint64_t)m;
+        } else if ( (key == "initial") && (ss >> x >> y) ) {
+            zs0 = x;
+            zm0 = y;
+        } else if ( (key == "halfwidth") && (ss >> x) ) {
+            halfwidth = x;
+        } else if ( (key == "confidence") && (ss >> x) ) {
+            conf = x;
+        } else if ( (key == "relerr") && (ss >> x) ) {
+            relerr = x;
+        } else if ( (key == "samples") && (ss >> m >> k) ) {
+            nmin = m;
+            nmax = k;
+        } else if ( (key == "batch") && (ss >> m) ) {
+            nbatch = m;
+        } else if ( key == "period" ) {
+            period = true;
+        } else if ( key == "reduced" ) {
+            sys.set_reduced(true);
+        } else if ( (key == "hypsometry") && (ss >> name) ) {
+            hyps = new Hypsometry(name.c_str());
+            sys.set_hypsometry(hyps);
+        } else if ( (key == "tol") && (ss >> x) ) {
+            sys.set_tol(x);
+        } else {
+            printf("FAILURE: invalid line in ensemble file: %s\n", line.c_str());
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    //set up the ensemble
+    Ensemble ens(&sys);
+    for (unsigned long j=0; j<dist.size(); j++) ens.add_param(dist[j]);
+    ens.set_seed(seed);
+    ens.set_initial(zs0, zm0);
+    ens.set_period(period);
+    ens.set_stop(halfwidth, conf, nmin, nmax, nbatch, relerr);
+    printf("\nensemble of %lu uncertain parameters with %d threads\n", dist.size(), omp_get_max_threads());
+    for (unsigned long j=0; j<dist.size(); j++)
+        printf("  %s ~ %s(%g, %g)\n", param_names[dist[j].i], dist_names[dist[j].kind], dist[j].a, dist[j].b);
+    printf("stopping at a %g %% interval half-width of %g for every class probability\n", 100*conf, halfwidth);
+
+    //classify
+    double ts = omp_get_wtime();
+    int suc = ens.run(stdout);
+    ts = omp_get_wtime() - ts;
+    const EnsembleStats &st = ens.get_stats();
+    printf("%s after %ld samples in %g seconds\n",
+        (suc == 0) ? "target confidence reached" : "sample limit reached", (long)st.get_n(), ts);
+    for (int k=0; k<NMETRIC; k++) {
+        const RunningStats &s = st.get_stats(k);
+        if ( s.get_n() == 0 ) continue;
+        printf("  %11s: %8ld values  mean %-12g median %-12g [%g, %g] (5-95 %%)\n", metric_names[k],
+            (long)s.get_n(), s.get_mean(), st.get_sketch(k).quantile(0.5),
+            st.get_sketch(k).quantile(0.05), st.get_sketch(k).quantile(0.95));
+    }
+
+    //write the statistics
+    std::string fnclass = dirout + "/ensemble_classes.csv",
+                fnmetric = dirout + "/ensemble_metrics.csv";
+    ens.write(fnclass.c_str(), fnmetric.c_str());
+    printf("results written to: %s and %s\n", fnclass.c_str(), fnmetric.c_str());
+
+    delete hyps;
+
+    return(0);
+}
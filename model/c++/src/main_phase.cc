@@ -0,0 +1,82 @@
+//! \file main_phase.cc
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+#include "omp.h"
+
+#include "util.h"
+#include "msc_gcv.h"
+#include "phase.h"
+
+//!evaluates phase portraits (vector field, divergence, and nullclines) over a dense grid of sill and Mediterranean levels
+/*!
++ requires three command line arguments, the number of sill levels, the number of Mediterranean levels, and the output directory
++ an optional fourth argument is a csv file of parameter sets, like the `trials.csv` file written by `sweep.exe`, with one portrait computed for each row
++ columns of the csv file named after model parameters (see `param_names`) override the reference values and other columns are ignored
++ each portrait is written to `phase_<row>.bin` in the output directory, with the layout described for `phase_portrait`
++ the output can be plotted with `scripts/plot_phase.py`
+*/
+int main (int argc, char **argv) {
+
+    //--------------------------------------------------------------------------
+    // IMPORTANT INPUT VARIABLES
+
+    if ( (argc != 4) && (argc != 5) ) {
+        printf("\ninvalid number of command line arguments\n");
+        printf("must supply:\n  1) number of sill levels\n  2) number of Mediterranean levels\n  3) output directory\n");
+        printf("and optionally:\n  4) csv file of parameter sets\n");
+        exit(EXIT_FAILURE);
+    }
+    long nzs = std::stol(argv[1]);
+    long nzm = std::stol(argv[2]);
+    std::string dirout = argv[3];
+    //range of sill levels [m]
+    double zslo = -300.0, zshi = 0.0;
+    //range of Mediterranean levels [m]
+    double zmlo = -3000.0, zmhi = 0.0;
+
+    //--------------------------------------------------------------------------
+    // PARAMETER SETS
+
+    std::vector<std::string> cols;
+    std::vector< std::vector<double> > rows;
+    if ( argc == 5 ) {
+        read_csv(argv[4], cols, rows);
+    } else {
+        //a single set of reference parameters
+        rows.push_back(std::vector<double>());
+    }
+    //map columns to parameter indices
+    std::vector<int> pidx;
+    for (unsigned long j=0; j<cols.size(); j++)
+        pidx.push_back(param_index(cols[j].c_str()));
+
+    printf("\ncomputing %lu phase portraits on %ld x %ld grids with %d threads\n",
+        rows.size(), nzs, nzm, omp_get_max_threads());
+
+    //--------------------------------------------------------------------------
+    // PORTRAITS
+
+    MscGcv sys;
+    std::string fnout;
+    double ts = omp_get_wtime();
+    for (unsigned long i=0; i<rows.size(); i++) {
+        //set parameters
+        sys.reference();
+        for (unsigned long j=0; j<rows[i].size(); j++)
+            if ( pidx[j] >= 0 )
+                sys.set_param(pidx[j], rows[i][j]);
+        //evaluate and write
+        fnout = dirout + "/phase_" + std::to_string(i) + ".bin";
+        phase_portrait(&sys, zslo, zshi, nzs, zmlo, zmhi, nzm, fnout.c_str());
+        printf("  %s\n", fnout.c_str());
+    }
+    ts = omp_get_wtime() - ts;
+    printf("portraits finished\n  %g seconds total\n  %g seconds per portrait\n",
+        ts, ts/rows.size());
+
+    return(0);
+}
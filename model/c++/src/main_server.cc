@@ -0,0 +1,97 @@
+//! \file main_server.cc
+
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "omp.h"
+
+#include "msc_gcv.h"
+#include "server.h"
+
+//set by SIGINT and SIGTERM
+static volatile sig_atomic_t stop = 0;
+static void handle_stop (int sig) { (void)sig; stop = 1; }
+
+//!classifies batches of parameter sets sent by other programs, keeping its worker threads and model objects alive between batches
+/*!
++ with no arguments, requests are read from stdin and responses are written to stdout until stdin is closed
++ optional flags:
+    - `--socket <path>` listens on a Unix socket instead, serving one connection at a time until interrupted
+    - `--mixed` classifies in single precision first, falling back to double precision only for marginal results (see `mixed.h`)
++ the request and response framing is described in `server.h` and implemented for Python by `scripts/classify_client.py`
++ messages and latency statistics are printed to stderr, keeping stdout for responses
+*/
+int main (int argc, char **argv) {
+
+    //optional flags
+    std::string path;
+    bool mixed = false;
+    for (int k=1; k<argc; k++) {
+        std::string flag = argv[k];
+        if ( (flag == "--socket") && (k+1 < argc) ) {
+            path = argv[++k];
+        } else if ( flag == "--mixed" ) {
+            mixed = true;
+        } else {
+            fprintf(stderr, "\nunknown or incomplete flag '%s'\n", argv[k]);
+            fprintf(stderr, "optional flags:\n  --socket <path>  listen on a Unix socket\n");
+            fprintf(stderr, "  --mixed  single precision classification with double precision fallback\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    //a client that disconnects early shouldn't end the server
+    signal(SIGPIPE, SIG_IGN);
+
+    BatchServer server(mixed);
+    fprintf(stderr, "classification server started with %d threads%s\n",
+        omp_get_max_threads(), mixed ? " and mixed precision" : "");
+
+    if ( path.empty() ) {
+        //serve stdin and stdout
+        server.serve(STDIN_FILENO, STDOUT_FILENO);
+    } else {
+        //listen on a Unix socket
+        struct sockaddr_un addr;
+        if ( path.size() >= sizeof(addr.sun_path) ) {
+            fprintf(stderr, "socket path '%s' is too long\n", path.c_str());
+            exit(EXIT_FAILURE);
+        }
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path.c_str());
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path.c_str());
+        if ( (fd < 0)
+            || (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+            || (listen(fd, 8) != 0) ) {
+            fprintf(stderr, "failed to listen on socket '%s'\n", path.c_str());
+            exit(EXIT_FAILURE);
+        }
+        //interrupting accept ends the server
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = handle_stop;
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+        fprintf(stderr, "listening on '%s'\n", path.c_str());
+        while ( !stop ) {
+            int con = accept(fd, NULL, NULL);
+            if ( con < 0 ) continue;
+            server.serve(con, con);
+            close(con);
+        }
+        close(fd);
+        unlink(path.c_str());
+    }
+
+    server.print_stats(stderr);
+
+    return(0);
+}
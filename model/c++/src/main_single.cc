@@ -5,6 +5,9 @@
 #include "omp.h"
 
 #include "msc_gcv.h"
+#include "cycle.h"
+#include "parareal.h"
+#include "sens.h"
 
 
 //!driver for running a single model integration
@@ -12,8 +15,15 @@
 + input parameters are set inside the function
 + output is written to the `out` directory
 + the output can be plotted with `scripts/plot_out.py`
++ optional flags:
+    - `--tint <kyr>` sets the integration time in thousands of years
+    - `--sens` also integrates the forward sensitivities of the final state to `kb`, `tauc`, `Cw`, `U`, `a`, and `L` (see `sens.h`)
+    - `--hypsometry <file>` uses a tabulated hypsometry, like `../../data/hypsometry.csv`, instead of the two exponential fit (see `hypsometry.h`)
+    - `--forcing <file>` forces `P`, `E`, `R`, and/or `U` with the time series of a forcing table or grid (see `forcing.h`), writing the lookup grid to `out/forcing.bin` so later runs can memory map it, and can't be combined with `--sens` or `--parareal`
+    - `--reduced` integrates the slow manifold alone wherever the Mediterranean level is slaved to the sill level (see `slow.h`), for the trajectory and the classification, and can't be combined with `--forcing`
+    - `--parareal <nslice>` integrates with the parareal algorithm over `nslice` time slices in parallel (see `parareal.h`), comparing the result and wall time to a serial integration, and writes the state at the slice boundaries to `out/parareal.csv` instead of writing the full trajectory
 */
-int main () {
+int main (int argc, char **argv) {
 
     //output directory
     std::string dirout = "out";
@@ -21,9 +31,46 @@ int main () {
     double tint = 1e2*KYRSEC;
     //initial time step
     double dt0 = YRSEC;
+    //number of parareal time slices, zero for serial integration
+    long nslice = 0;
+    //tabulated hypsometry, if any
+    Hypsometry *hyps = NULL;
+    //forcing, if any
+    Forcing *forc = NULL;
+    //whether to compute sensitivities
+    bool sens = false;
+    //whether to reduce the integration on the slow manifold
+    bool reduced = false;
+
+    //optional flags
+    for (int k=1; k<argc; k++) {
+        std::string flag = argv[k];
+        if ( (flag == "--tint") && (k+1 < argc) ) {
+            tint = std::stod(argv[++k])*KYRSEC;
+        } else if ( (flag == "--parareal") && (k+1 < argc) ) {
+            nslice = std::stol(argv[++k]);
+        } else if ( flag == "--sens" ) {
+            sens = true;
+        } else if ( flag == "--reduced" ) {
+            reduced = true;
+        } else if ( (flag == "--hypsometry") && (k+1 < argc) ) {
+            hyps = new Hypsometry(argv[++k]);
+        } else if ( (flag == "--forcing") && (k+1 < argc) ) {
+            forc = new Forcing(argv[++k]);
+        } else {
+            printf("\nunknown or incomplete flag '%s'\n", argv[k]);
+            printf("optional flags:\n  --tint <kyr>  integration time\n");
+            printf("  --parareal <nslice>  parallel-in-time integration\n");
+            printf("  --sens  forward parameter sensitivities\n");
+            printf("  --reduced  fast-slow reduction on the slow manifold\n");
+            printf("  --hypsometry <file>  tabulated hypsometry\n");
+            printf("  --forcing <file>  time series of P, E, R, and/or U\n");
+            exit(EXIT_FAILURE);
+        }
+    }
 
-    //construct a model object
-    MscGcv sys;
+    //construct a model object, integrating the clock only for a forcing
+    MscGcv sys(forc != NULL);
 
     //--------------
     //set parameters
@@ -50,6 +97,33 @@ int main () {
     //input from various rivers [m^3/s]
     sys.R = 4500.0 + 12000.0;
 
+    //hypsometry
+    sys.set_hypsometry(hyps);
+
+    //fast-slow reduction
+    sys.set_reduced(reduced);
+
+    //forcing
+    if ( forc ) {
+        if ( reduced ) {
+            printf("FAILURE: the fast-slow reduction doesn't support forcing\n");
+            exit(EXIT_FAILURE);
+        }
+        if ( sens ) {
+            printf("FAILURE: the sensitivities don't support forcing\n");
+            exit(EXIT_FAILURE);
+        }
+        if ( nslice > 0 ) {
+            printf("FAILURE: the coarse parareal propagator doesn't support forcing\n");
+            exit(EXIT_FAILURE);
+        }
+        sys.set_forcing(forc);
+        std::string fnout = dirout + "/forcing.bin";
+        forc->write(fnout.c_str());
+        printf("\nforcing with %ld cells of %g kyr and %ld jumps written to: %s\n",
+            forc->get_ncell(), forc->get_dt()/KYRSEC, forc->get_njump(), fnout.c_str());
+    }
+
     printf("\nsystem initialized\n");
 
     //------------------------
@@ -59,13 +133,66 @@ int main () {
     sys.set_sol(0, -60); //sill level
     sys.set_sol(1, 0.0); //Mediterranean level
 
-    printf("\nbeginning integration...\n");
-    double tstart = omp_get_wtime();
-    sys.solve_adaptive(tint, dt0, dirout.c_str(), 1);
-    printf("integration finished after\n  %g seconds\n", omp_get_wtime() - tstart);
-    printf("  %li steps\n  %li rejected steps\n\n", sys.get_nstep(), sys.get_nrej());
+    if ( nslice > 0 ) {
+        //serial reference integration
+        printf("\nbeginning serial integration...\n");
+        MscGcv ref;
+        ref.copy_param(sys);
+        ref.set_sol(0, sys.get_sol(0));
+        ref.set_sol(1, sys.get_sol(1));
+        double tser = omp_get_wtime();
+        ref.solve_adaptive(tint, dt0, false);
+        tser = omp_get_wtime() - tser;
+        printf("integration finished after\n  %g seconds\n  %li steps\n", tser, ref.get_nstep());
+        //parallel-in-time integration
+        printf("\nbeginning parareal integration with %li slices and %d threads...\n",
+            nslice, omp_get_max_threads());
+        Parareal par(&sys, nslice);
+        double tpar = omp_get_wtime();
+        int status = par.solve(tint, dt0);
+        tpar = omp_get_wtime() - tpar;
+        if ( status == 2 ) {
+            long k = par.get_kfail();
+            printf("FAILURE: coarse parareal propagator failed in slice %li from zs=%g, zm=%g\n",
+                k, par.get_zs(k), par.get_zm(k));
+            exit(EXIT_FAILURE);
+        }
+        printf("integration %s after\n  %g seconds\n  %d iterations\n",
+            status == 0 ? "converged" : "failed to converge", tpar, par.get_nit());
+        printf("  %li fine steps\n  %li coarse steps\n", par.get_nfine(), par.get_ncoarse());
+        printf("  speedup = %g\n", tser/tpar);
+        printf("  final difference from serial integration:\n");
+        printf("    zs: %g m\n    zm: %g m\n\n",
+            fabs(sys.get_sol(0) - ref.get_sol(0)), fabs(sys.get_sol(1) - ref.get_sol(1)));
+        std::string fnout = dirout + "/parareal.csv";
+        par.write(fnout.c_str());
+        printf("slice boundaries written to: %s\n\n", fnout.c_str());
+    } else {
+        printf("\nbeginning integration...\n");
+        double tstart = omp_get_wtime();
+        sys.solve_adaptive(tint, dt0, dirout.c_str(), 1);
+        printf("integration finished after\n  %g seconds\n", omp_get_wtime() - tstart);
+        printf("  %li steps\n  %li rejected steps\n", sys.get_nstep(), sys.get_nrej());
+        if ( reduced ) printf("  %li reduced steps\n  %li switches to the slow manifold\n", sys.get_nslow(), sys.get_nswitch());
+        printf("\n");
+    }
     sys.print();
 
+    //-------------------------------
+    //forward parameter sensitivities
+
+    if ( sens ) {
+        MscGcvSens se(&sys);
+        se.init(-60, 0.0);
+        double tstart = omp_get_wtime();
+        se.solve_adaptive(tint, dt0, false);
+        printf("\nsensitivities of the final state integrated in %g seconds\n", omp_get_wtime() - tstart);
+        printf("  param | p*dzs/dp [m] | p*dzm/dp [m]\n");
+        printf("  ------|--------------|-------------\n");
+        for (int j=0; j<NSENS; j++)
+            printf("  %5s | %12.6g | %12.6g\n", param_names[j], se.get_sens(0, j), se.get_sens(1, j));
+    }
+
     //----------------------
     //attempt classification
 
@@ -83,19 +210,42 @@ int main () {
             break;
     }
 
+    //--------------------------------------
+    //characterize the limit cycle, if any
+
+    if ( c == 0 ) {
+        //copy parameters into a model object with a tight tolerance for shooting
+        MscGcvSection sec(forc != NULL);
+        sec.copy_param(sys);
+        sec.set_tol(1e-10);
+        CycleSolver cyc(&sec);
+        if ( cyc.solve(sys.get_zs_fin(), sys.get_zm_fin()) == 0 ) {
+            printf("limit cycle found with %lu return map evaluations\n", cyc.get_nmap());
+            printf("  period = %g kyr\n", cyc.get_period()/KYRSEC);
+            printf("  %g < zs < %g m\n", sec.get_zslo(), sec.get_zshi());
+            printf("  %g < zm < %g m\n", sec.get_zmlo(), sec.get_zmhi());
+            printf("  Floquet multiplier = %g\n\n", cyc.get_multiplier());
+        } else {
+            printf("limit cycle not found by shooting\n\n");
+        }
+    }
+
     //---------------------------
     //attempt index approximation
 
-    int rsuc;
-    double rzs, rzm, index;
-    rsuc = sys.has_root(-250.0, -0.5, -1000.0, -0.5, &rzs, &rzm);
-    if ( rsuc == 0 ) {
-        printf("fixed point found at\n  zs = %g\n  zm = %g\n", rzs, rzm);
-        index = sys.index(rzs, rzm);
-        printf("index of fixed point: %g\n\n", index);
+    std::vector<double> rzs, rzm;
+    int nroot = sys.fixed_points(rzs, rzm);
+    if ( nroot > 0 ) {
+        for (int i=0; i<nroot; i++) {
+            printf("fixed point found at\n  zs = %g\n  zm = %g\n", rzs[i], rzm[i]);
+            printf("index of fixed point: %g\n\n", sys.index(rzs[i], rzm[i]));
+        }
     } else {
         printf("no fixed point found\n\n");
     }
 
+    delete hyps;
+    delete forc;
+
     return(0);
 }
@@ -1,6 +1,7 @@
 //! \file main_sweep.cc
 
 #include <string>
+#include <algorithm>
 #include <vector>
 #include <cstdio>
 #include <cstdlib>
@@ -9,12 +10,41 @@
 
 #include "util.h"
 #include "msc_gcv.h"
+#include "variants.h"
+#include "mixed.h"
+#include "fidelity.h"
+#include "cache.h"
+#include "sens.h"
+#include "progress.h"
+#include "marginals.h"
+#include "trials.h"
+#include "atlas.h"
+#include "trace.h"
+#include "plan.h"
 
 //!runs a sweep over ranges of key parameters, searching for oscillatory results
 /*!
 + sweeps over `kb`, `tauc`, `Cw`, `U`, `a`, and `L`
 + requires two command line input arguments, the number of values for each of the varied parameters and the output directory
++ instead of the number of values, the first argument can be the path of a trial list (see `trials.h`), in which case only the listed trials are classified, with their own initial conditions if the list has them
 + each parameter set is tested with the `has_oscillation` method of a `MscGcv` object
++ the classifications are written to `trials.csv`, and for a grid they are also packed into `atlas.bin` for random access (see `atlas.h`) and their two dimensional marginal maps over every pair of swept parameters are accumulated during the sweep and written to `marginals.bin` (see `marginals.h`)
++ optional flags may follow the two required arguments:
+    - `--mixed` classifies in single precision first, falling back to double precision only for marginal results (see `mixed.h`)
+    - `--fidelity` classifies with increasing integration horizons, stopping at the first whose result can be trusted (see `fidelity.h`), and writes the accepted level of every trial to `fidelity.csv`
+    - `--validate <every>` also classifies every trial with an index divisible by `every` at full fidelity, adding the result to `fidelity.csv` and reporting mismatches and the relative cost, which needs `--fidelity`
+    - `--sens <kyr>` also integrates each trial for a fixed time with the forward sensitivities of its final state to the swept parameters (see `sens.h`), writing them to `sensitivities.csv` as `p*dz/dp` in meters
+    - `--erosion <law>` sets the erosion law, which is `pow` for the general power `e^a` by default, or `1`, `1.5`, or `2` for a fixed exponent, which replaces the swept values of `a` with that exponent (see `policy.h` and `variants.h`)
+    - `--width <law>` sets the channel width law, which is `turowski` by default or `constant` for a wide channel with Manning's equation
+    - `--hypsometry <file>` uses a tabulated hypsometry, like `../../data/hypsometry.csv`, instead of the two exponential fit (see `hypsometry.h`)
+    - `--forcing <file>` forces `P`, `E`, `R`, and/or `U` in every trial with the time series of a forcing table or grid (see `forcing.h`), which can't be combined with `--mixed`, `--fidelity`, or `--sens`
+    - `--reduced` integrates the slow manifold alone wherever the Mediterranean level is slaved to the sill level (see `slow.h`), which can't be combined with `--forcing`
+    - `--cache <file>` looks up every trial in a persistent result cache before classifying it and adds new results to the cache afterward (see `cache.h`)
+    - `--trace <every>` records the span of every trial, the idle time of every thread, and the zones inside every trial with an index divisible by `every`, writing them to `trace.json` for `chrome://tracing` or Perfetto (see `trace.h`), which needs the code compiled with `-DMSC_TRACE`
+    - `--plan <npilot>` only plans the sweep, classifying and timing a stratified pilot sample of `npilot` of its trials to predict its core-hours, wall time, peak memory, and output size (see `plan.h`), and writes the pilot trials to `pilot.csv`, which can't be combined with `--sens`, `--validate`, `--cache`, or `--trace`
+    - `--threads <n>` sets the number of threads of the planned sweep, the number of threads of the pilot by default
+    - `--budget <hours>` also finds the largest number of values per parameter whose planned sweep fits within a wall time budget
+    - `--progress <seconds>` sets the interval between progress reports on stderr and in `progress.txt` in the output directory, which is 60 seconds by default, with zero turning reports off (see `progress.h`)
 */
 int main (int argc, char **argv) {
 
@@ -25,25 +55,140 @@ int main (int argc, char **argv) {
     long unsigned i, j, temp, idx, nrow;
     //classification vector
     int *cla;
-    //parameter table
-    double **ptab;
+    //parameter table of a grid
+    double **ptab = NULL;
+    //trial list replacing the grid
+    TrialList *trials = NULL;
     //get number of threads being used
     int nthread = omp_get_max_threads();
-    //array of integrators
-    MscGcv *sys = new MscGcv[nthread];
+    //array of integrators, made once the laws are known
+    MscGcv **sys = new MscGcv*[nthread];
 
     //--------------------------------------------------------------------------
     // IMPORTANT INPUT VARIABLES
 
     //output directory, if provided
-    if (argc != 3) {
+    if (argc < 3) {
         printf("\ninvalid number of command line arguments\n");
-        printf("must supply:\n  1) number of values for each param\n  2) output directory\n");
+        printf("must supply:\n  1) number of values for each param, or a trial list file\n  2) output directory\n");
+        printf("and optionally:\n  --mixed  single precision classification with double precision fallback\n");
+        printf("  --fidelity  classification with increasing horizons\n");
+        printf("  --validate <every>  full fidelity check of every trial with an index divisible by <every>\n");
+        printf("  --sens <kyr>  forward parameter sensitivities after a fixed time\n");
+        printf("  --erosion <pow|1|1.5|2>  erosion law\n");
+        printf("  --width <turowski|constant>  channel width law\n");
+        printf("  --hypsometry <file>  tabulated hypsometry\n");
+        printf("  --forcing <file>  time series of P, E, R, and/or U\n");
+        printf("  --reduced  fast-slow reduction on the slow manifold\n");
+        printf("  --cache <file>  persistent result cache\n");
+        printf("  --progress <seconds>  interval between progress reports, zero for none\n");
+        printf("  --plan <npilot>  plan the sweep from a pilot sample of its trials\n");
+        printf("  --threads <n>  number of threads of the planned sweep\n");
+        printf("  --budget <hours>  wall time budget of the planned sweep\n");
+        printf("  --trace <every>  Chrome trace of the sweep, sampling every trial with an index divisible by <every>\n");
         exit(EXIT_FAILURE);
     }
-    int N = std::stoi(argv[1]);
+    //a number of values for the grid or a trial list
+    int N = 0;
+    std::string arg1 = argv[1];
+    if ( arg1.find_first_not_of("0123456789") == std::string::npos ) {
+        N = std::stoi(arg1);
+    } else {
+        trials = new TrialList(argv[1]);
+        printf("trial list '%s' with %ld trials\n", argv[1], trials->get_nrow());
+    }
     dirout = argv[2];
     printf("output directory = '%s'\n", dirout.c_str());
+    //optional flags
+    bool mixed = false;
+    bool fidelity = false;
+    bool reduced = false;
+    long validate = 0;
+    ResultCache *cache = NULL;
+    Hypsometry *hyps = NULL;
+    Forcing *forc = NULL;
+    double tsens = 0;
+    double tprog = 60;
+    long trace = -1;
+    long npilot = 0;
+    int nplan = nthread;
+    double budget = 0;
+    std::string erosion = ErosionPower::name, width = WidthTurowski::name;
+    for (int k=3; k<argc; k++) {
+        std::string flag = argv[k];
+        if ( flag == "--mixed" ) {
+            mixed = true;
+        } else if ( flag == "--fidelity" ) {
+            fidelity = true;
+        } else if ( flag == "--reduced" ) {
+            reduced = true;
+        } else if ( (flag == "--validate") && (k+1 < argc) ) {
+            validate = std::stol(argv[++k]);
+        } else if ( (flag == "--sens") && (k+1 < argc) ) {
+            tsens = std::stod(argv[++k])*KYRSEC;
+        } else if ( (flag == "--erosion") && (k+1 < argc) ) {
+            erosion = argv[++k];
+        } else if ( (flag == "--width") && (k+1 < argc) ) {
+            width = argv[++k];
+        } else if ( (flag == "--hypsometry") && (k+1 < argc) ) {
+            hyps = new Hypsometry(argv[++k]);
+            printf("tabulated hypsometry from '%s'\n", argv[k]);
+        } else if ( (flag == "--forcing") && (k+1 < argc) ) {
+            forc = new Forcing(argv[++k]);
+            printf("forcing from '%s' with %ld cells and %ld jumps\n", argv[k], forc->get_ncell(), forc->get_njump());
+        } else if ( (flag == "--cache") && (k+1 < argc) ) {
+            cache = new ResultCache(argv[++k]);
+            printf("result cache '%s' with %lu results\n", argv[k], cache->get_nold());
+        } else if ( (flag == "--progress") && (k+1 < argc) ) {
+            tprog = std::stod(argv[++k]);
+        } else if ( (flag == "--plan") && (k+1 < argc) ) {
+            npilot = std::stol(argv[++k]);
+        } else if ( (flag == "--threads") && (k+1 < argc) ) {
+            nplan = std::stoi(argv[++k]);
+        } else if ( (flag == "--budget") && (k+1 < argc) ) {
+            budget = std::stod(argv[++k]);
+        } else if ( (flag == "--trace") && (k+1 < argc) ) {
+            trace = std::stol(argv[++k]);
+            if ( !TRACE_ENABLED ) {
+                printf("FAILURE: --trace needs the code compiled with -DMSC_TRACE\n");
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            printf("\nunknown flag '%s'\n", argv[k]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if ( mixed ) printf("single precision classification with double precision fallback\n");
+    if ( fidelity ) printf("multi-fidelity classification with %d levels\n", NFIDELITY);
+    if ( reduced ) printf("fast-slow reduction on the slow manifold\n");
+    if ( forc && (mixed || fidelity || (tsens > 0)) ) {
+        printf("FAILURE: the single precision and multi-fidelity classifications and the sensitivities don't support forcing\n");
+        exit(EXIT_FAILURE);
+    }
+    if ( forc && reduced ) {
+        printf("FAILURE: the fast-slow reduction doesn't support forcing\n");
+        exit(EXIT_FAILURE);
+    }
+    //fixed erosion exponent, if any
+    double afix = erosion_exponent(erosion.c_str());
+    if ( (erosion != ErosionPower::name) || (width != WidthTurowski::name) )
+        printf("erosion law '%s' and channel width law '%s'\n", erosion.c_str(), width.c_str());
+    if ( mixed && fidelity ) {
+        printf("FAILURE: --mixed and --fidelity can't be combined\n");
+        exit(EXIT_FAILURE);
+    }
+    if ( (validate != 0) && (!fidelity || (validate < 0)) ) {
+        printf("FAILURE: --validate needs --fidelity and a positive interval\n");
+        exit(EXIT_FAILURE);
+    }
+    if ( (npilot < 0) || (nplan < 1) || (budget < 0) ) {
+        printf("FAILURE: --plan, --threads, and --budget need positive values\n");
+        exit(EXIT_FAILURE);
+    }
+    if ( (npilot > 0) && ((tsens > 0) || (validate != 0) || cache || (trace >= 0)) ) {
+        printf("FAILURE: --plan can't be combined with --sens, --validate, --cache, or --trace\n");
+        exit(EXIT_FAILURE);
+    }
 
     //number of parameters to sweep over (must be length of pname and pvec)
     int nparam = 6;
@@ -55,16 +200,40 @@ int main (int argc, char **argv) {
         linspace(25, 100, N), // tauc [Pa]
         linspace(0.5, 10, N), // Cw [?]
         linspace(0.49, 4.9, N), // U [mm/yr
-        linspace(1.0, 2.0, N), // a [-]
+        std::isnan(afix) ? linspace(1.0, 2.0, N) : std::vector<double>(1, afix), // a [-]
         linspace(50e3, 150e3, N), // L [m]
     };
+    //a trial list has its own columns, with the extremes of each as its range
+    if ( trials ) {
+        nparam = trials->get_ncol();
+        pname.clear();
+        pvec.clear();
+        for (int j=0; j<nparam; j++) {
+            pname.push_back(trials->get_name(j));
+            double lo = INFINITY, hi = -INFINITY;
+            for (long k=0; k<trials->get_nrow(); k++) {
+                lo = std::min(lo, trials->get_row(k)[j]);
+                hi = std::max(hi, trials->get_row(k)[j]);
+            }
+            pvec.push_back({lo, hi});
+        }
+    }
     //values of parameters that aren't being varied
     for (int i=0; i<nthread; i++) {
+        //the laws and the hypsometry, shared by all threads
+        sys[i] = new_model(erosion.c_str(), width.c_str(), hyps, forc != NULL);
+        //reference values of the swept parameters that a trial list doesn't have
+        sys[i]->reference();
+        if ( !std::isnan(afix) ) sys[i]->a = afix;
         //set non-varying parameters
-        sys[i].n = 0.05;
-        sys[i].P = 0.6/YRSEC;
-        sys[i].E = 1.2/YRSEC;
-        sys[i].R = 4500.0 + 12000.0;
+        sys[i]->n = 0.05;
+        sys[i]->P = 0.6/YRSEC;
+        sys[i]->E = 1.2/YRSEC;
+        sys[i]->R = 4500.0 + 12000.0;
+        //forcing, shared by all threads
+        sys[i]->set_forcing(forc);
+        //fast-slow reduction
+        sys[i]->set_reduced(reduced);
     }
 
     //print a parameter range summary
@@ -72,50 +241,114 @@ int main (int argc, char **argv) {
     printf("            | min    | max    | count\n");
     printf("------------|--------|--------|-------\n");
     for (int i=0; i<nparam; i++) {
-        printf(" %10s | %6g | %6g | %5d\n",
+        printf(" %10s | %6g | %6g | %5ld\n",
             pname[i].c_str(),
             pvec[i][0],
             pvec[i][pvec[i].size()-1],
-            (int)pvec[i].size()
+            trials ? trials->get_nrow() : (long)pvec[i].size()
         );
     }
 
-    //write parameter values
-    fnout = dirout + "/parameters.txt";
-    check_file_write(fnout.c_str());
-    ofile = fopen(fnout.c_str(), "w");
-    for (i=0; i<pname.size(); i++) {
-        if (i != 0)
-            fprintf(ofile, "\n");
-        fprintf(ofile, "%-16s", pname[i].c_str());
-        for (j=0; j<pvec[i].size(); j++) {
-            fprintf(ofile, " %-16g", pvec[i][j]);
+    //classification settings, with default initial conditions
+    double zs00 = -60.0,
+           zm00 = 0.0,
+           tint = 25*KYRSEC,
+           tlim = 1e8*YRSEC,
+           rootrate = 1e-3/MMYR;
+
+    //--------------------------------------------------------------------------
+    // PLANNING
+
+    if ( npilot > 0 ) {
+        SweepPlan plan(pname, pvec, trials, fidelity);
+        const std::vector<long unsigned> &pil = plan.pilot(npilot);
+        printf("\nplanning the sweep of %lu trials with %lu pilot trials on %d threads\n",
+            plan.get_nrow(), (long unsigned)pil.size(), nthread);
+        double ts = omp_get_wtime();
+        #pragma omp parallel for schedule(dynamic)
+        for (long k=0; k<(long)pil.size(); k++) {
+            int n = omp_get_thread_num();
+            double zs0 = zs00,
+                   zm0 = zm00;
+            if ( trials ) {
+                trials->set(pil[k], sys[n], &zs0, &zm0);
+            } else {
+                std::vector<double> p(nparam);
+                plan.row(pil[k], p.data());
+                sys[n]->kb = p[0]/YRSEC;
+                sys[n]->tauc = p[1];
+                sys[n]->Cw = p[2];
+                sys[n]->U = p[3]/MMYR;
+                sys[n]->a = p[4];
+                sys[n]->L = p[5];
+            }
+            //classify exactly as in the sweep, timing the trial
+            double tc = omp_get_wtime();
+            bool fallback;
+            int lev, osc;
+            if ( mixed ) {
+                osc = has_oscillation_mixed(sys[n], &fallback, zs0, zm0);
+            } else if ( fidelity ) {
+                osc = has_oscillation_fidelity(sys[n], &lev, zs0, zm0, tint, rootrate);
+            } else {
+                osc = sys[n]->has_oscillation(zs0, zm0, tint, tlim, rootrate);
+            }
+            plan.add(k, osc, omp_get_wtime() - tc);
         }
+        printf("pilot finished in %g seconds\n", omp_get_wtime() - ts);
+        fnout = dirout + "/pilot.csv";
+        plan.report(nplan, budget, fnout.c_str());
+        for (int k=0; k<nthread; k++) delete sys[k];
+        delete [] sys;
+        delete trials;
+        delete hyps;
+        delete forc;
+        return(0);
+    }
+
+    //write parameter values of a grid
+    if ( !trials ) {
+        fnout = dirout + "/parameters.txt";
+        check_file_write(fnout.c_str());
+        ofile = fopen(fnout.c_str(), "w");
+        for (i=0; i<pname.size(); i++) {
+            if (i != 0)
+                fprintf(ofile, "\n");
+            fprintf(ofile, "%-16s", pname[i].c_str());
+            for (j=0; j<pvec[i].size(); j++) {
+                fprintf(ofile, " %-16g", pvec[i][j]);
+            }
+        }
+        fprintf(ofile, "\n");
+        fclose(ofile);
+        printf("\nparameter values written to: %s\n", fnout.c_str());
     }
-    fprintf(ofile, "\n");
-    fclose(ofile);
-    printf("\nparameter values written to: %s\n", fnout.c_str());
 
     //--------------------------------------------------------------------------
     // PARAMETER TABLE
 
-    //compute total number of rows
-    nrow = 1;
-    for (i=0; i<pvec.size(); i++)
-        nrow *= pvec[i].size();
-    //allocate table columns
-    ptab = new double*[nrow];
-    for (i=0; i<nrow; i++)
-        ptab[i] = new double[nparam];
-    //fill in all combinations
-    for (i=0; i<nrow; i++) {
-        temp = i;
-        for (j=0; j<pvec.size(); j++) {
-            //find proper index in the parameter vectors
-            idx = temp % pvec[j].size();
-            temp /= pvec[j].size();
-            //set parameter value
-            ptab[i][j] = pvec[j][idx];
+    if ( trials ) {
+        //the rows of a trial list are used in place
+        nrow = trials->get_nrow();
+    } else {
+        //compute total number of rows
+        nrow = 1;
+        for (i=0; i<pvec.size(); i++)
+            nrow *= pvec[i].size();
+        //allocate table columns
+        ptab = new double*[nrow];
+        for (i=0; i<nrow; i++)
+            ptab[i] = new double[nparam];
+        //fill in all combinations
+        for (i=0; i<nrow; i++) {
+            temp = i;
+            for (j=0; j<pvec.size(); j++) {
+                //find proper index in the parameter vectors
+                idx = temp % pvec[j].size();
+                temp /= pvec[j].size();
+                //set parameter value
+                ptab[i][j] = pvec[j][idx];
+            }
         }
     }
 
@@ -124,27 +357,134 @@ int main (int argc, char **argv) {
 
     //results array
     cla = new int[nrow];
+    //final states and sensitivities, if needed
+    double **sens = NULL;
+    if ( tsens > 0 ) {
+        sens = new double*[nrow];
+        for (i=0; i<nrow; i++) sens[i] = new double[NAUG];
+    }
+    //number of mixed precision classifications needing double precision
+    long unsigned nfall = 0;
+    //accepted fidelity level of every trial, and full fidelity results of the validated trials
+    int *lev = NULL, *claf = NULL;
+    if ( fidelity ) {
+        lev = new int[nrow];
+        claf = new int[nrow];
+        for (i=0; i<nrow; i++) {
+            lev[i] = -1;
+            claf[i] = 2;
+        }
+    }
+    //wall time of the validated trials at the accepted and the full fidelity
+    double tval = 0, tfull = 0;
+    //number of results found in the cache
+    long unsigned nhit = 0;
+    //marginal maps over parameter pairs of a grid
+    SweepMarginals *marg = trials ? NULL : new SweepMarginals(pvec, nthread);
     //classify in parallel
     printf("\nstarting %lu classifications with %d threads\n", nrow, nthread);
+    SweepProgress *prog = NULL;
+    if ( tprog > 0 ) {
+        fnout = dirout + "/progress.txt";
+        prog = new SweepProgress(nrow, nthread, tprog, fnout.c_str());
+    }
+    if ( trace >= 0 ) {
+        TRACE_INIT(trace);
+    }
     double ts = omp_get_wtime();
-    #pragma omp parallel for schedule(dynamic)
+    #pragma omp parallel for schedule(dynamic) reduction(+:nfall,nhit,tval,tfull)
     for (i=0; i<nrow; i++) {
         //get the thread number
         int n = omp_get_thread_num();
-        //set varying parameters
-        sys[n].kb =         ptab[i][0]/YRSEC;
-        sys[n].tauc =       ptab[i][1];
-        sys[n].Cw =         ptab[i][2];
-        sys[n].U =          ptab[i][3]/MMYR;
-        sys[n].a =          ptab[i][4];
-        sys[n].L =          ptab[i][5];
-        //classify
-        cla[i] = sys[n].has_oscillation();
+        if ( prog ) prog->start(n, i);
+        TRACE_TRIAL_BEGIN(i);
+        //set varying parameters and the initial condition
+        double zs0 = zs00,
+               zm0 = zm00;
+        if ( trials ) {
+            trials->set(i, sys[n], &zs0, &zm0);
+        } else {
+            sys[n]->kb =         ptab[i][0]/YRSEC;
+            sys[n]->tauc =       ptab[i][1];
+            sys[n]->Cw =         ptab[i][2];
+            sys[n]->U =          ptab[i][3]/MMYR;
+            sys[n]->a =          ptab[i][4];
+            sys[n]->L =          ptab[i][5];
+        }
+        //sensitivities aren't cached
+        if ( sens ) {
+            MscGcvSens se(sys[n]);
+            se.init(zs0, zm0);
+            se.solve_adaptive(tsens, YRSEC, false);
+            for (int k=0; k<NAUG; k++) sens[i][k] = se.get_sol(k);
+        }
+        //look for an earlier result
+        CacheKey key;
+        if ( cache ) {
+            key = cache_key(sys[n], mixed ? CACHE_MIXED : (fidelity ? CACHE_FIDELITY : CACHE_DOUBLE),
+                zs0, zm0, tint, tlim, rootrate);
+            if ( cache->find(key, &cla[i]) ) {
+                TRACE_TRIAL_END();
+                nhit++;
+                if ( prog ) prog->finish(n, cla[i], true);
+                if ( marg ) marg->add(n, i, cla[i]);
+                continue;
+            }
+        }
+        //classify, noting whether the double precision model holds the final cycle
+        bool fallback = true;
+        if ( mixed ) {
+            cla[i] = has_oscillation_mixed(sys[n], &fallback, zs0, zm0);
+            if ( fallback ) nfall++;
+        } else if ( fidelity ) {
+            bool val = (validate > 0) && (i % validate == 0);
+            double tv = omp_get_wtime();
+            cla[i] = has_oscillation_fidelity(sys[n], &lev[i], zs0, zm0, tint, rootrate);
+            if ( val ) {
+                tval += omp_get_wtime() - tv;
+                tv = omp_get_wtime();
+                claf[i] = sys[n]->has_oscillation(zs0, zm0, tint, tlim, rootrate);
+                tfull += omp_get_wtime() - tv;
+            }
+        } else {
+            cla[i] = sys[n]->has_oscillation(zs0, zm0, tint, tlim, rootrate);
+        }
+        if ( marg ) marg->add(n, i, cla[i], fallback ? sys[n]->get_zm_max() - sys[n]->get_zm_min() : NAN);
+        if ( cache ) cache->insert(key, cla[i]);
+        if ( prog ) prog->finish(n, cla[i]);
+        TRACE_TRIAL_END();
     }
+    TRACE_IDLE();
+    for (int k=0; k<nthread; k++) delete sys[k];
     delete [] sys;
+    delete prog;
     ts = omp_get_wtime() - ts;
     printf("classifications finished\n  %g seconds total\n  %g seconds per trial",
         ts, ts/nrow);
+    if ( mixed )
+        printf("\n  %lu trials (%g %%) recomputed in double precision",
+            nfall, 100*double(nfall)/nrow);
+    if ( fidelity ) {
+        printf("\n  trials accepted at each fidelity level:");
+        for (int k=0; k<NFIDELITY; k++) {
+            long unsigned nlev = 0;
+            for (i=0; i<nrow; i++) if ( lev[i] == k ) nlev++;
+            printf("\n    %g yr: %lu (%g %%)", fidelity_tlim[k], nlev, 100*double(nlev)/nrow);
+        }
+    }
+    if ( validate > 0 ) {
+        long unsigned nval = 0, nmis = 0;
+        for (i=0; i<nrow; i++) {
+            if ( claf[i] == 2 ) continue;
+            nval++;
+            if ( claf[i] != cla[i] ) nmis++;
+        }
+        printf("\n  %lu trials validated at full fidelity, %lu mismatches, %g times cheaper",
+            nval, nmis, tfull/tval);
+    }
+    if ( cache )
+        printf("\n  %lu trials (%g %%) found in the result cache",
+            nhit, 100*double(nhit)/nrow);
 
     //--------------------------------------------------------------------------
     // OUTPUT
@@ -174,8 +514,9 @@ int main (int argc, char **argv) {
     for (j=0; j<pname.size(); j++) fprintf(ofile, ",%s", pname[j].c_str());
     fprintf(ofile, ",classification\n");
     for (i=0; i<nrow; i++) {
+        const double *row = trials ? trials->get_row(i) : ptab[i];
         fprintf(ofile, "%lu", i);
-        for (j=0; j<pvec.size(); j++) fprintf(ofile, ",%g", ptab[i][j]);
+        for (j=0; j<pname.size(); j++) fprintf(ofile, ",%g", row[j]);
         fprintf(ofile, ",%d", cla[i]);
         fprintf(ofile, "\n");
     }
@@ -186,11 +527,88 @@ int main (int argc, char **argv) {
     printf("   0 = oscillating solution\n");
     printf("  -1 = stable solution with an eroding sill\n");
 
+    //pack the grid's classifications
+    if ( !trials ) {
+        fnout = dirout + "/atlas.bin";
+        size_t size = Atlas::write(fnout.c_str(), pname, pvec, cla);
+        printf("\natlas of %lu bytes written to: %s\n", (unsigned long)size, fnout.c_str());
+    }
+
+    //write marginal maps
+    if ( marg ) {
+        fnout = dirout + "/marginals.bin";
+        marg->write(fnout.c_str());
+        printf("\nmarginal maps written to: %s\n", fnout.c_str());
+        delete marg;
+    }
+
+    //write the accepted fidelity levels and any full fidelity results
+    if ( fidelity ) {
+        fnout = dirout + "/fidelity.csv";
+        check_file_write(fnout.c_str());
+        ofile = fopen(fnout.c_str(), "w");
+        fprintf(ofile, "trial,level,tlim_yr,classification");
+        if ( validate > 0 ) fprintf(ofile, ",full_classification");
+        fprintf(ofile, "\n");
+        for (i=0; i<nrow; i++) {
+            //cached trials have no level
+            fprintf(ofile, "%lu,%d,%g,%d", i, lev[i], (lev[i] >= 0) ? fidelity_tlim[lev[i]] : NAN, cla[i]);
+            if ( validate > 0 ) {
+                if ( claf[i] == 2 ) fprintf(ofile, ","); else fprintf(ofile, ",%d", claf[i]);
+            }
+            fprintf(ofile, "\n");
+        }
+        fclose(ofile);
+        printf("\nfidelity levels written to: %s\n", fnout.c_str());
+        delete [] lev;
+        delete [] claf;
+    }
+
+    //write the trace
+    if ( trace >= 0 ) {
+        fnout = dirout + "/trace.json";
+        TRACE_WRITE(fnout.c_str());
+        printf("\ntrace written to: %s\n", fnout.c_str());
+    }
+
+    //add new results to the cache
+    if ( cache ) {
+        printf("\n");
+        cache->write();
+        delete cache;
+    }
+
+    //write final states and sensitivities
+    if ( sens ) {
+        fnout = dirout + "/sensitivities.csv";
+        check_file_write(fnout.c_str());
+        ofile = fopen(fnout.c_str(), "w");
+        fprintf(ofile, "trial,zs,zm");
+        for (const char *z : {"zs", "zm"})
+            for (j=0; j<NSENS; j++)
+                fprintf(ofile, ",%s_%s", z, param_names[j]);
+        fprintf(ofile, "\n");
+        for (i=0; i<nrow; i++) {
+            fprintf(ofile, "%lu", i);
+            for (j=0; j<NAUG; j++) fprintf(ofile, ",%g", sens[i][j]);
+            fprintf(ofile, "\n");
+        }
+        fclose(ofile);
+        printf("\nsensitivities after %g kyr written to: %s\n", tsens/KYRSEC, fnout.c_str());
+        for (i=0; i<nrow; i++) delete [] sens[i];
+        delete [] sens;
+    }
+
     //--------------------------------------------------------------------------
 
-    for (i=0; i<nrow; i++) delete [] ptab[i];
-    delete [] ptab;
+    if ( ptab ) {
+        for (i=0; i<nrow; i++) delete [] ptab[i];
+        delete [] ptab;
+    }
+    delete trials;
     delete [] cla;
+    delete hyps;
+    delete forc;
 
     return(0);
 }
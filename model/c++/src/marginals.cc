@@ -0,0 +1,95 @@
+//! \file marginals.cc
+
+#include "marginals.h"
+
+SweepMarginals::SweepMarginals (const std::vector< std::vector<double> > &pvec, int nthread) :
+    pvec_ (pvec),
+    np_ ((int)pvec.size()),
+    nthread_ (nthread) {
+
+    if ( np_ > MARGINALS_MAXPARAM ) {
+        printf("FAILURE: marginal maps of more than %d parameters\n", MARGINALS_MAXPARAM);
+        exit(EXIT_FAILURE);
+    }
+    //lay out the cells of every pair one after another
+    ncell_ = 0;
+    for (int j=0; j<np_; j++) {
+        for (int k=j+1; k<np_; k++) {
+            off_.push_back(ncell_);
+            ncell_ += (long)(pvec_[j].size()*pvec_[k].size());
+        }
+    }
+    count_.resize(nthread);
+    nrange_.resize(nthread);
+    range_.resize(nthread);
+    for (int n=0; n<nthread; n++) {
+        count_[n].assign(ncell_*MARGINALS_NCLASS, 0);
+        nrange_[n].assign(ncell_, 0);
+        range_[n].assign(ncell_, 0.0);
+    }
+}
+
+void SweepMarginals::add (int thread, long unsigned trial, int osc, double range) {
+
+    if ( (osc < -1) || (osc > 1) ) return;
+    //grid index of each parameter, decoded like the parameter table
+    long idx[MARGINALS_MAXPARAM];
+    for (int j=0; j<np_; j++) {
+        idx[j] = trial % pvec_[j].size();
+        trial /= pvec_[j].size();
+    }
+    int64_t *count = count_[thread].data();
+    int64_t *nrange = nrange_[thread].data();
+    double *rsum = range_[thread].data();
+    bool hasrange = (osc == 0) && std::isfinite(range);
+    int p = 0;
+    for (int j=0; j<np_; j++) {
+        for (int k=j+1; k<np_; k++) {
+            long c = off_[p++] + idx[j]*(long)pvec_[k].size() + idx[k];
+            count[c*MARGINALS_NCLASS + osc + 1]++;
+            if ( hasrange ) {
+                nrange[c]++;
+                rsum[c] += range;
+            }
+        }
+    }
+}
+
+void SweepMarginals::write (const char *fn) {
+
+    //sum the threads into the first buffers
+    for (int n=1; n<nthread_; n++) {
+        for (long c=0; c<ncell_*MARGINALS_NCLASS; c++) count_[0][c] += count_[n][c];
+        for (long c=0; c<ncell_; c++) {
+            nrange_[0][c] += nrange_[n][c];
+            range_[0][c] += range_[n][c];
+        }
+        count_[n].assign(ncell_*MARGINALS_NCLASS, 0);
+        nrange_[n].assign(ncell_, 0);
+        range_[n].assign(ncell_, 0.0);
+    }
+
+    //write
+    FILE *ofile;
+    check_file_write(fn);
+    ofile = fopen(fn, "wb");
+    fwrite("MSCMARGS", 1, 8, ofile);
+    int64_t np = np_;
+    fwrite(&np, sizeof(int64_t), 1, ofile);
+    for (int j=0; j<np_; j++) {
+        int64_t n = pvec_[j].size();
+        fwrite(&n, sizeof(int64_t), 1, ofile);
+        fwrite(pvec_[j].data(), sizeof(double), n, ofile);
+    }
+    int p = 0;
+    for (int j=0; j<np_; j++) {
+        for (int k=j+1; k<np_; k++) {
+            long c = off_[p++],
+                 n = (long)(pvec_[j].size()*pvec_[k].size());
+            fwrite(count_[0].data() + c*MARGINALS_NCLASS, sizeof(int64_t), n*MARGINALS_NCLASS, ofile);
+            fwrite(nrange_[0].data() + c, sizeof(int64_t), n, ofile);
+            fwrite(range_[0].data() + c, sizeof(double), n, ofile);
+        }
+    }
+    fclose(ofile);
+}
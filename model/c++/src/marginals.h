@@ -0,0 +1,72 @@
+#ifndef MARGINALS_H_
+#define MARGINALS_H_
+
+//! \file marginals.h
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#include "util.h"
+
+//!number of oscillation codes counted by SweepMarginals, from -1 to 1
+#define MARGINALS_NCLASS 3
+//!largest number of swept parameters in SweepMarginals
+#define MARGINALS_MAXPARAM 32
+
+//!two dimensional marginal maps of the classifications in a parameter sweep, accumulated while the sweep runs
+/*!
+The trials of a sweep form a grid over the swept parameters, with trial index `i` built from the grid indices of the parameters with the first parameter varying fastest, like the parameter table in `main_sweep.cc`. For every pair of swept parameters, the trials are counted by class in each cell of the pair's grid, summing over all the other parameters. For oscillating trials with a known cycle, the Mediterranean level range of the last cycle is also summed in each cell, so the mean range can be mapped too.
+
+Each thread adds to its own buffers, without any locking, and the buffers are summed by write. The file written is
++ the characters "MSCMARGS"
++ int64 number of swept parameters `np`
++ for each parameter, an int64 number of values `n` and the `n` float64 values
++ for each pair of parameters `j < k`, in order of `j` then `k`,
+    - int64 class counts with shape `(n_j, n_k, 3)`, for oscillation codes -1, 0, and 1
+    - int64 counts of oscillating trials with a known range, with shape `(n_j, n_k)`
+    - float64 sums of those ranges [m], with shape `(n_j, n_k)`
+
+so the maps of a sweep with billions of trials take up a few megabytes at most.
+*/
+class SweepMarginals {
+
+public:
+
+    //!constructs with empty maps
+    /*!
+    \param[in] pvec values of each swept parameter
+    \param[in] nthread number of threads adding trials
+    */
+    SweepMarginals (const std::vector< std::vector<double> > &pvec, int nthread);
+
+    //!adds a trial to the maps of the calling thread
+    /*!
+    \param[in] thread OpenMP thread number
+    \param[in] trial index of the trial in the sweep
+    \param[in] osc oscillation code of the trial, from MscGcv::has_oscillation
+    \param[in] range Mediterranean level range over the last cycle of an oscillating trial, or NAN if unknown [m]
+    */
+    void add (int thread, long unsigned trial, int osc, double range=NAN);
+
+    //!sums the maps of all threads and writes them to a file
+    void write (const char *fn);
+
+private:
+
+    //parameter values
+    std::vector< std::vector<double> > pvec_;
+    //number of parameters and threads
+    int np_, nthread_;
+    //offset of each pair's cells in the buffers and total number of cells
+    std::vector<long> off_;
+    long ncell_;
+    //class counts, range counts, and range sums of each thread
+    std::vector< std::vector<int64_t> > count_, nrange_;
+    std::vector< std::vector<double> > range_;
+};
+
+#endif
@@ -0,0 +1,187 @@
+//! \file mixed.cc
+
+#include "mixed.h"
+
+//Dormand-Prince 5(4) tableau
+static const float dpc[7] = {0.0f, 1.0f/5, 3.0f/10, 4.0f/5, 8.0f/9, 1.0f, 1.0f};
+static const float dpa[7][6] = {
+    {0},
+    {1.0f/5},
+    {3.0f/40, 9.0f/40},
+    {44.0f/45, -56.0f/15, 32.0f/9},
+    {19372.0f/6561, -25360.0f/2187, 64448.0f/6561, -212.0f/729},
+    {9017.0f/3168, -355.0f/33, 46732.0f/5247, 49.0f/176, -5103.0f/18656},
+    {35.0f/384, 0.0f, 500.0f/1113, 125.0f/192, -2187.0f/6784, 11.0f/84}
+};
+static const float dpe[7] = {
+    71.0f/57600, 0.0f, -71.0f/16695, 71.0f/1920, -17253.0f/339200, 22.0f/525, -1.0f/40
+};
+
+//adaptive integration over an interval with single precision stages, returning
+//false on failure. The state itself is accumulated in double precision because
+//increments near a fixed point are often smaller than a single precision ulp of
+//the state, which would stall the trajectory short of the fixed point.
+static bool solve_float (MscGcv *sys, double *y, double *t, double tint,
+                         double *dt, double tol) {
+
+    //stage evaluations, with the first stage reused from the last (FSAL)
+    //and stage increments summed in single precision, only added to the state in double
+    float k[7][2], ys[2], inc[2], e;
+    double tend = *t + tint, h, fac, err;
+    bool last;
+
+    ys[0] = float(y[0]);
+    ys[1] = float(y[1]);
+    sys->ode_fun_prec(ys, k[0]);
+    while ( *t < tend ) {
+        //step size, not stepping past the end of the interval
+        h = *dt;
+        last = false;
+        if ( *t + h >= tend ) {
+            h = tend - *t;
+            last = true;
+        }
+        //stages
+        for (int s=1; s<7; s++) {
+            for (int i=0; i<2; i++) {
+                inc[i] = 0.0f;
+                for (int j=0; j<s; j++) inc[i] += dpa[s][j]*k[j][i];
+                ys[i] = float(y[i] + h*inc[i]);
+            }
+            sys->ode_fun_prec(ys, k[s]);
+        }
+        //error estimate
+        err = 0.0;
+        for (int i=0; i<2; i++) {
+            e = 0.0f;
+            for (int j=0; j<7; j++) e += dpe[j]*k[j][i];
+            double ei = fabs(h*e)/(tol*(1.0 + fabs(y[i])));
+            if ( !(ei <= err) ) err = ei;
+        }
+        if ( !std::isfinite(err) ) return(false);
+        //step size adjustment with the same limits as the double precision integrator
+        fac = (err > 0.0) ? 0.9*pow(err, -0.2) : 10.0;
+        fac = min(max(fac, 1e-2), 1e1);
+        if ( err <= 1.0 ) {
+            //accept, the last stage is the new state and its derivative
+            y[0] += h*inc[0];
+            y[1] += h*inc[1];
+            k[0][0] = k[6][0];
+            k[0][1] = k[6][1];
+            *t = last ? tend : *t + h;
+            if ( !last ) *dt = h*fac;
+        } else {
+            *dt = h*fac;
+        }
+    }
+    return(true);
+}
+
+//relative distance between two values, as compared with a threshold by is_close
+static double reldist (double a, double b) {
+    return( max(fabs(a - b)/fabs(a), fabs(a - b)/fabs(b)) );
+}
+
+int has_oscillation_float (MscGcv *sys, bool *marginal,
+                           double zs0, double zm0,
+                           double tint, double tlim,
+                           double rootrate,
+                           double tol, double fmarg, double dzmarg,
+                           double ampmarg, int nsusp) {
+
+    double t, dt, zs, zm, zo, rate, dev, y[2], fout[2], r[2];
+    int rsuc;
+    //all fixed points, found in double precision like has_oscillation does
+    std::vector<double> fixzs, fixzm;
+    int nfix = sys->fixed_points(fixzs, fixzm);
+    //whether any check came close to the fixed point criteria, and whether one
+    //met them in a way that double precision might have too
+    bool suspect = false, nearfix = false;
+    //number of consecutive checks close to the fixed point criteria
+    int nclose = 0;
+    //range of the state over the second half of the integration
+    double zslo = INFINITY, zshi = -INFINITY, zmlo = INFINITY, zmhi = -INFINITY;
+
+    *marginal = false;
+    t = 0.0;
+    y[0] = zs0;
+    y[1] = zm0;
+    //small initial solve to initialize adaptive time step size
+    dt = YRSEC/100;
+    if ( !solve_float(sys, y, &t, YRSEC, &dt, tol) ) {
+        *marginal = true;
+        return(0);
+    }
+    while ( t < tlim ) {
+        //integrate for a time interval of tint
+        if ( !solve_float(sys, y, &t, tint, &dt, tol) ) {
+            *marginal = true;
+            return(0);
+        }
+        //checks are done in double precision
+        zs = y[0];
+        zm = y[1];
+        sys->ode_fun_prec(y, fout);
+        if ( !std::isfinite(fout[0]) || !std::isfinite(fout[1]) ) {
+            *marginal = true;
+            return(0);
+        }
+        //if the sill is above the ocean, it will be forever
+        zo = sys->fzo(zm);
+        if ( (fabs(zs - zo) < dzmarg) || (nearfix && (zs > zo)) ) {
+            *marginal = true;
+            return(1);
+        }
+        if ( zs > zo ) return(1);
+        //track the range of the state late in the integration
+        if ( t > tlim/2 ) {
+            zslo = min(zslo, zs); zshi = max(zshi, zs);
+            zmlo = min(zmlo, zm); zmhi = max(zmhi, zm);
+        }
+        //relative distance to the nearest fixed point
+        dev = INFINITY;
+        for (int k=0; k<nfix; k++)
+            dev = min(dev, max(reldist(fixzs[k], zs), reldist(fixzm[k], zm)));
+        //quick fixed point check
+        rate = max(fabs(fout[0]), fabs(fout[1]));
+        if ( (rate < rootrate*fmarg) || (dev < 1e-4*fmarg) ) {
+            suspect = true;
+            //give up early if single precision can't settle the question
+            if ( ++nclose > nsusp ) {
+                *marginal = true;
+                return(0);
+            }
+        } else {
+            nclose = 0;
+        }
+        if ( rate < rootrate ) {
+            if ( nfix < 0 ) {
+                //fixed points aren't isolated, so try to find a root near the current state
+                r[0] = zs; r[1] = zm;
+                rsuc = sys->solve_Newton(r);
+                if ( rsuc == 0 ) dev = max(reldist(r[0], zs), reldist(r[1], zm));
+            }
+            //the same closeness threshold as is_close in has_oscillation, but a state
+            //within a factor of fmarg of it waits for a check closer to the fixed point
+            if ( dev < 1e-4/fmarg ) return(-1);
+            if ( dev < 1e-4 ) nearfix = true;
+        }
+    }
+
+    //an oscillation is only trusted if the trajectory never came near a fixed
+    //point and its amplitude is too large to be sustained by rounding errors
+    //around a weakly damped fixed point
+    *marginal = suspect || (max(zshi - zslo, zmhi - zmlo) < ampmarg);
+    return(0);
+}
+
+int has_oscillation_mixed (MscGcv *sys, bool *fallback,
+                           double zs0, double zm0) {
+
+    bool marginal;
+    sys->check_policy();
+    int osc = has_oscillation_float(sys, &marginal, zs0, zm0);
+    *fallback = marginal;
+    if ( marginal ) osc = sys->has_oscillation(zs0, zm0);
+    return(osc);
+}
@@ -0,0 +1,56 @@
+#ifndef MIXED_H_
+#define MIXED_H_
+
+//! \file mixed.h
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "util.h"
+#include "msc_gcv.h"
+
+//!classifies a model in single precision, flagging results that are too close to a decision to be trusted
+/*!
+This is the same procedure as MscGcv::has_oscillation, but the integration uses an embedded Dormand-Prince 5(4) scheme whose stages are evaluated in single precision with MscGcv::ode_fun_prec<float>. Only the accumulated state and time are kept in double precision, so the trajectory doesn't stall short of a fixed point when increments fall below single precision resolution. The fixed point checks are done in double precision, because they are rare and cheap, against the same fixed points from MscGcv::fixed_points and with the same closeness threshold as has_oscillation. A result is marginal if
++ the state or its derivatives are not finite
++ a cutoff is found with the sill within `dzmarg` of the ocean level
++ a cutoff is found after a check that met the fixed point criteria with the state within a factor of `fmarg` of the closeness threshold used by has_oscillation, which doesn't decide a fixed point but waits for a closer check
++ no fixed point or cutoff is found, but the larger derivative came within a factor of `fmarg` of `rootrate` at any check, where the double precision trajectory might have satisfied the fixed point checks (including a Newton solve that didn't converge)
++ no fixed point or cutoff is found and the range of both levels over the second half of the integration is less than `ampmarg`, because rounding errors can sustain small oscillations around a weakly damped fixed point
+
+Classifications stop early, as marginal, after `nsusp` consecutive checks near the fixed point criteria without a decision, which are checks with the larger derivative within a factor of `fmarg` of `rootrate` or with the state within a factor of `fmarg` of the closeness threshold. Rounding errors in single precision can keep the derivatives from ever settling below `rootrate` at a fixed point that the double precision trajectory reaches quickly.
+
+\param[in] sys model object with parameters set (its integration state is not changed)
+\param[out] marginal whether the result should be recomputed in double precision
+\param[in] zs0 initial sill level
+\param[in] zm0 initial Mediterranean level
+\param[in] tint shorter integration interval duration
+\param[in] tlim total integration time limit
+\param[in] rootrate maximum magnitude of both time derivatives for assuming stationary state
+\param[in] tol relative and absolute error tolerance of the single precision integrator
+\param[in] fmarg factor defining marginal derivative and closeness comparisons
+\param[in] dzmarg sill to ocean level distance defining a marginal cutoff check [m]
+\param[in] ampmarg oscillation amplitude defining a marginal oscillation [m]
+\param[in] nsusp number of consecutive checks near the fixed point criteria before giving up
+\return oscillation code, as returned by has_oscillation
+*/
+int has_oscillation_float (MscGcv *sys, bool *marginal,
+                           double zs0=-60.0, double zm0=0.0,
+                           double tint=25*KYRSEC, double tlim=1e8*YRSEC,
+                           double rootrate=1e-3/MMYR,
+                           double tol=1e-5, double fmarg=4.0, double dzmarg=0.05,
+                           double ampmarg=0.5, int nsusp=40);
+
+//!classifies a model in single precision and reclassifies in double precision if the result is marginal
+/*!
+\param[in] sys model object with parameters set
+\param[out] fallback whether the double precision classification was needed
+\param[in] zs0 initial sill level
+\param[in] zm0 initial Mediterranean level
+\return oscillation code, as returned by has_oscillation
+*/
+int has_oscillation_mixed (MscGcv *sys, bool *fallback,
+                           double zs0=-60.0, double zm0=0.0);
+
+#endif
@@ -1,15 +1,46 @@
 //! \file msc_gcv.cc
 
-#include "msc_gcv.h"
+#include <algorithm>
 
-MscGcv::MscGcv () :
-    OdeVern65 (2), //ode system of two equations
+#include "msc_gcv_kernel.h"
+#include "trace.h"
+#include "slow.h"
+
+const char *param_names[NPARAM] = {"kb", "tauc", "Cw", "U", "a", "L", "n", "P", "E", "R"};
+
+int param_index (const char *name) {
+    for (int i=0; i<NPARAM; i++)
+        if ( std::string(name) == param_names[i] )
+            return(i);
+    return(-1);
+}
+
+MscGcv::MscGcv (bool clock) :
+    OdeVern65 (clock ? 3 : 2), //ode system of two equations and the clock of the forcing, if any
     Newton (2),    //nonlinear Newton system of the same two equations
     c1 (2.068e12), //fit parameter for fAm() and fzo()
     a1 (2754),     //fit parameter for fAm() and fzo()
     c2 (4.035e11), //fit parameter for fAm() and fzo()
     a2 (127.5),    //fit parameter for fAm() and fzo()
-    Ao (360.0e12) {//area of world ocean without Mediterranean
+    Ao (360.0e12), //area of world ocean without Mediterranean
+    hyps_ (NULL),  //no tabulated hypsometry
+    clock_ (clock),
+    forc_ (NULL),  //no forcing
+    filo_ (0),
+    fihi_ (0),
+    zsfin_ (NAN),
+    zmfin_ (NAN),
+    tfin_ (NAN),
+    classifying_ (false),
+    decided_ (false),
+    next_ (0),
+    zmmax_ (NAN),
+    zmmin_ (NAN),
+    zsmax_ (NAN),
+    reduced_ (false),
+    nslow_ (0),
+    nswitch_ (0),
+    rec_ (NULL) {
 
     //default system name
     set_name("msc_gcv");
@@ -17,6 +48,7 @@ MscGcv::MscGcv () :
     //default initial conditions
     set_sol(0, -60.0); //sill level
     set_sol(0, 0.0); //Mediterranean level
+    if ( clock_ ) set_sol(2, 0.0); //clock
 
     //default properties of built-in adaptive time step selection algorithm
     set_tol(1e-6);
@@ -24,56 +56,203 @@ MscGcv::MscGcv () :
     set_facmax(1e1);
 }
 
+//------------------------------------------------------------------------------
+//parameter access by index
+
+void MscGcv::set_param (int i, double x) {
+    switch (i) {
+        case 0: kb = x/YRSEC; break;
+        case 1: tauc = x; break;
+        case 2: Cw = x; break;
+        case 3: U = x/MMYR; break;
+        case 4: a = x; break;
+        case 5: L = x; break;
+        case 6: n = x; break;
+        case 7: P = x/YRSEC; break;
+        case 8: E = x/YRSEC; break;
+        case 9: R = x; break;
+        default:
+            printf("FAILURE: parameter index %d out of range\n", i);
+            exit(EXIT_FAILURE);
+    }
+}
+
+double MscGcv::get_param (int i) {
+    switch (i) {
+        case 0: return(kb*YRSEC);
+        case 1: return(tauc);
+        case 2: return(Cw);
+        case 3: return(U*MMYR);
+        case 4: return(a);
+        case 5: return(L);
+        case 6: return(n);
+        case 7: return(P*YRSEC);
+        case 8: return(E*YRSEC);
+        case 9: return(R);
+    }
+    printf("FAILURE: parameter index %d out of range\n", i);
+    exit(EXIT_FAILURE);
+}
+
+void MscGcv::reference () {
+    kb = 8e-6/YRSEC;
+    tauc = 50;
+    Cw = 6;
+    U = 4.9/MMYR;
+    a = 1.5;
+    L = 100e3;
+    n = 0.05;
+    P = 0.6/YRSEC;
+    E = 1.2/YRSEC;
+    R = 4500.0 + 12000.0;
+}
+
+void MscGcv::copy_param (const MscGcv &sys) {
+    kb = sys.kb;
+    tauc = sys.tauc;
+    Cw = sys.Cw;
+    U = sys.U;
+    a = sys.a;
+    L = sys.L;
+    n = sys.n;
+    P = sys.P;
+    E = sys.E;
+    R = sys.R;
+    hyps_ = sys.hyps_;
+    set_forcing(sys.forc_);
+}
+
 //------------------------------------------------------------------------------
 //Mediterranean functions
 
-double MscGcv::fAm (double zm) {
-    return( c1*exp(zm/a1) + c2*exp(zm/a2) );
+double MscGcv::fAm (double zm) { return( area_kernel<MscDefault>(zm) ); }
+
+double MscGcv::fzo (double zm) { return( level_kernel<MscDefault>(zm) ); }
+
+double MscGcv::dfAm (double zm) {
+    if ( hyps_ ) return( hyps_->darea(zm) );
+    return( (c1/a1)*exp(zm/a1) + (c2/a2)*exp(zm/a2) );
+}
+
+//------------------------------------------------------------------------------
+//time dependent forcing
+
+void MscGcv::force (double t, double *keep) {
+    double *p[NFORCE] = {&P, &E, &R, &U}, f[NFORCE];
+    forc_->eval(t, f, filo_, fihi_);
+    for (int k=0; k<NFORCE; k++) {
+        keep[k] = *p[k];
+        if ( forc_->forces(k) ) *p[k] = f[k];
+    }
+}
+
+//integrations stop at every jump of the forcing and continue with the current step size, so no step straddles a jump
+void MscGcv::solve_adaptive (double tint, double dt0, bool extra) {
+
+    if ( reduced_ && !forc_ ) {
+        solve_fast_slow(tint, dt0, extra);
+        return;
+    }
+    if ( !forc_ || (forc_->get_njump() == 0) ) {
+        OdeVern65::solve_adaptive(tint, dt0, extra);
+        return;
+    }
+    double tend = get_t() + tint;
+    long j = forc_->next_jump(get_t());
+    while ( get_t() < tend ) {
+        //integrate up to the next jump, or the end, looking up only the cells in between
+        filo_ = (j > 0) ? forc_->get_jump(j-1) : 0;
+        fihi_ = (j < forc_->get_njump()) ? forc_->get_jump(j) - 1 : forc_->get_ncell() - 1;
+        double tb = (j < forc_->get_njump()) ? std::min(forc_->get_tjump(j), tend) : tend;
+        OdeVern65::solve_adaptive(tb - get_t(), dt0, extra);
+        //land exactly on the jump and carry the step size across it
+        set_t(tb);
+        dt0 = get_dt();
+        j++;
+    }
+    filo_ = 0;
+    fihi_ = forc_->get_ncell() - 1;
+}
+
+void MscGcv::solve_adaptive (double tint, double dt0, const char *dirout, int inter) {
+
+    //the same cases as solve_adaptive(double, double, bool) that don't call the integrator directly
+    bool split = (reduced_ && !forc_) || (forc_ && (forc_->get_njump() > 0));
+    if ( !split ) {
+        OdeVern65::solve_adaptive(tint, dt0, dirout, inter);
+        return;
+    }
+    //record every step of the reduced or jump by jump integration, including the initial state, and write every inter-th
+    int w = clock_ ? 4 : 3;
+    std::vector<double> rec = {get_t(), get_sol(0), get_sol(1)};
+    if ( clock_ ) rec.push_back(get_sol(2));
+    rec_ = &rec;
+    solve_adaptive(tint, dt0, true);
+    rec_ = NULL;
+    long nrec = rec.size()/w;
+    for (int k=0; k<w; k++) {
+        std::string fn = std::string(dirout) + "/" + get_name() + "_" + ((k == 0) ? std::string("t") : std::to_string(k-1));
+        check_file_write(fn.c_str());
+        FILE *ofile = fopen(fn.c_str(), "wb");
+        for (long i=0; i<nrec; i++)
+            if ( (i % inter == 0) || (i == nrec - 1) )
+                fwrite(&rec[w*i + k], sizeof(double), 1, ofile);
+        fclose(ofile);
+    }
 }
 
-double MscGcv::fzo (double zm) {
-    return( (c1*a1/Ao)*(1 - exp(zm/a1)) + (c2*a2/Ao)*(1 - exp(zm/a2)) );
+void MscGcv::solve_fast_slow (double tint, double dt0, bool extra) {
+
+    TRACE_ZONE("solve_fast_slow");
+    SlowManifold slow(this);
+    double tend = get_t() + tint, dt = dt0, nprobe = SLOW_PROBE;
+    while ( get_t() < tend ) {
+        //the full system for a few steps, then a check for slaving
+        unsigned long nrej = get_nrej();
+        OdeVern65::solve_adaptive(std::min(nprobe*dt, tend - get_t()), dt, extra);
+        dt = get_dt();
+        if ( decided_ || (get_t() >= tend) ) continue;
+        if ( !slow.enter(get_sol()) ) {
+            //every probe restarts the integrator, which costs about a rejected step
+            //where the step size is held at its stability limit, so probe less often
+            //while the probes fail there
+            nprobe = (get_nrej() > nrej) ? std::min(2*nprobe, SLOW_PROBE_MAX) : SLOW_PROBE;
+            continue;
+        }
+        nprobe = SLOW_PROBE;
+        //the slow manifold until the Mediterranean level is no longer slaved
+        nswitch_++;
+        double t = get_t(), zs = get_sol(0), zm, h = SLOW_PROBE*dt;
+        while ( (t < tend) && (slow.step(&t, &zs, &zm, &h, tend) == 0) ) {
+            nslow_++;
+            set_t(t);
+            set_sol(0, zs);
+            set_sol(1, zm);
+            if ( extra ) after_step(t);
+            //after a decision the state is frozen, as in the full system
+            if ( decided_ ) {
+                set_t(tend);
+                break;
+            }
+        }
+    }
 }
 
 //------------------------------------------------------------------------------
 //system of ODEs
 
-void MscGcv::ode_fun (double *solin, double *fout) {
-
-    double zs, zm, zo, Am, tau, S, Q, T;
-    //label incoming sill and Mediterranean levels
-    zs = solin[0];
-    zm = solin[1];
-    //Mediterranean area and ocean level are functions of zm
-    Am = fAm(zm);
-    zo = fzo(zm);
-    //channel slope
-    /*NOTE:
-    The slope is not allowed to be negative here for numerical reasons.
-    If the model behaves physically, the slope should never be negative because
-    the flow velocity over the sill goes to zero at exactly zo = zm. The basin
-    should never fill above the ocean, not even by a tiny amount. In some cases,
-    however, a tiny negative slope appears somewhere in the time stepping
-    process. This is almost certainly just a numerical inaccuracy that occurs
-    when the Mediterranean is filling extremely rapidly. However, if S is ever
-    a negative number, even a vanishingly small one, it blows up the
-    calculation of Q upon the evaluation of S^(13/14). When a NaN appears
-    there, it carries through all subsequent calculations and the model fails.
-    So, even though it should not be necessary on a physical basis, negative
-    slope values are forced to zero for numerical feasibility. This issue
-    cropped up in lots of different ODE solving algorithms, explicity and
-    implicit, so it is not specific to the algorithm used here.*/
-    S = max((zo - zm)/L, 0.0);
-    //sill shear stress
-    tau = RHO*GRAV*(zo - zs)*S;
-    //bundle of constants
-    T = Cw*pow((tauc + U/kb)/(RHO*GRAV), -3.0/13);
-    //discharge for Turowski width
-    Q = (pow(T, 13.0/7)/n)*pow(max(zo - zs, 0.0), 65.0/21)*pow(S, 13.0/14);
-    //sill level time derivative, accounting for the critical τ threshold
-    fout[0] = (tau > tauc) ? U - kb*pow(tau - tauc, a) : U;
-    //Mediterranean level time derivative
-    fout[1] = P - E + (R + Q)/Am;
+void MscGcv::ode_fun (double *solin, double *fout) { ode_fun_kernel<MscDefault>(solin, fout); }
+
+void MscGcv::rhs (const double *solin, double *fout) { rhs_kernel<MscDefault>(solin, fout); }
+
+void MscGcv::rhs (const float *solin, float *fout) { rhs_kernel<MscDefault>(solin, fout); }
+
+void MscGcv::ode_partials (const double *solin, double dfdx[2][2], double dfdp[2][NSENS]) {
+    partials_kernel<MscDefault>(solin, dfdx, dfdp);
+}
+
+void MscGcv::ode_fun_row (double zm, const double *zs, long nzs, double *dzs, double *dzm) {
+    row_kernel<MscDefault>(zm, zs, nzs, dzs, dzm);
 }
 
 //------------------------------------------------------------------------------
@@ -88,37 +267,353 @@ int MscGcv::has_root (double zslo, double zshi, double zmlo, double zmhi,
     //get vectors of zs and zm values
     std::vector<double> zs = linspace(zslo, zshi, nzs);
     std::vector<double> zm = linspace(zmlo, zmhi, nzm);
+    //the reduced search finds every fixed point at once
+    std::vector<double> fzs, fzm;
+    fixed_points(fzs, fzm);
+    for (unsigned long i=0; i<fzs.size(); i++) {
+        if ( (fzs[i] >= zslo) && (fzs[i] <= zshi) && (fzm[i] >= zmlo) && (fzm[i] <= zmhi) ) {
+            *rzs = fzs[i]; *rzm = fzm[i];
+            return(0);
+        }
+    }
     //allocate an array for the root
     double x[2];
+    //line search setting to restore
+    bool globalized = get_globalized();
     //sweep the grid for roots
     for (int i=0; i<nzs; i++) {
         for (int j=0; j<nzm; j++) {
-            //initial values
-            x[0] = zs[i]; x[1] = zm[j];
-            //attempt to find a root
-            suc = solve_Newton(x);
-            //if successful, set the output and return a success code
-            if ( suc == 0 ) {
-                *rzs = x[0]; *rzm = x[1];
-                return(suc);
+            //attempt to find a root with full steps, then with a line search
+            for (int k=0; k<2; k++) {
+                x[0] = zs[i]; x[1] = zm[j];
+                set_globalized(k == 1);
+                suc = solve_Newton(x);
+                //if successful, set the output and return a success code
+                if ( suc == 0 ) {
+                    set_globalized(globalized);
+                    *rzs = x[0]; *rzm = x[1];
+                    return(suc);
+                }
             }
         }
     }
+    set_globalized(globalized);
     //return the previous failure code
     return(suc);
 }
 
+double MscGcv::fixed_residual (double zm, double *zs) { return( residual_kernel<MscDefault>(zm, zs) ); }
+
+double MscGcv::fixed_refine (double a, double b, double ga, double gb) {
+
+    //Brent's method, as in Numerical Recipes' zbrent
+    double c = b, gc = gb, d = b - a, e = d, zs, tol, m, p, q, r, s;
+    for (int iter=0; iter<100; iter++) {
+        if ( gb*gc > 0 ) {
+            c = a; gc = ga;
+            d = b - a; e = d;
+        }
+        if ( fabs(gc) < fabs(gb) ) {
+            a = b; b = c; c = a;
+            ga = gb; gb = gc; gc = ga;
+        }
+        tol = 4e-16*fabs(b) + 1e-12;
+        m = (c - b)/2;
+        if ( (fabs(m) <= tol) || (gb == 0) ) return(b);
+        if ( (fabs(e) >= tol) && (fabs(ga) > fabs(gb)) ) {
+            //inverse quadratic interpolation, or secant if only two points differ
+            s = gb/ga;
+            if ( a == c ) {
+                p = 2*m*s;
+                q = 1 - s;
+            } else {
+                q = ga/gc;
+                r = gb/gc;
+                p = s*(2*m*q*(q - r) - (b - a)*(r - 1));
+                q = (q - 1)*(r - 1)*(s - 1);
+            }
+            if ( p > 0 ) q = -q; else p = -p;
+            if ( 2*p < min(3*m*q - fabs(tol*q), fabs(e*q)) ) {
+                e = d;
+                d = p/q;
+            } else {
+                d = m;
+                e = d;
+            }
+        } else {
+            //bisection
+            d = m;
+            e = d;
+        }
+        a = b; ga = gb;
+        b += (fabs(d) > tol) ? d : ((m > 0) ? tol : -tol);
+        gb = fixed_residual(b, &zs);
+    }
+    return(b);
+}
+
+//with positive uplift, the sill is only stationary where erosion balances uplift,
+//at the stress tauc + (U/kb)^(1/a). At any Mediterranean level below the ocean,
+//that stress fixes the depth over the sill, the sill level, and the discharge, so
+//the fixed points are the roots of the volume balance G(zm) = (P - E)*Am + R + Q
+//alone. G is sampled in depth below sea level, sign changes are refined by Brent's
+//method, and local minima of |G| are searched for hidden pairs of roots.
+int MscGcv::fixed_points (std::vector<double> &zs, std::vector<double> &zm,
+                          double zmlo, int nsub) {
+
+    TRACE_ZONE("fixed_points");
+    zs.clear();
+    zm.clear();
+    //without uplift, any sill level under subcritical stress is stationary
+    if ( !(U > 0) ) return(-1);
+    //sample levels spaced logarithmically in depth, from zmlo up to a millimeter below sea level
+    std::vector<double> d = logspace(log10(-zmlo), -3.0, nsub + 1),
+                        g(nsub + 1);
+    std::vector<double> roots;
+    double zsr;
+    for (int i=0; i<=nsub; i++) g[i] = fixed_residual(-d[i], &zsr);
+    for (int i=0; i<nsub; i++) {
+        //a sign change brackets a root
+        if ( g[i]*g[i+1] <= 0 ) {
+            if ( g[i] == 0 ) roots.push_back(-d[i]);
+            else if ( g[i+1] != 0 ) roots.push_back(fixed_refine(-d[i], -d[i+1], g[i], g[i+1]));
+            continue;
+        }
+        //a local minimum of |G| between samples may hide a pair of roots
+        if ( (i > 0) && (g[i-1]*g[i] > 0) && (fabs(g[i]) < fabs(g[i-1])) && (fabs(g[i]) <= fabs(g[i+1])) ) {
+            //golden section search for the minimum of |G| on the neighboring intervals
+            const double w = 0.381966011250105;
+            double sg = (g[i] > 0) ? 1 : -1,
+                   a = -d[i-1], b = -d[i+1],
+                   x = -d[i], gx = sg*g[i],
+                   u, gu = gx;
+            for (int iter=0; iter<60; iter++) {
+                bool right = (b - x) > (x - a);
+                u = right ? x + w*(b - x) : x - w*(x - a);
+                gu = sg*fixed_residual(u, &zsr);
+                if ( gu < 0 ) break;
+                if ( gu < gx ) {
+                    if ( right ) a = x; else b = x;
+                    x = u; gx = gu;
+                } else {
+                    if ( right ) b = u; else a = u;
+                }
+                if ( fabs(b - a) < 1e-12*fabs(x) + 1e-12 ) break;
+            }
+            //if the residual changes sign, both roots are bracketed
+            if ( gu < 0 ) {
+                roots.push_back(fixed_refine(-d[i-1], u, g[i-1], sg*gu));
+                roots.push_back(fixed_refine(u, -d[i+1], sg*gu, g[i+1]));
+            }
+        }
+    }
+    //the residual grows without bound toward sea level, so a negative value at
+    //the highest sample brackets one more root above it
+    if ( g[nsub] < 0 ) {
+        double lo = -d[nsub], glo = g[nsub], hi = lo/10, ghi = fixed_residual(hi, &zsr);
+        while ( (ghi < 0) && (hi < 0) ) {
+            lo = hi; glo = ghi;
+            hi /= 10;
+            ghi = fixed_residual(hi, &zsr);
+        }
+        if ( ghi >= 0 ) roots.push_back(fixed_refine(lo, hi, glo, ghi));
+    }
+    //sort, since the roots of the hidden pairs may be found after their neighbors
+    std::sort(roots.begin(), roots.end());
+    for (unsigned long i=0; i<roots.size(); i++) {
+        if ( (i > 0) && (roots[i] == roots[i-1]) ) continue;
+        fixed_residual(roots[i], &zsr);
+        zs.push_back(zsr);
+        zm.push_back(roots[i]);
+    }
+    return( (int)zm.size() );
+}
+
+void MscGcv::f_Newton (double *x, double *f) { newton_kernel<MscDefault>(x, f); }
+
+//evaluates a cubic Hermite polynomial and its time derivative at fraction u of a step of length h
+static void hermite (double u, double h,
+                     const double *ya, const double *fa,
+                     const double *yb, const double *fb,
+                     double *y, double *dy) {
+    double u2 = u*u, u3 = u2*u;
+    for (int i=0; i<2; i++) {
+        y[i] = (2*u3 - 3*u2 + 1)*ya[i] + (u3 - 2*u2 + u)*h*fa[i]
+             + (-2*u3 + 3*u2)*yb[i] + (u3 - u2)*h*fb[i];
+        dy[i] = ((6*u2 - 6*u)*ya[i] + (3*u2 - 4*u + 1)*h*fa[i]
+              + (-6*u2 + 6*u)*yb[i] + (3*u2 - 2*u)*h*fb[i])/h;
+    }
+}
+
+double MscGcv::emergence (double t) {
+
+    TRACE_ZONE("emergence");
+    double ya[3] = {zsp_, zmp_, tp_}, yb[3] = {get_sol(0), get_sol(1), t},
+           fa[3], fb[3], y[2], dy[2], h = t - tp_,
+           ulo = 0, uhi = 1, u;
+    ode_fun(ya, fa);
+    ode_fun(yb, fb);
+    //bisect zs - zo, which is negative at the previous step and positive now
+    for (int i=0; i<60; i++) {
+        u = (ulo + uhi)/2;
+        hermite(u, h, ya, fa, yb, fb, y, dy);
+        if ( y[0] > fzo(y[1]) ) uhi = u; else ulo = u;
+    }
+    hermite(uhi, h, ya, fa, yb, fb, y, dy);
+    zsfin_ = y[0];
+    zmfin_ = y[1];
+    return(tp_ + uhi*h);
+}
+
+double MscGcv::extremum (double t) {
+
+    //vertex of the parabola through the last three steps, which bracket the extremum
+    double zm = get_sol(1),
+           h1 = tp_ - tpp_,
+           h2 = t - tp_;
+    if ( (h1 <= 0) || (h2 <= 0) ) return(zmp_);
+    double s1 = (zmp_ - zmpp_)/h1,
+           s2 = (zm - zmp_)/h2,
+           c = (s2 - s1)/(t - tpp_);
+    if ( c == 0 ) return(zmp_);
+    double tv = (tpp_ + tp_)/2 - s1/(2*c);
+    tv = min(max(tv, tpp_), t);
+    double zv = zmpp_ + (tv - tpp_)*(s1 + c*(tv - tp_));
+    //never less extreme than the step at the turn
+    return( (dirzm_ > 0) ? max(zv, zmp_) : min(zv, zmp_) );
+}
+
+void MscGcv::after_step (double t) {
+
+    if ( rec_ ) {
+        rec_->push_back(t);
+        rec_->push_back(get_sol(0));
+        rec_->push_back(get_sol(1));
+        if ( clock_ ) rec_->push_back(get_sol(2));
+    }
+    if ( !classifying_ || decided_ ) return;
+    TRACE_STEP(get_nrej());
+    double zs = get_sol(0),
+           zm = get_sol(1);
+
+    //if the sill is above the ocean, it will be forever
+    if ( zs > fzo(zm) ) {
+        tfin_ = emergence(t);
+        osc_ = 1;
+        decided_ = true;
+        return;
+    }
+
+    //extrema of the Mediterranean level
+    int dir = (zm > zmp_) ? 1 : ((zm < zmp_) ? -1 : dirzm_);
+    if ( (dirzm_ != 0) && (dir != dirzm_) ) {
+        if ( dirzm_ > 0 ) {
+            zmmax_ = extremum(t);
+            zsmax_ = zsp_;
+        } else {
+            zmmin_ = extremum(t);
+        }
+        next_++;
+    }
+    dirzm_ = dir;
+
+    //store the last two steps for interpolation
+    tpp_ = tp_;
+    zspp_ = zsp_;
+    zmpp_ = zmp_;
+    tp_ = t;
+    zsp_ = zs;
+    zmp_ = zm;
+}
+
+void MscGcv::watch () {
+
+    tp_ = tpp_ = get_t();
+    zsp_ = zspp_ = get_sol(0);
+    zmp_ = zmpp_ = get_sol(1);
+    dirzm_ = 0;
+}
+
+void MscGcv::solve_interval (double tint, double dt0, bool watched) {
+
+    double t0 = get_t(),
+           zs0 = get_sol(0),
+           zm0 = get_sol(1);
+    solve_adaptive(tint, dt0, watched);
+    if ( watched || (get_sol(0) <= fzo(get_sol(1))) ) return;
+    //the sill emerged somewhere in the interval, so integrate it again from the
+    //same state and step size, taking the same steps, and find it
+    set_t(t0);
+    set_sol(0, zs0);
+    set_sol(1, zm0);
+    watch();
+    solve_adaptive(tint, dt0, true);
+}
+
+void MscGcv::check () {
+
+    TRACE_ZONE_ARG("check", "t_kyr", get_t()/KYRSEC);
+    double t = get_t(),
+           zs = get_sol(0),
+           zm = get_sol(1);
+    //a cutoff the steps didn't resolve, which shouldn't happen
+    if ( zs > fzo(zm) ) {
+        osc_ = 1;
+        decided_ = true;
+    //stop if an attractor with a known outcome has been reached
+    } else if ( known_attractor(zs, zm, &osc_) ) {
+        decided_ = true;
+    } else {
+        //quick fixed point check against 1 micron/year rate of change
+        double fout[3];
+        ode_fun(get_sol(), fout);
+        if ( (fabs(fout[0]) < rootrate_) && (fabs(fout[1]) < rootrate_) ) {
+            //with forcing, the fixed points are those of the parameters frozen at their current values
+            double keep[NFORCE];
+            if ( forc_ ) {
+                force(t, keep);
+                nfix_ = fixed_points(fixzs_, fixzm_);
+            }
+            //check if the system is very near a fixed pt
+            if ( nfix_ >= 0 ) {
+                for (int k=0; k<nfix_; k++)
+                    if ( is_close(fixzs_[k], zs) && is_close(fixzm_[k], zm) )
+                        decided_ = true;
+            } else {
+                //fixed points aren't isolated, so try to find a root near the current state
+                double r[2] = {zs, zm};
+                int rsuc = solve_Newton(r);
+                if ( (rsuc == 0) && is_close(r[0], zs) && is_close(r[1], zm) )
+                    decided_ = true;
+            }
+            if ( forc_ ) unforce(keep);
+            if ( decided_ ) osc_ = -1;
+        }
+    }
+    if ( decided_ ) {
+        zsfin_ = zs;
+        zmfin_ = zm;
+        tfin_ = t;
+    }
+}
+
+//the integration is chunked into intervals of tint, as it always was, with the
+//fixed point and known attractor checks at their ends, and events are watched
+//by after_step only where they're needed, since a call on every step costs
+//about 5% of a long oscillating trial. Emergence of the sill is permanent, so
+//an interval ending with the sill above the ocean is integrated again, watching
+//its steps, to stop at the exact crossing. The extrema of the Mediterranean
+//level are only wanted for the last cycle, so they're found over the last
+//intervals. After a decision, the right-hand side is frozen so the integrator
+//reaches the end of the interval in a few cheap steps.
 int MscGcv::has_oscillation (double zs0, double zm0,
                              double tint, double tlim,
                              double rootrate) {
 
-    //labels
-    double zs, zm, dzs, dzm;
-    double fout[2];
+    TRACE_ZONE("has_oscillation");
     double tprev, zsprev, zmprev;
-    //root finding variables
-    int rsuc;
-    double r[2];
+
+    check_policy();
 
     //store current state
     tprev = get_t();
@@ -130,41 +625,49 @@ int MscGcv::has_oscillation (double zs0, double zm0,
     set_sol(0, zs0);
     set_sol(1, zm0);
 
-    int osc = 0; //initialize to zero, which indicates oscillations
-    //small initial solve to initialize adaptive time step size
-    solve_adaptive(YRSEC, YRSEC/100, false);
-    while ( get_t() < tlim ) {
-        //integrate for a time interval of tint
-        solve_adaptive(tint, get_dt(), false);
-        //label the current solution
-        zs = get_sol(0);
-        zm = get_sol(1);
-        //get the current derivatives
-        ode_fun(get_sol(), fout);
-        dzs = fout[0];
-        dzm = fout[1];
-        //if the sill is above the ocean, it will be forever
-        if ( zs > fzo(zm) ) {
-            osc = 1;
-            break;
-        }
-        //quick fixed point check against 1 micron/year rate of change
-        ode_fun(get_sol(), fout); //evaluate current derivatives
-        if ( (fabs(dzs) < rootrate) && (fabs(dzm) < rootrate) ) {
-            //try to find a root near the current state
-            r[0] = zs; r[1] = zm;
-            rsuc = solve_Newton(r);
-            //check if the system is very near a fixed pt, if one was found
-            if ( rsuc == 0 ) {
-                if ( is_close(r[0], zs) && is_close(r[1], zm) ) {
-                    osc = -1;
-                    break;
-                }
-            }
-        }
+    //all fixed points, for the checks, unless they change with the forcing
+    if ( !forc_ ) nfix_ = fixed_points(fixzs_, fixzm_);
+
+    //start watching for events
+    classifying_ = true;
+    decided_ = false;
+    osc_ = 0; //initialize to zero, which indicates oscillations
+    rootrate_ = rootrate;
+    next_ = 0;
+    zmmax_ = NAN;
+    zmmin_ = NAN;
+    zsmax_ = NAN;
 
+    //number of check intervals through the last check at or after tlim, and
+    //the first one whose steps are watched for extrema
+    long nint = (long)ceil((tlim - YRSEC)/tint),
+         nwatch = (long)(WATCH_FRAC*nint);
+    if ( nwatch < WATCH_MIN ) nwatch = WATCH_MIN;
+    long iwatch = nint - nwatch;
+#ifdef MSC_TRACE
+    //every step is watched, so the trace records them all
+    iwatch = 0;
+#endif
+
+    //small initial solve to initialize adaptive time step size
+    TRACE_STEP_RESET(get_nrej());
+    watch();
+    solve_interval(YRSEC, YRSEC/100, iwatch <= 0);
+    for (long i=0; (i<nint) && !decided_; i++) {
+        if ( i == iwatch ) watch();
+        solve_interval(tint, get_dt(), i >= iwatch);
+        if ( !decided_ ) check();
     }
 
+    //store the final state if no decision was made
+    if ( !decided_ ) {
+        zsfin_ = get_sol(0);
+        zmfin_ = get_sol(1);
+        tfin_ = get_t();
+    }
+    //stop watching and unfreeze the right-hand side
+    classifying_ = false;
+    decided_ = false;
     //put things back where they were found
     set_t(tprev);
     set_sol(0, zsprev);
@@ -174,7 +677,7 @@ int MscGcv::has_oscillation (double zs0, double zm0,
     //  1 = sill above ocean, no oscillation
     //  0 = oscillation
     // -1 = fixed pt with sill below ocean, steady flow, no oscillation
-    return(osc);
+    return(osc_);
 }
 
 double MscGcv::index (double zs, double zm, double r) {
@@ -194,7 +697,7 @@ double MscGcv::index (double zs, double zm, double r) {
         z[0] = zs + r*cos(theta);
         z[1] = zm + r*sin(theta);
         //vector components
-        ode_fun(z, v);
+        ode_fun_prec(z, v);
         //angle of components
         phi[i] = atan2(v[1], v[0]);
     }
@@ -7,6 +7,20 @@ This code is a simplified, consolidated, C++ implementation of a prior Messinian
 
 The equations and variables of the model are implemented in the `msc_gcv.h` and `msc_gcv.cc` files as a class called MscGcv. The `linalg.cc` and `newton.cc` files contain standard numerical algorithms used by the model. The `util.cc` file has some miscellaneous useful functions. Finally, the `main_single.cc` and `main_sweep.cc` files are two separate driver files. They are compiled by the Makefile into `bin/single.exe` and `bin/sweep.exe`. The `single.exe` program runs a single integration of the model, writes output into the `out` directory, and attempts to find and display the model's fixed point. The results of `single.exe` can be plotted with `scripts/plot_out.py`. The `sweep.exe` file runs, in parallel, a grid of many integrations over ranges of key parameters, testing whether the model oscillates. The model runs on top of ODE integrators from [libode](https://github.com/wordsworthgroup/libode).
 
+Model options of both drivers:
++ `--hypsometry <file>` replaces the two exponential fit of the hypsometry with a table like `data/hypsometry.csv` (see `hypsometry.h`)
++ `--forcing <file>` forces `P`, `E`, `R`, and `U` with time series (see `forcing.h`)
++ `--reduced` integrates only the sill level wherever the Mediterranean level is slaved to it (see `slow.h`)
+
+Other drivers, each compiled from its `main_*.cc` file:
++ `bin/phase.exe` evaluates the vector field, divergence, and nullclines over a grid of levels (see `phase.h`), plotted by `scripts/plot_phase.py`
++ `bin/basin.exe` classifies a grid of initial conditions for one set of parameters (see `basin.h`)
++ `bin/cycle.exe` finds limit cycles by shooting and continues them through parameter sets (see `cycle.h`)
++ `bin/server.exe` classifies batches of parameter sets sent over stdin or a socket (see `server.h` and `scripts/classify_client.py`)
++ `bin/atlas.exe` looks up points and slices in the packed classifications of a sweep (see `atlas.h`)
++ `bin/calibrate.exe` fits parameters to observables like the time of isolation (see `calibrate.h`)
++ `bin/ensemble.exe` classifies Monte Carlo ensembles of uncertain parameters (see `ensemble.h`)
+
 Basic steps to compile the code:
 1. download and compile [libode](https://github.com/wordsworthgroup/libode)
 2. copy/rename the `_config.mk` file `config.mk`, getting rid of the leading underscore
@@ -21,6 +35,10 @@ To run `single.exe` and plot the results:
   python plot_out.py
   cd ..
 \endcode
+Long integrations with `single.exe` can be run in parallel over time slices with the parareal algorithm (see `parareal.h`), here over 10 million years in 48 slices:
+\code{.sh}
+  ./bin/single.exe --tint 10000 --parareal 48
+\endcode
 
 To run `sweep.exe`:
 \code{.sh}
@@ -30,6 +48,29 @@ To run `sweep.exe`:
   cd ..
 \endcode
 replacing N with the number of values to use for each varied parameter.
+
+Options and outputs of `sweep.exe`:
++ a trial list in place of N classifies only the listed trials (see `trials.h`), written by `scripts/write_trials.py`
++ `--fidelity` classifies with increasing horizons (see `fidelity.h`), and `--validate <every>` checks a sample against the full horizon
++ `--erosion` and `--width` select model variants with other laws (see `policy.h` and `variants.h`)
++ `--cache <file>` reuses the results of earlier sweeps (see `cache.h`)
++ `--progress <seconds>` sets the interval of the progress report in `out/progress.txt` (see `progress.h`)
++ `--trace <every>` writes a Chrome trace to `out/trace.json` when compiled with `-DMSC_TRACE` (see `trace.h`)
++ `--plan <npilot>` predicts the cost of the sweep from a pilot sample, with `--threads <n>` and `--budget <hours>` (see `plan.h`)
++ `out/marginals.bin` has the classifications over every pair of varied parameters (see `marginals.h`), plotted by `scripts/plot_marginals.py`
++ `out/atlas.bin` packs the classifications for `bin/atlas.exe` and `scripts/read_atlas.py` (see `atlas.h`):
+\code{.sh}
+  ./bin/atlas.exe point out/atlas.bin kb=1e-6 tauc=50 Cw=5 U=2 a=1.5 L=1e5
+  ./bin/atlas.exe slice out/atlas.bin out/slice.csv kb U tauc=50 Cw=5 a=1.5 L=1e5
+\endcode
+
+To compute a 1000 x 1000 phase portrait with the reference parameters and plot it:
+\code{.sh}
+  ./bin/phase.exe 1000 1000 out
+  cd scripts
+  python plot_phase.py
+  cd ..
+\endcode
 */
 
 #ifndef MSC_GCV_H_
@@ -43,6 +84,9 @@ replacing N with the number of values to use for each varied parameter.
 
 #include "util.h"
 #include "newton.h"
+#include "hypsometry.h"
+#include "forcing.h"
+#include "policy.h"
 
 //header file for ODE integrator class
 #include "ode_vern_65.h"
@@ -59,13 +103,34 @@ replacing N with the number of values to use for each varied parameter.
 #define GRAV 9.8
 //!water density [kg/m^3]
 #define RHO 1000.0
+//!number of model parameters
+#define NPARAM 10
+//!number of leading model parameters with analytic sensitivities
+#define NSENS 6
+//!fewest check intervals at the end of MscGcv::has_oscillation whose steps are watched for the Mediterranean level extrema
+#define WATCH_MIN 4
+//!fraction of the check intervals at the end of MscGcv::has_oscillation whose steps are watched for the Mediterranean level extrema, if more than WATCH_MIN
+#define WATCH_FRAC 0.1
+
+//!names of the model parameters, in the order used by MscGcv::set_param and MscGcv::get_param
+extern const char *param_names[NPARAM];
+
+//!finds the index of a parameter name in param_names
+/*!
+\param[in] name parameter name
+\return index of the parameter or -1 if the name is not a model parameter
+*/
+int param_index (const char *name);
 
 class MscGcv : public OdeVern65, public Newton {
 
 public:
 
     //!constructs
-    MscGcv ();
+    /*!
+    \param[in] clock whether to integrate the time as a third equation, which the forcing needs and which is left out otherwise because it costs every step
+    */
+    MscGcv (bool clock=false);
 
     //-----------------
     //system parameters
@@ -91,6 +156,20 @@ public:
     //!input from non-Gibraltar rivers [m^3/s]
     double R;
 
+    //!sets a parameter by its index in param_names
+    /*!
+    Values are in the units used by the driver tables, where `kb` is in m/yr*Pa^a, `U` is in mm/yr, `P` and `E` are in m/yr, and all other parameters are in the same units as the class members.
+    \param[in] i index of the parameter
+    \param[in] x value of the parameter in table units
+    */
+    void set_param (int i, double x);
+    //!gets a parameter by its index in param_names, in the units used by set_param
+    double get_param (int i);
+    //!sets all parameters to the reference values used in `main_single.cc`
+    void reference ();
+    //!copies all parameters, exactly, and the hypsometry from another model object
+    void copy_param (const MscGcv &sys);
+
     //----------------------------------
     //Mediterranean area and ocean level
 
@@ -99,6 +178,45 @@ public:
     //!computes ocean level from Mediterranean level
     double fzo (double zm);
 
+    //!sets a tabulated hypsometry used by fAm and fzo instead of the two exponential fit, or NULL for the fit, without copying it
+    void set_hypsometry (const Hypsometry *hyps) { hyps_ = hyps; }
+    //!gets the tabulated hypsometry, which is NULL when the two exponential fit is used
+    const Hypsometry *get_hypsometry () { return(hyps_); }
+
+    //-------------------------
+    //time dependent forcing
+
+    //!sets time series of `P`, `E`, `R`, and `U` replacing those parameters during integrations, or NULL for constant parameters, without copying it, which needs a model constructed with the clock
+    void set_forcing (const Forcing *forc) {
+        if ( forc && !clock_ ) {
+            printf("FAILURE: forcing needs a model constructed with the clock\n");
+            exit(EXIT_FAILURE);
+        }
+        forc_ = forc;
+        filo_ = 0;
+        fihi_ = forc ? forc->get_ncell() - 1 : 0;
+    }
+    //!gets the forcing table, which is NULL when the parameters are constant
+    const Forcing *get_forcing () { return(forc_); }
+
+    //!sets the time, keeping the clock of the forcing in step
+    void set_t (double t) { OdeVern65::set_t(t); if ( clock_ ) set_sol(2, t); }
+
+    using OdeVern65::solve_adaptive;
+    //!integrates with adaptive time steps, restarting at every jump of the forcing and reducing if set_reduced is on
+    void solve_adaptive (double tint, double dt0, bool extra=true);
+    //!integrates like the other overload, writing every `inter` steps to files in `dirout`
+    void solve_adaptive (double tint, double dt0, const char *dirout, int inter=1);
+
+    //!turns the fast-slow reduction of unforced integrations on or off, off by default (see SlowManifold)
+    void set_reduced (bool reduced) { reduced_ = reduced; }
+    //!gets whether integrations are reduced on the slow manifold
+    bool get_reduced () { return(reduced_); }
+    //!number of steps on the slow manifold since construction, which get_nstep doesn't count
+    long get_nslow () { return(nslow_); }
+    //!number of switches from the full system to the slow manifold since construction
+    long get_nswitch () { return(nswitch_); }
+
     //-------------------------
     //slope for modified system
 
@@ -108,13 +226,42 @@ public:
     //--------------
     //system of ODEs
 
-    //!implements the system of ODEs, computing time derivatives
+    //!implements the system of ODEs, computing time derivatives of both levels and of the clock, if there is one
+    /*!
+    The level derivatives are zero after a decision inside has_oscillation, which clears it before returning.
+    */
     void ode_fun (double *solin, double *fout);
 
+    //!implements the system of ODEs for both levels in double or single precision (see `mixed.h`), without forcing
+    template<typename T> void ode_fun_prec (const T *solin, T *fout) { rhs(solin, fout); }
+
+    //!computes the partial derivatives of ode_fun analytically, with respect to the levels and the first NSENS parameters in SI units
+    /*!
+    \param[in] solin sill and Mediterranean levels
+    \param[out] dfdx derivatives of both time derivatives with respect to sill and Mediterranean levels
+    \param[out] dfdp derivatives of both time derivatives with respect to the parameters
+    */
+    virtual void ode_partials (const double *solin, double dfdx[2][2], double dfdp[2][NSENS]);
+
+    //!evaluates both time derivatives along a row of sill levels at a single Mediterranean level, vectorized over the row
+    /*!
+    \param[in] zm Mediterranean level of the row
+    \param[in] zs array of sill levels
+    \param[in] nzs length of the zs array
+    \param[out] dzs sill level time derivatives
+    \param[out] dzm Mediterranean level time derivatives
+    */
+    virtual void ode_fun_row (double zm, const double *zs, long nzs, double *dzs, double *dzm);
+
+    //!identifies the policies of the right-hand side, zero for MscDefault and any other policies giving the same results (see MscPolicy::id)
+    virtual int get_policy () { return(0); }
+    //!checks that the parameters and hypsometry suit the policies of the right-hand side, stopping the program if they don't, called at the start of every classification
+    virtual void check_policy () {}
+
     //----------------------------------------------
     //finding fixed pts and checking for oscillation
 
-    //!executes Newton's method over a grid of points to find a fixed point
+    //!finds a fixed point, first among those of fixed_points and then by Newton's method over a grid of points
     /*!
     \param[in] zslo lowest sill level in grid
     \param[in] zshi highest sill level in grid
@@ -129,7 +276,18 @@ public:
     int has_root (double zslo, double zshi,
                   double zmlo, double zmhi,
                   double *rzs, double *rzm,
-                  int nzs=50, int nzm=50);
+                  int nzs=3, int nzm=3);
+
+    //!finds all fixed points by reducing the system to a single equation in the Mediterranean level
+    /*!
+    \param[out] zs sill levels of the fixed points, in increasing order of Mediterranean level
+    \param[out] zm Mediterranean levels of the fixed points, in increasing order
+    \param[in] zmlo lowest Mediterranean level searched
+    \param[in] nsub number of sampling intervals
+    \return number of fixed points found, or -1 if the uplift rate isn't positive and the sill levels of fixed points aren't unique
+    */
+    int fixed_points (std::vector<double> &zs, std::vector<double> &zm,
+                      double zmlo=-5000.0, int nsub=64);
 
     //!integrates for a very long period, checking model state after shorter intervals to determine if it is stable or oscillating
     /*!
@@ -154,16 +312,137 @@ public:
     */
     double index (double zs, double zm, double r=0.01);
 
+    //!gets the sill level at the end of the most recent has_oscillation call
+    double get_zs_fin () { return(zsfin_); }
+    //!gets the Mediterranean level at the end of the most recent has_oscillation call
+    double get_zm_fin () { return(zmfin_); }
+    //!gets the time at the end of the most recent has_oscillation call, which is the exact time of sill emergence for a cutoff
+    double get_t_fin () { return(tfin_); }
+    //!gets the number of Mediterranean level extrema found in the watched intervals at the end of the most recent has_oscillation call (see WATCH_FRAC)
+    long get_nzm_extrema () { return(next_); }
+    //!gets the most recent maximum of the Mediterranean level found by has_oscillation, or NAN
+    double get_zm_max () { return(zmmax_); }
+    //!gets the most recent minimum of the Mediterranean level found by has_oscillation, or NAN
+    double get_zm_min () { return(zmmin_); }
+    //!gets the sill level at the most recent maximum of the Mediterranean level found by has_oscillation, or NAN
+    double get_zs_at_zm_max () { return(zsmax_); }
+
+    //!sets the relative and absolute error tolerance of the adaptive integrator, remembering it for get_tol
+    void set_tol (double tol) { tol_ = tol; OdeVern65::set_tol(tol); }
+    //!gets the error tolerance of the adaptive integrator
+    double get_tol () { return(tol_); }
+
     //!prints zo, zs, zm
     void print ();
 
+protected:
+
+    //!checks whether a state belongs to an attractor that has already been classified, called by has_oscillation at every check
+    /*!
+    \param[in] zs sill level
+    \param[in] zm Mediterranean level
+    \param[out] osc oscillation code of the attractor, if one is found
+    \return whether the state belongs to a known attractor
+    */
+    virtual bool known_attractor (double zs, double zm, int *osc) {
+        (void)zs; (void)zm; (void)osc;
+        return(false);
+    }
+
+    //!right-hand side of the policies in double precision, for ode_fun_prec
+    virtual void rhs (const double *solin, double *fout);
+    //!right-hand side of the policies in single precision, for ode_fun_prec
+    virtual void rhs (const float *solin, float *fout);
+    //!volume balance of the Mediterranean at a fixed point with the given Mediterranean level, also giving the fixed point's sill level
+    virtual double fixed_residual (double zm, double *zs);
+    //!implements system of equations for Newton solver, with the same roots as ode_fun
+    void f_Newton (double *x, double *f);
+
+    //the functions above for a set of policies, defined in msc_gcv_kernel.h and instantiated for MscDefault in msc_gcv.cc and for the other policies in variants.cc
+    //!the time derivatives of all three equations for a set of policies, with forcing and the freezing after a decision
+    template<class Policy> void ode_fun_kernel (double *solin, double *fout);
+    //!the time derivatives of both levels for a set of policies, in a chosen precision
+    template<class Policy, typename T> void rhs_kernel (const T *solin, T *fout);
+    //!Mediterranean area for a set of policies
+    template<class Policy, typename T> T area_kernel (T zm);
+    //!ocean level for a set of policies
+    template<class Policy, typename T> T level_kernel (T zm);
+    //!ode_partials for a set of policies
+    template<class Policy> void partials_kernel (const double *solin, double dfdx[2][2], double dfdp[2][NSENS]);
+    //!ode_fun_row for a set of policies
+    template<class Policy> void row_kernel (double zm, const double *zs, long nzs, double *dzs, double *dzm);
+    //!fixed_residual for a set of policies
+    template<class Policy> double residual_kernel (double zm, double *zs);
+    //!f_Newton for a set of policies
+    template<class Policy> void newton_kernel (double *x, double *f);
+
+    //!watches for events on the watched steps of has_oscillation, doing nothing at other times
+    /*!
+    Derived classes overriding this function must call it.
+    \param[in] t current time
+    */
+    void after_step (double t);
+
 private:
 
     //params for Mediterranean area and ocean level
     const double c1, a1, c2, a2, Ao;
+    //tabulated hypsometry replacing the fit
+    const Hypsometry *hyps_;
+
+    //whether the time is integrated as a third equation, the forcing table, and the range of its cells between the jumps around the current integration
+    bool clock_;
+    const Forcing *forc_;
+    long filo_, fihi_;
+    //replaces the forced parameters by their values at a time, keeping the constant values
+    void force (double t, double *keep);
+    //restores the constant values of the forced parameters
+    void unforce (const double *keep) { P = keep[0]; E = keep[1]; R = keep[2]; U = keep[3]; }
+
+    //derivative of Mediterranean area with respect to level
+    double dfAm (double zm);
+
+    //state at the end of the most recent classification
+    double zsfin_, zmfin_, tfin_;
+
+    //classification in progress and its settings
+    bool classifying_;
+    double rootrate_;
+    //decision, after which the right-hand side is frozen until the classification ends
+    bool decided_;
+    int osc_;
+    //previous two steps and the direction of the Mediterranean level over the last one
+    double tp_, zsp_, zmp_, tpp_, zspp_, zmpp_;
+    int dirzm_;
+    //fixed points, found once per classification
+    int nfix_;
+    std::vector<double> fixzs_, fixzm_;
+    //Mediterranean level extrema
+    long next_;
+    double zmmax_, zmmin_, zsmax_;
+    //finds the exact time of a sign change of zs - zo between the previous and current steps
+    double emergence (double t);
+    //finds the extremum of the Mediterranean level from the last three steps
+    double extremum (double t);
+    //starts watching the steps for events from the current state
+    void watch ();
+    //integrates a check interval, watching its steps or, if not, integrating it again watching them if the sill emerged
+    void solve_interval (double tint, double dt0, bool watched);
+    //makes the fixed point and known attractor checks at the end of a check interval, and catches a cutoff missed by the steps
+    void check ();
+
+    //integrator tolerance
+    double tol_;
+
+    //fast-slow reduction, its statistics, and the trajectory being recorded, if any
+    bool reduced_;
+    long nslow_, nswitch_;
+    std::vector<double> *rec_;
+    //integrates, switching between the full system and the slow manifold
+    void solve_fast_slow (double tint, double dt0, bool extra);
 
-    //implements system of equations for Newton solver by calling ode_fun
-    void f_Newton (double *x, double *f) { ode_fun(x, f); }
+    //refines a root of fixed_residual in a bracketing interval with Brent's method
+    double fixed_refine (double a, double b, double ga, double gb);
 
 };
 
@@ -0,0 +1,217 @@
+#ifndef MSC_GCV_KERNEL_H_
+#define MSC_GCV_KERNEL_H_
+
+//! \file msc_gcv_kernel.h
+
+/*
+Definitions of the right-hand side of MscGcv for any set of policies (see
+policy.h). They are included only by the files instantiating them, msc_gcv.cc
+for MscDefault and variants.cc for the others, so every other file sees them as
+ordinary member functions. With the policies fixed at compile time, the laws
+are inlined and the branches on them are removed, and the MscDefault versions
+are the same arithmetic, in the same order, as the original model.
+*/
+
+#include "msc_gcv.h"
+
+template<class Policy, typename T> T MscGcv::area_kernel (T zm) {
+    if ( (Policy::Hyps::table == 1) || ((Policy::Hyps::table == 2) && hyps_) )
+        return( T(hyps_->area(zm)) );
+    return( T(c1)*std::exp(zm/T(a1)) + T(c2)*std::exp(zm/T(a2)) );
+}
+
+template<class Policy, typename T> T MscGcv::level_kernel (T zm) {
+    if ( (Policy::Hyps::table == 1) || ((Policy::Hyps::table == 2) && hyps_) )
+        return( T(hyps_->volume(zm)/Ao) );
+    return( T(c1*a1/Ao)*(1 - std::exp(zm/T(a1))) + T(c2*a2/Ao)*(1 - std::exp(zm/T(a2))) );
+}
+
+template<class Policy> void MscGcv::ode_fun_kernel (double *solin, double *fout) {
+    //the clock, if any
+    if ( clock_ ) fout[2] = 1.0;
+    //after a decision inside has_oscillation, let the integrator finish quickly
+    if ( classifying_ && decided_ ) {
+        fout[0] = 0.0;
+        fout[1] = 0.0;
+        return;
+    }
+    if ( forc_ ) {
+        double keep[NFORCE];
+        force(solin[2], keep);
+        rhs_kernel<Policy>(solin, fout);
+        unforce(keep);
+    } else {
+        rhs_kernel<Policy>(solin, fout);
+    }
+}
+
+template<class Policy, typename T> void MscGcv::rhs_kernel (const T *solin, T *fout) {
+
+    typedef typename Policy::Erosion Ero;
+    typedef typename Policy::Width Wid;
+    T zs, zm, zo, Am, tau, S, Q, Tc, h;
+    //label incoming sill and Mediterranean levels
+    zs = solin[0];
+    zm = solin[1];
+    //Mediterranean area and ocean level are functions of zm
+    Am = area_kernel<Policy>(zm);
+    zo = level_kernel<Policy>(zm);
+    //channel slope
+    /*NOTE:
+    The slope is not allowed to be negative here for numerical reasons.
+    If the model behaves physically, the slope should never be negative because
+    the flow velocity over the sill goes to zero at exactly zo = zm. The basin
+    should never fill above the ocean, not even by a tiny amount. In some cases,
+    however, a tiny negative slope appears somewhere in the time stepping
+    process. This is almost certainly just a numerical inaccuracy that occurs
+    when the Mediterranean is filling extremely rapidly. However, if S is ever
+    a negative number, even a vanishingly small one, it blows up the
+    calculation of Q upon the evaluation of S^(13/14). When a NaN appears
+    there, it carries through all subsequent calculations and the model fails.
+    So, even though it should not be necessary on a physical basis, negative
+    slope values are forced to zero for numerical feasibility. This issue
+    cropped up in lots of different ODE solving algorithms, explicity and
+    implicit, so it is not specific to the algorithm used here.*/
+    S = (zo - zm)/T(L);
+    S = (S > 0) ? S : 0;
+    //sill shear stress
+    tau = T(RHO*GRAV)*(zo - zs)*S;
+    //bundle of constants
+    Tc = T(Wid::coef(Cw, (tauc + U/kb)/(RHO*GRAV)));
+    //discharge over the sill
+    h = (zo - zs > 0) ? zo - zs : 0;
+    Q = Wid::scale(Tc, T(n))*Wid::depth(h)*Wid::slope(S);
+    //sill level time derivative, accounting for the critical τ threshold
+    fout[0] = (tau > T(tauc)) ? T(U) - T(kb)*Ero::rate(tau - T(tauc), T(a)) : T(U);
+    //Mediterranean level time derivative
+    fout[1] = T(P) - T(E) + (T(R) + Q)/Am;
+}
+
+template<class Policy> void MscGcv::partials_kernel (const double *solin, double dfdx[2][2], double dfdp[2][NSENS]) {
+
+    typedef typename Policy::Erosion Ero;
+    typedef typename Policy::Width Wid;
+    double zs, zm, zo, Am, dzo, dAm, S, dS, h, tau, Tc, Q, B;
+    zs = solin[0];
+    zm = solin[1];
+    //Mediterranean area, ocean level, and their derivatives
+    Am = area_kernel<Policy>(zm);
+    dAm = dfAm(zm);
+    zo = level_kernel<Policy>(zm);
+    dzo = -Am/Ao; //ocean rises by the volume lost from the Mediterranean
+    //slope, clipped as in ode_fun
+    S = (zo - zm)/L;
+    dS = (dzo - 1)/L;
+    if ( S <= 0 ) {
+        S = 0;
+        dS = 0;
+    }
+    //water depth over sill and shear stress
+    h = zo - zs;
+    tau = RHO*GRAV*h*S;
+    //discharge and its constant
+    B = tauc + U/kb;
+    Tc = Wid::coef(Cw, B/(RHO*GRAV));
+    Q = (h > 0) ? Wid::scale(Tc, n)*Wid::depth(h)*Wid::slope(S) : 0;
+
+    //sill level derivative
+    for (int j=0; j<NSENS; j++) dfdp[0][j] = 0;
+    dfdp[0][3] = 1; //U
+    dfdx[0][0] = 0;
+    dfdx[0][1] = 0;
+    if ( tau > tauc ) {
+        double e = tau - tauc,
+               ea = Ero::rate(e, a),
+               g = kb*a*ea/e; //derivative of kb*e^a with respect to e
+        dfdx[0][0] = g*RHO*GRAV*S;
+        dfdx[0][1] = -g*RHO*GRAV*(dzo*S + h*dS);
+        dfdp[0][0] = -ea;          //kb
+        dfdp[0][1] = g;            //tauc
+        dfdp[0][4] = -kb*ea*log(e); //a
+        dfdp[0][5] = g*tau/L;      //L, with S proportional to 1/L
+    }
+
+    //Mediterranean level derivative, through the discharge and area
+    dfdx[1][0] = 0;
+    dfdx[1][1] = -(R + Q)*dAm/(Am*Am);
+    for (int j=0; j<NSENS; j++) dfdp[1][j] = 0;
+    if ( Q > 0 ) {
+        //logarithmic derivatives of Q
+        double dQs = -Wid::eh/h,
+               dQm = Wid::eh*dzo/h + ((S > 0) ? Wid::eS*dS/S : 0),
+               dTc = Wid::eB/B; //per unit change of B
+        dfdx[1][0] = Q*dQs/Am;
+        dfdx[1][1] += Q*dQm/Am;
+        dfdp[1][0] = Q*dTc*(-U/(kb*kb))/Am; //kb
+        dfdp[1][1] = Q*dTc/Am;              //tauc
+        dfdp[1][2] = Q*Wid::eC/(Cw*Am);     //Cw
+        dfdp[1][3] = Q*dTc/(kb*Am);         //U
+        dfdp[1][5] = -Q*Wid::eS/(L*Am);     //L
+    }
+}
+
+template<class Policy> void MscGcv::row_kernel (double zm, const double *zs, long nzs,
+                                                double *dzs, double *dzm) {
+
+    typedef typename Policy::Erosion Ero;
+    typedef typename Policy::Width Wid;
+    double zo, Am, S, T, Qc, tauS;
+    //everything that depends only on zm
+    Am = area_kernel<Policy>(zm);
+    zo = level_kernel<Policy>(zm);
+    S = max((zo - zm)/L, 0.0); //see NOTE in ode_fun
+    tauS = RHO*GRAV*S;
+    T = Wid::coef(Cw, (tauc + U/kb)/(RHO*GRAV));
+    Qc = Wid::scale(T, n)*Wid::slope(S);
+    //vectorizable loop over sill levels, without calls to max()
+    #pragma omp simd
+    for (long i=0; i<nzs; i++) {
+        double h = zo - zs[i];
+        double tau = tauS*h;
+        double Q = Qc*Wid::depth((h > 0.0) ? h : 0.0);
+        dzs[i] = (tau > tauc) ? U - kb*Ero::rate(tau - tauc, a) : U;
+        dzm[i] = P - E + (R + Q)/Am;
+    }
+}
+
+template<class Policy> double MscGcv::residual_kernel (double zm, double *zs) {
+
+    typedef typename Policy::Erosion Ero;
+    typedef typename Policy::Width Wid;
+    double zo, Am, S, h, Tc, Q;
+    Am = area_kernel<Policy>(zm);
+    zo = level_kernel<Policy>(zm);
+    S = (zo - zm)/L;
+    //water depth over the sill where erosion balances uplift
+    h = (tauc + Ero::inverse(U/kb, a))/(RHO*GRAV*S);
+    *zs = zo - h;
+    //discharge, as in ode_fun
+    Tc = Wid::coef(Cw, (tauc + U/kb)/(RHO*GRAV));
+    Q = Wid::scale(Tc, n)*Wid::depth(h)*Wid::slope(S);
+    return( (P - E)*Am + R + Q );
+}
+
+template<class Policy> void MscGcv::newton_kernel (double *x, double *f) {
+
+    /*
+    The time derivatives themselves are poor functions for Newton's method.
+    Wherever the shear stress is below the critical value, the sill rises at
+    exactly the uplift rate and the Jacobian is singular, and the Mediterranean
+    level derivative varies by orders of magnitude with the exponential basin
+    area. Instead, the sill equation is written as the difference between the
+    shear stress and the stress where erosion balances uplift, which is linear
+    in the sill level, and the Mediterranean equation is multiplied by the
+    basin area to make it a volume balance [m^3/s]. The roots are unchanged.
+    */
+    double zs, zm, zo, Am, S;
+    zs = x[0];
+    zm = x[1];
+    Am = area_kernel<Policy>(zm);
+    zo = level_kernel<Policy>(zm);
+    S = max((zo - zm)/L, 0.0); //see NOTE in ode_fun
+    rhs_kernel<Policy>(x, f);
+    f[0] = RHO*GRAV*(zo - zs)*S - (tauc + Policy::Erosion::inverse(U/kb, a));
+    f[1] *= Am;
+}
+
+#endif
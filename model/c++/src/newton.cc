@@ -1,6 +1,7 @@
 //! \file newton.cc
 
 #include "newton.h"
+#include "trace.h"
 
 Newton::Newton (unsigned long n) {
 
@@ -36,6 +37,15 @@ Newton::Newton (unsigned long n) {
     //default adjustment factors for numerical jacobian
     absjacdel_ = 1e-7;
     reljacdel_ = 1e-7;
+    //full Newton steps by default
+    globalized_ = false;
+    xt_ = new double[n];
+    ft_ = new double[n];
+    //statistics
+    last_iter_ = 0;
+    last_nf_ = 0;
+    last_nback_ = 0;
+    last_res_ = NAN;
 }
 
 Newton::~Newton () {
@@ -45,6 +55,8 @@ Newton::~Newton () {
     delete [] delx_;
     delete [] p_;
     delete [] g_;
+    delete [] xt_;
+    delete [] ft_;
 }
 
 void Newton::J_Newton (double *x, double **J) {
@@ -108,12 +120,27 @@ int Newton::check_integrity (double *x) {
     return(0);
 }
 
+int Newton::finish (unsigned long iter, int suc) {
+
+    double errx, errf;
+    err(&errx, &errf);
+    last_iter_ = iter;
+    last_res_ = errf;
+    return(suc);
+}
+
 int Newton::solve_Newton (double *x) {
 
+    TRACE_ZONE("solve_Newton");
+
     unsigned long i, iter;
     int suc; //success (or failure) code, which is zero for success
     double errx, errf;
 
+    last_nf_ = 0;
+    last_nback_ = 0;
+    if ( globalized_ ) return( solve_Newton_globalized(x) );
+
     //initialize the update vector
     for (i=0; i<n_; i++) delx_[i] = INFINITY;
     //initialize the error estimates
@@ -128,10 +155,11 @@ int Newton::solve_Newton (double *x) {
         //evaluate and LU decompose the Jacobian
         if ( (!ignore_JLU_) && (!modified_) && (iter % iJLU_ == 0) ) {
             suc = JLU(x);
-            if (suc == 1) return(suc); //failure! singular matrix!
+            if (suc == 1) return(finish(iter, suc)); //failure! singular matrix!
         }
         //evaluate the function
         f_Newton(x, f_);
+        last_nf_++;
         //swap the sign of f
         for (i=0; i<n_; i++) f_[i] = -f_[i];
         //solve the matrix equation
@@ -143,13 +171,77 @@ int Newton::solve_Newton (double *x) {
         //increment the counter
         iter++;
         //check iteration limits
-        if ( iter > iter_Newton_ ) return(2);
+        if ( iter > iter_Newton_ ) return(finish(iter, 2));
         //check for nans and infs
         if ( iter % icheck_ == 0 ) {
             suc = check_integrity(x);
-            if ( suc != 0 ) return(suc);
+            if ( suc != 0 ) return(finish(iter, suc));
         }
     }
 
-    return(0);
+    return(finish(iter, 0));
+}
+
+int Newton::solve_Newton_globalized (double *x) {
+
+    TRACE_ZONE("solve_Newton_globalized");
+
+    //sufficient decrease factor, smallest step fraction, and bounds on each step reduction
+    const double alpha = 1e-4, lammin = 1e-10, redlo = 0.1, redhi = 0.5;
+    unsigned long i, iter;
+    int suc;
+    double errx, errf, phi, phit, lam, lamq;
+
+    //merit function at the initial guess
+    f_Newton(x, f_);
+    last_nf_++;
+    suc = check_integrity(f_);
+    if ( suc != 0 ) return(finish(0, suc));
+    phi = 0;
+    for (i=0; i<n_; i++) phi += f_[i]*f_[i]/2;
+
+    //if modified Newton's, use only a single evaluation and LU decomposition of J
+    if ( modified_ && (!ignore_JLU_) ) JLU(x);
+
+    iter = 0;
+    while ( true ) {
+        //evaluate and LU decompose the Jacobian
+        if ( (!ignore_JLU_) && (!modified_) && (iter % iJLU_ == 0) ) {
+            suc = JLU(x);
+            if (suc == 1) return(finish(iter, suc)); //failure! singular matrix!
+        }
+        //full Newton step
+        for (i=0; i<n_; i++) g_[i] = -f_[i];
+        solve_LU_(J_, p_, g_, n_, delx_);
+        //backtrack until the merit function decreases enough, knowing that
+        //its derivative along the full Newton step is -2*phi
+        lam = 1;
+        while ( true ) {
+            for (i=0; i<n_; i++) xt_[i] = x[i] + lam*delx_[i];
+            f_Newton(xt_, ft_);
+            last_nf_++;
+            phit = 0;
+            for (i=0; i<n_; i++) phit += ft_[i]*ft_[i]/2;
+            if ( std::isfinite(phit) && (phit <= (1 - 2*alpha*lam)*phi) ) break;
+            if ( lam < lammin ) return(finish(iter, 5));
+            //minimum of the quadratic through phi(0), phi'(0), and phi(lam)
+            lamq = std::isfinite(phit) ? phi*lam*lam/(phit - phi + 2*phi*lam) : 0;
+            if ( lamq < redlo*lam ) lamq = redlo*lam;
+            if ( lamq > redhi*lam ) lamq = redhi*lam;
+            lam = lamq;
+            last_nback_++;
+        }
+        //accept the step
+        for (i=0; i<n_; i++) {
+            x[i] = xt_[i];
+            f_[i] = ft_[i];
+        }
+        phi = phit;
+        iter++;
+        //converged if the full Newton step and the new residual are both small
+        err(&errx, &errf);
+        if ( (errx <= tol_Newton_) && (errf <= tol_Newton_) ) return(finish(iter, 0));
+        //check iteration limits
+        if ( iter > iter_Newton_ ) return(finish(iter, 2));
+    }
 }
@@ -12,6 +12,8 @@
 //!Newton's method for nonlinear systems of equations
 /*!
 This class implements Newton's method for nonlinear systems of equations. The virtual functions F_Newton and Jac_Newton allow a derived class to implement the system of equations and its Jacobian matrix.
+
+By default, full Newton steps are taken, which converge quickly near a root but easily diverge from a poor initial guess. In globalized mode (see set_globalized), each Newton step is followed by a backtracking line search on the merit function `|f|^2/2`, shortening the step until the merit function decreases enough (the Armijo condition), using the minimum of a quadratic model of the merit function along the step for every reduction. The full Newton step is always tried first, so the quadratic convergence near a root is kept, but far from a root the iterates can only move downhill on the residual norm, so they converge from much larger regions of initial guesses.
 */
 class Newton {
 
@@ -47,6 +49,16 @@ class Newton {
         double get_absjacdel () { return(absjacdel_); }
         //!gets adjustment factor for numerical jacobian
         double get_reljacdel () { return(reljacdel_); }
+        //!gets whether steps are controlled by a line search
+        bool get_globalized () { return(globalized_); }
+        //!gets the number of iterations in the most recent solve
+        unsigned long get_last_iter () { return(last_iter_); }
+        //!gets the number of function evaluations in the most recent solve, not counting any for a numerical Jacobian
+        unsigned long get_last_nf () { return(last_nf_); }
+        //!gets the number of line search step reductions in the most recent solve
+        unsigned long get_last_nback () { return(last_nback_); }
+        //!gets the L infinity norm of the function at the end of the most recent solve
+        double get_last_res () { return(last_res_); }
 
         //!sets the L infinity tolerance
         void set_tol_Newton (double tol_Newton) { tol_Newton_ = tol_Newton; }
@@ -62,6 +74,8 @@ class Newton {
         void set_absjacdel (double absjacdel) { absjacdel_ = absjacdel; }
         //!sets adjustment factor for numerical jacobian
         void set_reljacdel (double rbsjacdel) { reljacdel_ = rbsjacdel; }
+        //!sets whether steps are controlled by a line search
+        void set_globalized (bool globalized) { globalized_ = globalized; }
 
         //!Solve the system of equations
         /*!Solve for a root of the function f_Newton using the jacobian J_Newton, both of which must be implemented in derived classes
@@ -71,7 +85,8 @@ class Newton {
             1. failure...singular matrix encountered
             2. failure...too many iterations
             3. failure...solution contains nan(s)
-            4. failure...solution contains inf(s)*/
+            4. failure...solution contains inf(s)
+            5. failure...line search can't reduce the residual (globalized mode only)*/
         int solve_Newton (double *x);
 
     protected:
@@ -125,6 +140,13 @@ class Newton {
         double reljacdel_;
         //an extra array for evaluating numerical jacobian
         double *g_;
+        //whether steps are controlled by a line search
+        bool globalized_;
+        //trial point and function evaluation of the line search
+        double *xt_, *ft_;
+        //statistics of the most recent solve
+        unsigned long last_iter_, last_nf_, last_nback_;
+        double last_res_;
 
         //finds the infinity norm of the update vector delx and of y
         void err (double *errx, double *erry);
@@ -134,6 +156,10 @@ class Newton {
         void solve_LU_(double **LU, int *p, double *b, int n, double *out);
         //function for checking solution integrity (can't have NAN or INFINITY)
         int check_integrity (double *x);
+        //Newton's method with a backtracking line search
+        int solve_Newton_globalized (double *x);
+        //records the statistics of a solve and passes its success code through
+        int finish (unsigned long iter, int suc);
 };
 
 #endif
@@ -0,0 +1,206 @@
+//! \file parareal.cc
+
+#include "parareal.h"
+
+//------------------------------------------------------------------------------
+//coarse propagator
+
+BackwardEuler::BackwardEuler (MscGcv *sys, double tol) :
+    Newton (2),
+    sys_ (sys),
+    tol_ (tol),
+    h_ (0.0),
+    nstep_ (0) {
+
+    set_tol_Newton(1e-6);
+    set_iter_Newton(20);
+}
+
+void BackwardEuler::f_Newton (double *x, double *f) {
+    double dx[2];
+    sys_->ode_fun_prec(x, dx);
+    f[0] = x[0] - y_[0] - h_*dx[0];
+    f[1] = x[1] - y_[1] - h_*dx[1];
+}
+
+int BackwardEuler::single (double h, const double *y, double *x) {
+
+    //solve for the end of the step, starting from its beginning
+    x[0] = y[0];
+    x[1] = y[1];
+    h_ = h;
+    y_[0] = y[0];
+    y_[1] = y[1];
+    return( solve_Newton(x) );
+}
+
+int BackwardEuler::step (double h, double *y, int depth) {
+
+    //full step and two half steps
+    double x1[2], xh[2], x2[2];
+    if ( (single(h, y, x1) == 0)
+        && (single(h/2, y, xh) == 0)
+        && (single(h/2, xh, x2) == 0)
+        && (fabs(x1[0] - x2[0]) <= tol_)
+        && (fabs(x1[1] - x2[1]) <= tol_) ) {
+        y[0] = x2[0];
+        y[1] = x2[1];
+        nstep_++;
+        return(0);
+    }
+    //split the step
+    if ( depth >= 30 ) return(1);
+    if ( step(h/2, y, depth + 1) != 0 ) return(1);
+    return( step(h/2, y, depth + 1) );
+}
+
+int BackwardEuler::solve (double dt, long nstep, double *zs, double *zm) {
+
+    double y[2] = {*zs, *zm};
+    for (long i=0; i<nstep; i++)
+        if ( step(dt/nstep, y, 0) != 0 )
+            return(1);
+    *zs = y[0];
+    *zm = y[1];
+    return(0);
+}
+
+//------------------------------------------------------------------------------
+//parareal iterations
+
+Parareal::Parareal (MscGcv *sys, long nslice, long ncoarse) :
+    sys_ (sys),
+    nslice_ (nslice),
+    nthread_ (omp_get_max_threads()),
+    ncoarse_step_ (ncoarse),
+    nit_ (0),
+    nfine_ (0),
+    ncoarse_ (0),
+    kfail_ (-1) {
+
+    if ( (nslice < 1) || (ncoarse < 1) ) {
+        printf("FAILURE: parareal integration needs at least one time slice and coarse step\n");
+        exit(EXIT_FAILURE);
+    }
+    //propagators with the same parameters as the model
+    fine_ = new MscGcv[nthread_];
+    for (int i=0; i<nthread_; i++) {
+        fine_[i].copy_param(*sys);
+        fine_[i].set_tol(sys->get_tol());
+    }
+    coarse_ = new MscGcv;
+    coarse_->copy_param(*sys);
+    euler_ = new BackwardEuler(coarse_);
+}
+
+Parareal::~Parareal () {
+    delete [] fine_;
+    delete euler_;
+    delete coarse_;
+}
+
+long Parareal::fine (MscGcv *prop, double t, double dt, double dt0,
+                     double zs, double zm, double *zs1, double *zm1) {
+
+    long nstep = prop->get_nstep();
+    prop->set_t(t);
+    prop->set_sol(0, zs);
+    prop->set_sol(1, zm);
+    prop->solve_adaptive(dt, dt0, false);
+    *zs1 = prop->get_sol(0);
+    *zm1 = prop->get_sol(1);
+    return(prop->get_nstep() - nstep);
+}
+
+int Parareal::coarse (double dt, double zs, double zm, double *zs1, double *zm1) {
+
+    long nstep = euler_->get_nstep();
+    int status = euler_->solve(dt, ncoarse_step_, &zs, &zm);
+    ncoarse_ += euler_->get_nstep() - nstep;
+    *zs1 = zs;
+    *zm1 = zm;
+    return(status);
+}
+
+int Parareal::solve (double tint, double dt0, double tolp, int maxit) {
+
+    long k;
+    double dT = tint/nslice_;
+    if ( (maxit <= 0) || (maxit > nslice_) ) maxit = nslice_;
+
+    //fine and coarse results over each slice
+    std::vector<double> fzs(nslice_), fzm(nslice_),
+                        gzs(nslice_), gzm(nslice_);
+    //slice boundaries
+    t_.resize(nslice_ + 1);
+    zs_.resize(nslice_ + 1);
+    zm_.resize(nslice_ + 1);
+    for (k=0; k<=nslice_; k++) t_[k] = sys_->get_t() + k*dT;
+    zs_[0] = sys_->get_sol(0);
+    zm_[0] = sys_->get_sol(1);
+
+    //initial serial prediction with the coarse propagator
+    nit_ = 0;
+    nfine_ = 0;
+    ncoarse_ = 0;
+    kfail_ = -1;
+    for (k=0; k<nslice_; k++) {
+        if ( coarse(dT, zs_[k], zm_[k], &gzs[k], &gzm[k]) != 0 ) {
+            kfail_ = k;
+            return(2);
+        }
+        zs_[k+1] = gzs[k];
+        zm_[k+1] = gzm[k];
+    }
+
+    bool converged = false;
+    while ( (nit_ < maxit) && !converged ) {
+        //slices before this one are already exact
+        long k0 = nit_;
+        nit_++;
+        //fine integration of all unconverged slices in parallel
+        long nfine = 0;
+        #pragma omp parallel for schedule(dynamic) reduction(+:nfine)
+        for (long j=k0; j<nslice_; j++) {
+            int n = omp_get_thread_num();
+            nfine += fine(&fine_[n], t_[j], dT, dt0, zs_[j], zm_[j], &fzs[j], &fzm[j]);
+        }
+        nfine_ += nfine;
+        //serial correction with the coarse propagator
+        double dmax = 0.0;
+        zs_[k0+1] = fzs[k0];
+        zm_[k0+1] = fzm[k0];
+        for (k=k0+1; k<nslice_; k++) {
+            double zs1, zm1;
+            if ( coarse(dT, zs_[k], zm_[k], &zs1, &zm1) != 0 ) {
+                kfail_ = k;
+                return(2);
+            }
+            double zsn = zs1 + fzs[k] - gzs[k],
+                   zmn = zm1 + fzm[k] - gzm[k];
+            dmax = max(dmax, max(fabs(zsn - zs_[k+1]), fabs(zmn - zm_[k+1])));
+            gzs[k] = zs1;
+            gzm[k] = zm1;
+            zs_[k+1] = zsn;
+            zm_[k+1] = zmn;
+        }
+        if ( dmax <= tolp ) converged = true;
+    }
+
+    //leave the model at the end of the integration
+    sys_->set_t(t_[nslice_]);
+    sys_->set_sol(0, zs_[nslice_]);
+    sys_->set_sol(1, zm_[nslice_]);
+
+    return( converged ? 0 : 1 );
+}
+
+void Parareal::write (const char *fn) {
+
+    check_file_write(fn);
+    FILE *ofile = fopen(fn, "w");
+    fprintf(ofile, "t,zs,zm\n");
+    for (unsigned long k=0; k<t_.size(); k++)
+        fprintf(ofile, "%.17g,%.17g,%.17g\n", t_[k], zs_[k], zm_[k]);
+    fclose(ofile);
+}
@@ -0,0 +1,142 @@
+#ifndef PARAREAL_H_
+#define PARAREAL_H_
+
+//! \file parareal.h
+
+#include <cmath>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+#include "omp.h"
+
+#include "util.h"
+#include "newton.h"
+#include "msc_gcv.h"
+
+//!backward Euler integration of the model with fixed steps, used as the coarse parareal propagator
+/*!
+The model is stiff near its fixed points, where explicit steps are limited by stability to several centuries however loose the tolerance is. Backward Euler steps are stable at any size, so a handful of them per slice is enough for a cheap, smooth prediction. Each step solves `x - y - h*f(x) = 0` with Newton's method and a finite difference Jacobian. Each step is also taken as two half steps, and it is split in halves if the two results differ by more than a tolerance or if Newton's method fails, because very long steps during fast transients can otherwise land on the wrong branch of solutions (for example the cutoff branch, far from a fixed point with an eroding sill).
+*/
+class BackwardEuler : public Newton {
+
+public:
+
+    //!constructs
+    /*!
+    \param[in] sys model object whose ode_fun is integrated
+    \param[in] tol largest difference between a step and two half steps [m]
+    */
+    BackwardEuler (MscGcv *sys, double tol=1.0);
+
+    //!integrates with equal steps
+    /*!
+    \param[in] dt integration time
+    \param[in] nstep number of steps
+    \param[in,out] zs sill level
+    \param[in,out] zm Mediterranean level
+    \return zero for success
+    */
+    int solve (double dt, long nstep, double *zs, double *zm);
+
+    //!total number of steps taken, including split steps
+    long get_nstep () { return(nstep_); }
+
+protected:
+
+    //residual of a backward Euler step
+    void f_Newton (double *x, double *f);
+
+private:
+
+    //model object
+    MscGcv *sys_;
+    //step splitting tolerance
+    double tol_;
+    //step size and initial state of the current step
+    double h_, y_[2];
+    //step counter
+    long nstep_;
+    //solves for a single step without splitting
+    int single (double h, const double *y, double *x);
+    //takes a step, splitting it if necessary
+    int step (double h, double *y, int depth);
+};
+
+//!parallel-in-time integration of a single trajectory with the parareal algorithm
+/*!
+The integration is split into equal time slices. A coarse propagator, which is a few BackwardEuler steps over the same model equations, predicts the state at the start of every slice serially. Then each iteration integrates all unconverged slices in parallel with the fine propagator, which uses the tolerance of the model object being integrated, and corrects the slice boundaries serially with the coarse propagator,
+
+    U[k+1] = G(U[k]) + F(U_old[k]) - G(U_old[k])
+
+where `F` and `G` are the fine and coarse propagators over one slice. After `i` iterations the first `i` slices are identical to a serial fine integration, so the method always converges within one iteration per slice. Trajectories that settle onto a fixed point converge in a few iterations, but oscillating trajectories converge slowly, because the coarse propagator damps oscillations that are much shorter than its steps. Iterations stop when no boundary state changes by more than a tolerance.
+
++ [Lions, J.-L., Maday, Y. & Turinici, G. Résolution d'EDP par un schéma en temps « pararéel ». C. R. Acad. Sci. Paris 332, 661–668 (2001).](https://doi.org/10.1016/S0764-4442(00)01793-6)
+*/
+class Parareal {
+
+public:
+
+    //!constructs
+    /*!
+    \param[in] sys model object with parameters, tolerance, initial time, and initial state set
+    \param[in] nslice number of time slices
+    \param[in] ncoarse number of backward Euler steps per slice in the coarse propagator
+    */
+    Parareal (MscGcv *sys, long nslice, long ncoarse=8);
+    //!destructs
+    ~Parareal ();
+
+    //!integrates the model object, leaving it at the final time and state
+    /*!
+    \param[in] tint total integration time
+    \param[in] dt0 initial time step in every slice
+    \param[in] tolp largest change of a slice boundary state for convergence [m]
+    \param[in] maxit maximum number of iterations (the number of slices is used if this is not positive)
+    \return zero if the iterations converged, one if they didn't, and two if the coarse propagator failed, leaving the model object where it was
+    */
+    int solve (double tint, double dt0, double tolp=1e-4, int maxit=0);
+
+    //!number of iterations used by the last solve
+    int get_nit () { return(nit_); }
+    //!total number of fine steps taken by the last solve
+    long get_nfine () { return(nfine_); }
+    //!total number of coarse steps taken by the last solve
+    long get_ncoarse () { return(ncoarse_); }
+    //!time at the start of slice k, or at the end of the integration if k is the number of slices
+    double get_t (long k) { return(t_[k]); }
+    //!sill level at the start of slice k, or at the end of the integration if k is the number of slices
+    double get_zs (long k) { return(zs_[k]); }
+    //!Mediterranean level at the start of slice k, or at the end of the integration if k is the number of slices
+    double get_zm (long k) { return(zm_[k]); }
+    //!slice where the coarse propagator failed in the last solve, or -1
+    long get_kfail () { return(kfail_); }
+
+    //!writes the time and state at all slice boundaries to a csv file
+    void write (const char *fn);
+
+private:
+
+    //model being integrated
+    MscGcv *sys_;
+    //number of slices and threads
+    long nslice_;
+    int nthread_;
+    //fine propagators, one per thread, and coarse propagator
+    MscGcv *fine_;
+    MscGcv *coarse_;
+    BackwardEuler *euler_;
+    long ncoarse_step_;
+    //iteration stats
+    int nit_;
+    long nfine_, ncoarse_, kfail_;
+    //slice boundaries
+    std::vector<double> t_, zs_, zm_;
+    //integrates one slice with a fine propagator, returning the number of steps
+    long fine (MscGcv *prop, double t, double dt, double dt0,
+               double zs, double zm, double *zs1, double *zm1);
+    //integrates one slice with the coarse propagator, adding to the step count and returning zero for success
+    int coarse (double dt, double zs, double zm, double *zs1, double *zm1);
+};
+
+#endif
@@ -0,0 +1,98 @@
+//! \file phase.cc
+
+#include "phase.h"
+
+//appends every sign change of f along a grid line, interpolated linearly, as a (zs, zm) pair
+static void nullcline (const float *f, long stride, long n, const double *x, double y, bool row, std::vector<float> &pts) {
+    for (long i=1; i<n; i++) {
+        double a = f[(i-1)*stride], b = f[i*stride], c;
+        if ( b == 0.0 ) c = x[i];
+        else if ( (a != 0.0) && ((a < 0.0) != (b < 0.0)) ) c = x[i-1] + (x[i] - x[i-1])*a/(a - b);
+        else continue;
+        pts.push_back(float(row ? c : y));
+        pts.push_back(float(row ? y : c));
+    }
+}
+
+//writes a list of nullcline points, preceded by their number
+static void write_points (const std::vector<float> &pts, FILE *ofile) {
+    long long n = (long long)pts.size()/2;
+    fwrite(&n, sizeof(long long), 1, ofile);
+    fwrite(pts.data(), sizeof(float), pts.size(), ofile);
+}
+
+void phase_portrait (MscGcv *sys,
+                     double zslo, double zshi, long nzs,
+                     double zmlo, double zmhi, long nzm,
+                     const char *fn) {
+
+    //grid coordinates
+    std::vector<double> zs = linspace(zslo, zshi, nzs);
+    std::vector<double> zm = linspace(zmlo, zmhi, nzm);
+    //output fields
+    std::vector<float> dzs(nzs*nzm), dzm(nzs*nzm), div(nzs*nzm);
+    std::vector<float> ncs, ncm;
+
+    #pragma omp parallel
+    {
+        //row buffers for each thread
+        std::vector<double> fs(nzs), fm(nzs), gs(nzs), gm(nzs), zsp(nzs), zsm(nzs);
+        std::vector<double> hs(nzs), hm(nzs);
+        #pragma omp for schedule(static)
+        for (long j=0; j<nzm; j++) {
+            //vector field on the row
+            sys->ode_fun_row(zm[j], zs.data(), nzs, fs.data(), fm.data());
+            //divergence by central differences, first the sill level term
+            double del;
+            for (long i=0; i<nzs; i++) {
+                del = max(1e-7*fabs(zs[i]), 1e-7);
+                zsp[i] = zs[i] + del;
+                zsm[i] = zs[i] - del;
+            }
+            sys->ode_fun_row(zm[j], zsp.data(), nzs, gs.data(), gm.data());
+            sys->ode_fun_row(zm[j], zsm.data(), nzs, hs.data(), hm.data());
+            for (long i=0; i<nzs; i++)
+                div[j*nzs+i] = float( (gs[i] - hs[i])/(zsp[i] - zsm[i]) );
+            //then the Mediterranean level term
+            del = max(1e-7*fabs(zm[j]), 1e-7);
+            sys->ode_fun_row(zm[j] + del, zs.data(), nzs, gs.data(), gm.data());
+            sys->ode_fun_row(zm[j] - del, zs.data(), nzs, hs.data(), hm.data());
+            for (long i=0; i<nzs; i++)
+                div[j*nzs+i] += float( (gm[i] - hm[i])/(2*del) );
+            //store the field
+            for (long i=0; i<nzs; i++) {
+                dzs[j*nzs+i] = float(fs[i]);
+                dzm[j*nzs+i] = float(fm[i]);
+            }
+        }
+    }
+
+    //locate nullclines along every row and then every column, keeping all branches of folded curves
+    for (long j=0; j<nzm; j++) {
+        nullcline(dzs.data() + j*nzs, 1, nzs, zs.data(), zm[j], true, ncs);
+        nullcline(dzm.data() + j*nzs, 1, nzs, zs.data(), zm[j], true, ncm);
+    }
+    for (long i=0; i<nzs; i++) {
+        nullcline(dzs.data() + i, nzs, nzm, zm.data(), zs[i], false, ncs);
+        nullcline(dzm.data() + i, nzs, nzm, zm.data(), zs[i], false, ncm);
+    }
+
+    //write the grid file
+    FILE *ofile;
+    long long dims[2] = {nzs, nzm};
+    double lims[4] = {zslo, zshi, zmlo, zmhi};
+    double par[NPARAM];
+    for (int i=0; i<NPARAM; i++) par[i] = sys->get_param(i);
+    check_file_write(fn);
+    ofile = fopen(fn, "wb");
+    fwrite("MSCPHASE", 1, 8, ofile);
+    fwrite(dims, sizeof(long long), 2, ofile);
+    fwrite(lims, sizeof(double), 4, ofile);
+    fwrite(par, sizeof(double), NPARAM, ofile);
+    fwrite(dzs.data(), sizeof(float), dzs.size(), ofile);
+    fwrite(dzm.data(), sizeof(float), dzm.size(), ofile);
+    fwrite(div.data(), sizeof(float), div.size(), ofile);
+    write_points(ncs, ofile);
+    write_points(ncm, ofile);
+    fclose(ofile);
+}
@@ -0,0 +1,47 @@
+#ifndef PHASE_H_
+#define PHASE_H_
+
+//! \file phase.h
+
+#include <cmath>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+#include "omp.h"
+
+#include "util.h"
+#include "msc_gcv.h"
+
+//!evaluates the vector field, divergence, and nullclines of a model over a regular (zs, zm) grid
+/*!
+Rows of constant Mediterranean level are distributed over threads and each row is evaluated with MscGcv::ode_fun_row. The model object is only read, so a single object is shared by all threads.
+
+The results are written to a binary file with the layout
++ 8 byte identifier `MSCPHASE`
++ int64 `nzs`, `nzm`
++ float64 `zslo`, `zshi`, `zmlo`, `zmhi`
++ float64 model parameters in the order and units of MscGcv::get_param
++ float32 `dzs/dt` [m/s], shape (nzm, nzs)
++ float32 `dzm/dt` [m/s], shape (nzm, nzs)
++ float32 divergence of the vector field [1/s], shape (nzm, nzs)
++ int64 number of points on the `dzs/dt = 0` nullcline, followed by float32 (zs, zm) pairs [m]
++ int64 number of points on the `dzm/dt = 0` nullcline, followed by float32 (zs, zm) pairs [m]
+
+Nullcline points are every sign change along every row and column of the grid, so all branches of a folded nullcline are kept.
+
+\param[in] sys model object with parameters set
+\param[in] zslo lowest sill level in grid
+\param[in] zshi highest sill level in grid
+\param[in] nzs number of evenly spaced sill levels in grid
+\param[in] zmlo lowest Med. level in grid
+\param[in] zmhi highest Med. level in grid
+\param[in] nzm number of evenly spaced Med. levels in grid
+\param[in] fn path of output file
+*/
+void phase_portrait (MscGcv *sys,
+                     double zslo, double zshi, long nzs,
+                     double zmlo, double zmhi, long nzm,
+                     const char *fn);
+
+#endif
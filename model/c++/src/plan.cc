@@ -0,0 +1,284 @@
+//! \file plan.cc
+
+#include <cstring>
+#include <climits>
+
+#include "plan.h"
+#include "ensemble.h"
+#include "fidelity.h"
+#include "atlas.h"
+#include "marginals.h"
+
+//size of a heap block holding n bytes, with the 8 byte header and 16 byte alignment of glibc
+static double chunk (double n) {
+    double c = 16*ceil((n + 8)/16);
+    return( (c < 32) ? 32 : c );
+}
+
+//number of characters in a value written with %g
+static int glen (double x) {
+    char buf[64];
+    return( snprintf(buf, sizeof(buf), "%g", x) );
+}
+
+//total number of digits in the indices 0 to n-1
+static double digits (long unsigned n) {
+    //bounds in double, since the powers of ten would wrap around near the largest n
+    double d = 0, lo = 0, hi = 10;
+    for (int k=1; lo<double(n); k++) {
+        d += double(k)*(std::min(hi, double(n)) - lo);
+        lo = hi;
+        hi *= 10;
+    }
+    return(d);
+}
+
+//prints a cost with the width of a table column, or n/a if it isn't known
+static void cost_cell (double x) {
+    if ( std::isnan(x) ) printf(" | %10s", "n/a"); else printf(" | %10.4g", x);
+}
+
+//high water mark of the resident memory of this process [bytes], or NAN where it isn't known
+static double peak_rss () {
+    FILE *f = fopen("/proc/self/status", "r");
+    if ( !f ) return(NAN);
+    char line[256];
+    double kb = NAN;
+    while ( fgets(line, sizeof(line), f) )
+        if ( sscanf(line, "VmHWM: %lf kB", &kb) == 1 ) break;
+    fclose(f);
+    return(kb*1024);
+}
+
+//------------------------------------------------------------------------------
+
+SweepPlan::SweepPlan (const std::vector< std::string > &pname,
+                      const std::vector< std::vector<double> > &pvec,
+                      const TrialList *trials,
+                      bool fidelity) :
+    pname_ (pname),
+    pvec_ (pvec),
+    trials_ (trials),
+    fidelity_ (fidelity) {
+
+    nrow_ = trials_ ? (long unsigned)trials_->get_nrow() : trials_of(0);
+}
+
+long unsigned SweepPlan::trials_of (long nval) const {
+    if ( trials_ ) return( (long unsigned)trials_->get_nrow() );
+    long unsigned n = 1;
+    for (unsigned long j=0; j<pvec_.size(); j++) {
+        long unsigned m = ((nval > 0) && (pvec_[j].size() > 1)) ? (long unsigned)nval : pvec_[j].size();
+        //saturate instead of wrapping around
+        if ( (m > 0) && (n > ULONG_MAX/m) ) return(ULONG_MAX);
+        n *= m;
+    }
+    return(n);
+}
+
+const std::vector<long unsigned> &SweepPlan::pilot (long npilot, uint64_t seed) {
+
+    long np = (long)std::min((long unsigned)std::max(npilot, 1L), nrow_);
+    idx_.assign(np, 0);
+    if ( trials_ ) {
+        //a random row from each of np equal runs of rows
+        EnsembleRng rng(seed, 0);
+        for (long k=0; k<np; k++) {
+            long unsigned lo = (long unsigned)(double(k)*nrow_/np),
+                          hi = (long unsigned)(double(k+1)*nrow_/np);
+            idx_[k] = std::min(lo + (long unsigned)(rng.uniform()*(hi - lo)), hi - 1);
+        }
+    } else {
+        //Latin hypercube over the grid indices, the first axis varying fastest
+        long unsigned stride = 1;
+        std::vector<long> perm(np);
+        for (unsigned long j=0; j<pvec_.size(); j++) {
+            EnsembleRng rng(seed, j);
+            long n = (long)pvec_[j].size();
+            for (long k=0; k<np; k++) perm[k] = k;
+            for (long k=np-1; k>0; k--) std::swap(perm[k], perm[(long)(rng.uniform()*(k + 1))]);
+            for (long k=0; k<np; k++) {
+                long g = (long)((perm[k] + rng.uniform())*n/np);
+                idx_[k] += stride*(long unsigned)std::min(g, n - 1);
+            }
+            stride *= (long unsigned)n;
+        }
+    }
+    osc_.assign(np, 2);
+    cost_.assign(np, NAN);
+    return(idx_);
+}
+
+void SweepPlan::row (long unsigned i, double *p) const {
+    for (unsigned long j=0; j<pvec_.size(); j++) {
+        p[j] = pvec_[j][i % pvec_[j].size()];
+        i /= pvec_[j].size();
+    }
+}
+
+void SweepPlan::add (long k, int osc, double cost) {
+    osc_[k] = osc;
+    cost_[k] = cost;
+}
+
+double SweepPlan::memory (long unsigned nrow, long nval, int nthread, double base) const {
+    double n = double(nrow), m = base;
+    //classifications and, with increasing horizons, the levels and validation results
+    m += 4*n;
+    if ( fidelity_ ) m += 8*n;
+    if ( trials_ ) {
+        //the mapped rows of the trial list, all of which are read
+        m += 8*n*trials_->get_ncol();
+    } else {
+        //parameter table, a pointer and a heap block per row
+        m += n*(8 + chunk(8.0*pvec_.size()));
+        //marginal maps of every thread
+        double ncell = 0;
+        for (unsigned long j=0; j<pvec_.size(); j++)
+            for (unsigned long k=j+1; k<pvec_.size(); k++)
+                ncell += double((nval > 0) && (pvec_[j].size() > 1) ? nval : pvec_[j].size())
+                        *double((nval > 0) && (pvec_[k].size() > 1) ? nval : pvec_[k].size());
+        m += double(nthread)*ncell*(MARGINALS_NCLASS*8 + 16);
+        //block table and packed bits of the atlas, at their largest
+        m += 8*ceil(n/ATLAS_BLOCK) + n/4;
+    }
+    return(m);
+}
+
+double SweepPlan::output (long unsigned nrow, long nval, const double *freq) const {
+    double n = double(nrow), s = 0;
+    //trials.csv: header, indices, parameters, and classifications, of which -1 takes two characters
+    s += strlen("trial") + strlen(",classification\n");
+    for (unsigned long j=0; j<pname_.size(); j++) s += 1 + pname_[j].size();
+    s += digits(nrow) + n*(pname_.size() + 2 + freq[0] + 1);
+    if ( trials_ ) {
+        //characters of the pilot rows, scaled to the list
+        double c = 0;
+        for (unsigned long k=0; k<idx_.size(); k++) {
+            const double *r = trials_->get_row((long)idx_[k]);
+            for (unsigned long j=0; j<pname_.size(); j++) c += glen(r[j]);
+        }
+        s += c*n/idx_.size();
+    } else {
+        for (unsigned long j=0; j<pvec_.size(); j++) {
+            //every value of an axis appears in the same number of rows
+            double c = 0;
+            for (unsigned long k=0; k<pvec_[j].size(); k++) c += glen(pvec_[j][k]);
+            c /= pvec_[j].size();
+            s += c*n;
+        }
+        //atlas.bin at its largest, marginals.bin, and parameters.txt
+        double nv = 0, ncell = 0;
+        std::vector<double> len(pvec_.size());
+        for (unsigned long j=0; j<pvec_.size(); j++)
+            len[j] = ((nval > 0) && (pvec_[j].size() > 1)) ? nval : pvec_[j].size();
+        for (unsigned long j=0; j<pvec_.size(); j++) {
+            nv += len[j];
+            for (unsigned long k=j+1; k<pvec_.size(); k++) ncell += len[j]*len[k];
+        }
+        s += 64 + 24*pvec_.size() + 8*nv + 8*ceil(n/ATLAS_BLOCK) + ceil(n/ATLAS_BLOCK)*ATLAS_BLOCK/4;
+        s += 16 + 8*pvec_.size() + 8*nv + ncell*(MARGINALS_NCLASS*8 + 16);
+        s += 17*(pvec_.size() + nv);
+    }
+    //fidelity.csv, with the longest horizon for every trial
+    if ( fidelity_ ) {
+        int tl = 0;
+        for (int k=0; k<NFIDELITY; k++) tl = std::max(tl, glen(fidelity_tlim[k]));
+        s += strlen("trial,level,tlim_yr,classification\n") + digits(nrow) + n*(5 + tl + freq[0] + 1);
+    }
+    return(s);
+}
+
+void SweepPlan::report (int nthread, double budget, const char *fn) {
+
+    //cost model by regime, and of all trials
+    RunningStats reg[3], all;
+    long np = (long)idx_.size();
+    for (long k=0; k<np; k++) {
+        if ( (osc_[k] < -1) || (osc_[k] > 1) ) continue;
+        reg[osc_[k]+1].add(cost_[k]);
+        all.add(cost_[k]);
+    }
+    double z = normal_quantile(0.95), freq[3], lo, hi;
+    printf("\ncost model from %ld pilot trials, in seconds of one thread:\n\n", (long)all.get_n());
+    printf("  regime | trials | frequency [95 %% interval] |  mean cost | sd cost    |   max cost\n");
+    printf("  -------|--------|---------------------------|------------|------------|-----------\n");
+    for (int c=0; c<3; c++) {
+        freq[c] = double(reg[c].get_n())/all.get_n();
+        wilson_interval(reg[c].get_n(), all.get_n(), z, &lo, &hi);
+        printf("  %6d | %6ld | %6.4f [%6.4f, %6.4f] ", c - 1, (long)reg[c].get_n(), freq[c], lo, hi);
+        cost_cell(reg[c].get_mean());
+        cost_cell(sqrt(reg[c].get_var()));
+        cost_cell(reg[c].get_max());
+        printf("\n");
+    }
+
+    //mean cost of a trial as the mixture of the regimes, whose variance adds the standard error of each
+    //regime's mean, weighted by its frequency, and the multinomial uncertainty of the frequencies
+    double mean = 0, var = 0;
+    for (int c=0; c<3; c++)
+        if ( reg[c].get_n() > 0 ) mean += freq[c]*reg[c].get_mean();
+    for (int c=0; c<3; c++) {
+        if ( reg[c].get_n() == 0 ) continue;
+        //a regime with a single trial borrows the spread of all trials
+        double sem2 = (reg[c].get_n() > 1) ? reg[c].get_var()/reg[c].get_n() : all.get_var();
+        double d = reg[c].get_mean() - mean;
+        var += freq[c]*freq[c]*sem2 + freq[c]*d*d/all.get_n();
+    }
+
+    //predictions for the requested design
+    double n = double(nrow_),
+           half = z*sqrt(var),
+           tmax = all.get_max(),
+           base = peak_rss();
+    if ( std::isnan(base) ) base = 0;
+    double mem = memory(nrow_, 0, nthread, base),
+           out = output(nrow_, 0, freq);
+    printf("\npredictions for the sweep of %lu trials:\n", nrow_);
+    if ( std::isnan(half) )
+        printf("  core-hours: %g [n/a] (95 %% interval)\n", n*mean/3600);
+    else
+        printf("  core-hours: %g [%g, %g] (95 %% interval)\n",
+            n*mean/3600, n*std::max(mean - half, 0.0)/3600, n*(mean + half)/3600);
+    printf("  wall time with %d threads: %g hours, or %g hours with perfect balance\n",
+        nthread, (n*mean/nthread + tmax)/3600, n*mean/nthread/3600);
+    printf("  peak memory: %g MB, or %g MB per thread\n", mem/1e6, mem/1e6/nthread);
+    printf("  output size: %g MB\n", out/1e6);
+
+    //largest grid within the budget, from the wall time of an nval^d grid
+    if ( (budget > 0) && !trials_ ) {
+        long nval = 0;
+        for (long v=2; v<1000000; v++) {
+            if ( trials_of(v) == ULONG_MAX ) break;
+            if ( (double(trials_of(v))*mean/nthread + tmax)/3600 > budget ) break;
+            nval = v;
+            if ( trials_of(v) == trials_of(v+1) ) break;
+        }
+        if ( nval > 0 ) {
+            long unsigned nr = trials_of(nval);
+            printf("\nlargest grid within %g hours on %d threads: %ld values per parameter\n", budget, nthread, nval);
+            printf("  %lu trials, %g core-hours, %g hours of wall time, %g MB of peak memory, %g MB of output\n",
+                nr, double(nr)*mean/3600, (double(nr)*mean/nthread + tmax)/3600,
+                memory(nr, nval, nthread, base)/1e6, output(nr, nval, freq)/1e6);
+        } else {
+            printf("\nno grid fits within %g hours on %d threads\n", budget, nthread);
+        }
+    }
+
+    //the pilot trials
+    check_file_write(fn);
+    FILE *ofile = fopen(fn, "w");
+    fprintf(ofile, "trial");
+    for (unsigned long j=0; j<pname_.size(); j++) fprintf(ofile, ",%s", pname_[j].c_str());
+    fprintf(ofile, ",classification,cost_s\n");
+    std::vector<double> p(pname_.size());
+    for (long k=0; k<np; k++) {
+        const double *r = p.data();
+        if ( trials_ ) r = trials_->get_row((long)idx_[k]); else row(idx_[k], p.data());
+        fprintf(ofile, "%lu", idx_[k]);
+        for (unsigned long j=0; j<pname_.size(); j++) fprintf(ofile, ",%g", r[j]);
+        fprintf(ofile, ",%d,%g\n", osc_[k], cost_[k]);
+    }
+    fclose(ofile);
+    printf("\npilot trials written to: %s\n", fn);
+}
@@ -0,0 +1,98 @@
+#ifndef PLAN_H_
+#define PLAN_H_
+
+//! \file plan.h
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#include "omp.h"
+
+#include "util.h"
+#include "stats.h"
+#include "trials.h"
+
+//!cost model of a sweep fitted to a pilot sample of its trials, predicting the resources of the whole sweep
+/*!
+The pilot is a stratified sample of the sweep's design. For a grid, it's a Latin hypercube over the grid indices: for every swept parameter, the range of its indices is split into as many equal strata as there are pilot trials and each stratum is used by exactly one pilot trial, with the strata of different parameters paired at random, so every parameter's range is covered evenly however few trials there are. For a trial list, one row is picked at random from each of as many equal runs of rows. The random choices come from EnsembleRng streams of a fixed seed, so a plan is reproducible.
+
+Every pilot trial is classified exactly like in the sweep and timed, and the cost model keeps, for each regime (oscillation code), its frequency and the mean, spread, and largest cost of its trials, in seconds of one thread. The predictions for the whole sweep are
++ core-hours, the number of trials times the mean cost, which is the sum over regimes of their frequency times their mean cost, with a confidence interval propagating the standard error of each regime's mean and the uncertainty of the frequencies
++ wall time at a number of threads, the core-hours spread over the threads plus the largest pilot cost, which is the bound on the finishing time of any greedy dynamic schedule (Graham 1969), since a single trial can't be split
++ peak memory, the high water mark of the pilot run plus the arrays `sweep.exe` allocates per trial and per thread
++ output size, exact for the fixed parts of the files and estimated from the regime frequencies for the rest, with the atlas at its largest, before any uniform blocks are left out
+
+For a grid, the planner also finds the largest number of values per parameter whose predicted wall time fits a budget. All costs are for the machine running the pilot, so a pilot should run on the kind of node the sweep will use.
+
++ [Graham, R. L. Bounds on multiprocessing timing anomalies. SIAM J. Appl. Math. 17, 416–429 (1969).](https://doi.org/10.1137/0117039)
+*/
+class SweepPlan {
+
+public:
+
+    //!constructs
+    /*!
+    \param[in] pname names of the swept parameters, or of the trial list columns
+    \param[in] pvec values of each swept parameter, for a grid
+    \param[in] trials trial list replacing the grid, or NULL
+    \param[in] fidelity whether the sweep classifies with increasing horizons and writes `fidelity.csv`
+    */
+    SweepPlan (const std::vector< std::string > &pname,
+               const std::vector< std::vector<double> > &pvec,
+               const TrialList *trials,
+               bool fidelity);
+
+    //!chooses the pilot trials
+    /*!
+    \param[in] npilot number of pilot trials, which is reduced to the number of trials of a smaller sweep
+    \param[in] seed seed of the random choices
+    \return indices of the pilot trials in the sweep
+    */
+    const std::vector<long unsigned> &pilot (long npilot, uint64_t seed=1);
+
+    //!gets the parameter values of a trial of a grid, in the order of its axes
+    void row (long unsigned i, double *p) const;
+
+    //!adds a timed pilot trial, safe to call from many threads at once
+    /*!
+    \param[in] k index of the trial in the pilot
+    \param[in] osc oscillation code of the trial
+    \param[in] cost wall time of the trial on its thread [s]
+    */
+    void add (long k, int osc, double cost);
+
+    //!prints the cost model and the predictions, and writes the pilot trials
+    /*!
+    \param[in] nthread number of threads of the planned sweep
+    \param[in] budget wall time budget [hours], or zero for no search of the largest grid
+    \param[in] fn path of the table of pilot trials, with their parameters, classification, and cost
+    */
+    void report (int nthread, double budget, const char *fn);
+
+    //!gets the number of trials of the sweep
+    long unsigned get_nrow () const { return(nrow_); }
+
+private:
+
+    //design
+    std::vector< std::string > pname_;
+    std::vector< std::vector<double> > pvec_;
+    const TrialList *trials_;
+    bool fidelity_;
+    long unsigned nrow_;
+    //pilot trials and their results
+    std::vector<long unsigned> idx_;
+    std::vector<int> osc_;
+    std::vector<double> cost_;
+    //predictions for a grid with `nval` values per swept parameter, or for the design itself when it's zero,
+    //with the number of trials saturating at ULONG_MAX
+    long unsigned trials_of (long nval) const;
+    double memory (long unsigned nrow, long nval, int nthread, double base) const;
+    double output (long unsigned nrow, long nval, const double *freq) const;
+};
+
+#endif
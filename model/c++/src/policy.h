@@ -0,0 +1,133 @@
+#ifndef POLICY_H_
+#define POLICY_H_
+
+//! \file policy.h
+
+#include <cmath>
+
+//------------------------------------------------------------------------------
+//erosion laws, giving the sill erosion rate per unit kb from the excess shear stress
+
+//!erosion rate `e^a` for any exponent, with a general power
+struct ErosionPower {
+    //!name used by new_model and the drivers
+    static constexpr const char *name = "pow";
+    //!identifier in cache keys
+    static constexpr int id = 0;
+    //!whether the exponent is fixed, in which case the model's `a` must equal it
+    static constexpr bool fixed = false;
+    //!the fixed exponent
+    static constexpr double exponent = 0.0;
+    //!erosion rate per unit kb for an excess shear stress
+    template<typename T> static T rate (T e, T a) { return( std::pow(e, a) ); }
+    //!excess shear stress where the erosion rate per unit kb is `r`
+    static double inverse (double r, double a) { return( pow(r, 1/a) ); }
+};
+
+//!erosion rate linear in the excess shear stress, `a = 1`
+struct ErosionLinear {
+    static constexpr const char *name = "1";
+    static constexpr int id = 1;
+    static constexpr bool fixed = true;
+    static constexpr double exponent = 1.0;
+    template<typename T> static T rate (T e, T a) { (void)a; return( e ); }
+    static double inverse (double r, double a) { (void)a; return( r ); }
+};
+
+//!erosion rate `e^1.5`, as `e*sqrt(e)`
+struct ErosionThreeHalves {
+    static constexpr const char *name = "1.5";
+    static constexpr int id = 2;
+    static constexpr bool fixed = true;
+    static constexpr double exponent = 1.5;
+    template<typename T> static T rate (T e, T a) { (void)a; return( e*std::sqrt(e) ); }
+    static double inverse (double r, double a) { (void)a; return( cbrt(r*r) ); }
+};
+
+//!erosion rate quadratic in the excess shear stress, `a = 2`
+struct ErosionSquare {
+    static constexpr const char *name = "2";
+    static constexpr int id = 3;
+    static constexpr bool fixed = true;
+    static constexpr double exponent = 2.0;
+    template<typename T> static T rate (T e, T a) { (void)a; return( e*e ); }
+    static double inverse (double r, double a) { (void)a; return( sqrt(r) ); }
+};
+
+//------------------------------------------------------------------------------
+//channel width laws, giving the discharge over the sill as scale(...)*depth(h)*slope(S)
+
+//!discharge with Turowski's channel width, the original model, `Q = (Tc^(13/7)/n) h^(65/21) S^(13/14)`
+struct WidthTurowski {
+    static constexpr const char *name = "turowski";
+    static constexpr int id = 0;
+    //!exponents of the water depth and the slope in the discharge
+    static constexpr double eh = 65.0/21, eS = 13.0/14;
+    //!the part of the discharge's coefficient set by the parameters, computed once per evaluation in double precision
+    /*!
+    \param[in] Cw width constant
+    \param[in] B critical stress of erosion balancing uplift, `tauc + U/kb`, over `rho*g` [m]
+    */
+    static double coef (double Cw, double B) { return( Cw*pow(B, -3.0/13) ); }
+    //!the whole coefficient of the discharge
+    template<typename T> static T scale (T c, T n) { return( std::pow(c, T(13.0/7))/n ); }
+    //!the water depth factor of the discharge
+    template<typename T> static T depth (T h) { return( std::pow(h, T(eh)) ); }
+    //!the slope factor of the discharge
+    template<typename T> static T slope (T S) { return( std::pow(S, T(eS)) ); }
+    //!exponents of `Cw` and of `tauc + U/kb` in the discharge, for the partial derivatives
+    static constexpr double eC = 13.0/7, eB = (13.0/7)*(-3.0/13);
+};
+
+//!discharge of a wide channel of constant width `Cw` [m] with Manning's equation, `Q = (Cw/n) h^(5/3) S^(1/2)`
+struct WidthConstant {
+    static constexpr const char *name = "constant";
+    static constexpr int id = 1;
+    static constexpr double eh = 5.0/3, eS = 0.5;
+    static double coef (double Cw, double B) { (void)B; return( Cw ); }
+    template<typename T> static T scale (T c, T n) { return( c/n ); }
+    template<typename T> static T depth (T h) { return( h*std::cbrt(h*h) ); }
+    template<typename T> static T slope (T S) { return( std::sqrt(S) ); }
+    static constexpr double eC = 1.0, eB = 0.0;
+};
+
+//------------------------------------------------------------------------------
+//hypsometries, giving the Mediterranean area and ocean level
+
+//!the two exponential fit, whatever hypsometry is set
+struct HypsFit {
+    static constexpr const char *name = "fit";
+    //!whether the tabulated hypsometry is used, with 2 meaning it's decided at run time by whether one is set
+    static constexpr int table = 0;
+};
+
+//!the tabulated hypsometry, which must be set
+struct HypsTable {
+    static constexpr const char *name = "table";
+    static constexpr int table = 1;
+};
+
+//!the tabulated hypsometry if one is set and the two exponential fit otherwise, decided at every evaluation
+struct HypsRuntime {
+    static constexpr const char *name = "runtime";
+    static constexpr int table = 2;
+};
+
+//------------------------------------------------------------------------------
+
+//!bundle of the erosion, channel width, and hypsometry policies making up the right-hand side of the model
+template<class E, class W, class H> struct MscPolicy {
+    //!erosion law
+    typedef E Erosion;
+    //!channel width law
+    typedef W Width;
+    //!hypsometry
+    typedef H Hyps;
+    //!identifier in cache keys, which is zero for the policies giving the same results as MscDefault
+    static constexpr int id = E::id + 16*W::id;
+};
+
+//!the policies of MscGcv itself: the general power erosion law, Turowski's width, and either hypsometry
+typedef MscPolicy<ErosionPower, WidthTurowski, HypsRuntime> MscDefault;
+
+#endif
@@ -0,0 +1,105 @@
+//! \file progress.cc
+
+#include <chrono>
+
+#include "progress.h"
+
+//names of the result classes, in the order of the counters
+static const char *class_names[PROGRESS_NCLASS] = {"stable", "oscillating", "cutoff", "cached"};
+
+SweepProgress::SweepProgress (long unsigned ntrial, int nthread, double interval, const char *fn) :
+    nthread_ (nthread),
+    ntrial_ (ntrial),
+    interval_ (interval),
+    fn_ (fn),
+    stop_ (false) {
+
+    slots_ = new Slot[nthread];
+    for (int i=0; i<nthread; i++) {
+        for (int k=0; k<PROGRESS_NCLASS; k++) slots_[i].ndone[k].store(0);
+        slots_[i].trial.store(-1);
+        slots_[i].tstart.store(0.0);
+    }
+    t0_ = omp_get_wtime();
+    check_file_write(fn_.c_str());
+    reporter_ = std::thread(&SweepProgress::run, this);
+}
+
+SweepProgress::~SweepProgress () {
+
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    reporter_.join();
+    report();
+    delete [] slots_;
+}
+
+void SweepProgress::run () {
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    while ( !stop_ ) {
+        cv_.wait_for(lock, std::chrono::duration<double>(interval_));
+        if ( !stop_ ) report();
+    }
+}
+
+void SweepProgress::report () {
+
+    double t = omp_get_wtime(),
+           elapsed = t - t0_;
+    //sum the counters and find the slowest trials in progress
+    long unsigned n[PROGRESS_NCLASS] = {0}, ndone = 0;
+    long slow[PROGRESS_NSLOW];
+    double tslow[PROGRESS_NSLOW];
+    int nslow = 0;
+    for (int i=0; i<nthread_; i++) {
+        for (int k=0; k<PROGRESS_NCLASS; k++)
+            n[k] += slots_[i].ndone[k].load(std::memory_order_relaxed);
+        long trial = slots_[i].trial.load(std::memory_order_acquire);
+        if ( trial < 0 ) continue;
+        double dt = t - slots_[i].tstart.load(std::memory_order_relaxed);
+        //insert into the sorted list of slowest trials
+        int j = nslow < PROGRESS_NSLOW ? nslow++ : PROGRESS_NSLOW;
+        while ( (j > 0) && (tslow[j-1] < dt) ) {
+            if ( j < PROGRESS_NSLOW ) {
+                slow[j] = slow[j-1];
+                tslow[j] = tslow[j-1];
+            }
+            j--;
+        }
+        if ( j < PROGRESS_NSLOW ) {
+            slow[j] = trial;
+            tslow[j] = dt;
+        }
+    }
+    for (int k=0; k<PROGRESS_NCLASS; k++) ndone += n[k];
+    double rate = elapsed > 0 ? ndone/elapsed : 0,
+           eta = ndone > 0 ? (ntrial_ - ndone)/rate : -1;
+
+    //one line on stderr
+    fprintf(stderr, "progress: %lu/%lu trials (%.1f %%) in %.0f s, %.3g trials/s, ",
+        ndone, ntrial_, 100*double(ndone)/ntrial_, elapsed, rate);
+    if ( eta >= 0 ) fprintf(stderr, "eta %.0f s", eta);
+    else fprintf(stderr, "eta unknown");
+    if ( nslow > 0 ) fprintf(stderr, ", slowest trial %ld at %.0f s", slow[0], tslow[0]);
+    fprintf(stderr, "\n");
+
+    //heartbeat file, replaced atomically
+    std::string fntmp = fn_ + ".tmp";
+    FILE *ofile = fopen(fntmp.c_str(), "w");
+    if ( !ofile ) return;
+    fprintf(ofile, "elapsed %.3f\n", elapsed);
+    fprintf(ofile, "done %lu\n", ndone);
+    fprintf(ofile, "total %lu\n", ntrial_);
+    fprintf(ofile, "rate %g\n", rate);
+    for (int k=0; k<PROGRESS_NCLASS; k++)
+        fprintf(ofile, "rate_%s %g\n", class_names[k], elapsed > 0 ? n[k]/elapsed : 0);
+    fprintf(ofile, "eta %.0f\n", eta);
+    for (int j=0; j<nslow; j++)
+        fprintf(ofile, "slow_trial %ld\nslow_seconds %.3f\n", slow[j], tslow[j]);
+    fclose(ofile);
+    rename(fntmp.c_str(), fn_.c_str());
+}
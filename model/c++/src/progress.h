@@ -0,0 +1,106 @@
+#ifndef PROGRESS_H_
+#define PROGRESS_H_
+
+//! \file progress.h
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+
+#include "omp.h"
+
+#include "util.h"
+
+//!number of results counted separately by SweepProgress, the three oscillation codes and cache hits
+#define PROGRESS_NCLASS 4
+//!number of the slowest in-flight trials reported by SweepProgress
+#define PROGRESS_NSLOW 3
+
+//!periodic report of the progress, throughput, and expected finish of a parallel sweep
+/*!
+Every worker thread owns a counter slot on its own cache line, holding its number of finished trials by class and the index and start time of the trial it's working on. Only the owning thread writes to a slot, with relaxed atomic stores, so the workers never share a lock or a cache line and marking a trial costs a few plain stores.
+
+A separate reporting thread wakes up at a fixed interval, sums the slots without locking, and writes a line to stderr and a small heartbeat file. The heartbeat file is replaced atomically by renaming a temporary file, so it can be read at any time, for example by a job script checking whether a sweep will finish within its time limit. It has one `key value` pair per line:
++ `elapsed`, seconds since start
++ `done` and `total`, numbers of trials
++ `rate`, finished trials per second since start
++ `rate_stable`, `rate_oscillating`, `rate_cutoff`, and `rate_cached`, the same rate for each kind of result
++ `eta`, expected seconds remaining at the overall rate, or -1 before any trial finishes
++ `slow_trial` and `slow_seconds`, repeated for each of the slowest in-flight trials, in decreasing order of running time
+*/
+class SweepProgress {
+
+public:
+
+    //!constructs and starts the reporting thread
+    /*!
+    \param[in] ntrial total number of trials
+    \param[in] nthread number of worker threads
+    \param[in] interval seconds between reports
+    \param[in] fn path to the heartbeat file
+    */
+    SweepProgress (long unsigned ntrial, int nthread, double interval, const char *fn);
+    //!stops the reporting thread after a final report
+    ~SweepProgress ();
+
+    //!marks the start of a trial by the calling worker
+    /*!
+    \param[in] thread OpenMP thread number of the worker
+    \param[in] trial index of the trial
+    */
+    void start (int thread, long unsigned trial) {
+        Slot &s = slots_[thread];
+        s.tstart.store(omp_get_wtime(), std::memory_order_relaxed);
+        s.trial.store((long)trial, std::memory_order_release);
+    }
+    //!marks the end of the current trial of the calling worker
+    /*!
+    \param[in] thread OpenMP thread number of the worker
+    \param[in] osc oscillation code of the trial, from MscGcv::has_oscillation
+    \param[in] cached whether the result came from a cache instead of an integration
+    */
+    void finish (int thread, int osc, bool cached=false) {
+        Slot &s = slots_[thread];
+        int k = cached ? 3 : osc + 1;
+        if ( (k >= 0) && (k < PROGRESS_NCLASS) )
+            s.ndone[k].store(s.ndone[k].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        s.trial.store(-1, std::memory_order_release);
+    }
+
+    //!writes a report immediately
+    void report ();
+
+private:
+
+    //counters of one worker, padded to a whole cache line
+    struct alignas(64) Slot {
+        //finished trials by class
+        std::atomic<long unsigned> ndone[PROGRESS_NCLASS];
+        //trial in progress, or -1
+        std::atomic<long> trial;
+        //wall time the trial in progress started
+        std::atomic<double> tstart;
+    };
+    //one slot per worker
+    Slot *slots_;
+    int nthread_;
+    //total number of trials
+    long unsigned ntrial_;
+    //seconds between reports and wall time of the start
+    double interval_, t0_;
+    //heartbeat file
+    std::string fn_;
+    //reporting thread and what it waits on
+    std::thread reporter_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool stop_;
+    //loop of the reporting thread
+    void run ();
+};
+
+#endif
@@ -0,0 +1,51 @@
+//! \file sens.cc
+
+#include "sens.h"
+
+MscGcvSens::MscGcvSens (MscGcv *sys) :
+    OdeVern65 (NAUG),
+    sys_ (sys) {
+
+    set_name("msc_gcv_sens");
+
+    //parameters in SI units
+    p_[0] = sys->kb;
+    p_[1] = sys->tauc;
+    p_[2] = sys->Cw;
+    p_[3] = sys->U;
+    p_[4] = sys->a;
+    p_[5] = sys->L;
+
+    //same adaptive time step settings as the model
+    set_tol(sys->get_tol());
+    set_facmin(1e-2);
+    set_facmax(1e1);
+
+    init(-60.0, 0.0);
+}
+
+void MscGcvSens::init (double zs, double zm) {
+    set_sol(0, zs);
+    set_sol(1, zm);
+    for (int i=2; i<NAUG; i++) set_sol(i, 0.0);
+}
+
+double MscGcvSens::get_grad (int i, int j) {
+    if ( p_[j] == 0 ) return(NAN);
+    return( get_sens(i, j)/p_[j] );
+}
+
+void MscGcvSens::ode_fun (double *solin, double *fout) {
+
+    double dfdx[2][2], dfdp[2][NSENS];
+    //state
+    sys_->ode_fun_prec(solin, fout);
+    sys_->ode_partials(solin, dfdx, dfdp);
+    //scaled sensitivities
+    const double *ss = solin + 2,
+                 *sm = solin + 2 + NSENS;
+    for (int j=0; j<NSENS; j++) {
+        fout[2+j] = dfdx[0][0]*ss[j] + dfdx[0][1]*sm[j] + p_[j]*dfdp[0][j];
+        fout[2+NSENS+j] = dfdx[1][0]*ss[j] + dfdx[1][1]*sm[j] + p_[j]*dfdp[1][j];
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef SENS_H_
+#define SENS_H_
+
+//! \file sens.h
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "util.h"
+#include "msc_gcv.h"
+
+//header file for ODE integrator class
+#include "ode_vern_65.h"
+
+//!number of equations in the system augmented with sensitivities
+#define NAUG (2 + 2*NSENS)
+
+//!integrates the model together with the forward sensitivities of its state to the parameters `kb`, `tauc`, `Cw`, `U`, `a`, and `L`
+/*!
+The augmented state holds the sill and Mediterranean levels followed by the scaled sensitivities `p*dzs/dp` for each parameter `p` and then `p*dzm/dp`, all in meters. Scaling by the parameter values keeps every component on the same scale as the levels, so the same error tolerance can control all of them. The sensitivities obey the tangent linear equations
+
+    d/dt (p*dz/dp) = (df/dz)(p*dz/dp) + p*(df/dp)
+
+using the analytic partial derivatives from MscGcv::ode_partials. A single augmented integration replaces two perturbed integrations for every parameter and has no finite difference error.
+*/
+class MscGcvSens : public OdeVern65 {
+
+public:
+
+    //!constructs
+    /*!
+    \param[in] sys model object supplying the parameters, hypsometry, and tolerance, which must not change while this object is used
+    */
+    MscGcvSens (MscGcv *sys);
+
+    //!sets the initial state, where all sensitivities are zero
+    void init (double zs, double zm);
+
+    //!gets the scaled sensitivity `p*dz/dp` of a level to a parameter [m]
+    /*!
+    \param[in] i zero for sill level, one for Mediterranean level
+    \param[in] j index of the parameter in param_names, less than NSENS
+    */
+    double get_sens (int i, int j) { return(get_sol(2 + i*NSENS + j)); }
+    //!gets the sensitivity `dz/dp` of a level to a parameter, in meters per SI unit of the parameter
+    double get_grad (int i, int j);
+
+    //!implements the augmented system of ODEs
+    void ode_fun (double *solin, double *fout);
+
+private:
+
+    //model supplying ode_fun and its partial derivatives
+    MscGcv *sys_;
+    //parameter values, in SI units
+    double p_[NSENS];
+};
+
+#endif
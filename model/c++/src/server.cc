@@ -0,0 +1,145 @@
+//! \file server.cc
+
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#include "server.h"
+#include "mixed.h"
+
+//------------------------------------------------------------------------------
+//stream helpers
+
+//reads exactly n bytes, returning the number read before the stream ended
+static size_t read_full (int fd, void *buf, size_t n) {
+    size_t got = 0;
+    while ( got < n ) {
+        ssize_t r = read(fd, (char*)buf + got, n - got);
+        if ( r < 0 ) {
+            if ( errno == EINTR ) continue;
+            break;
+        }
+        if ( r == 0 ) break;
+        got += r;
+    }
+    return(got);
+}
+
+//writes exactly n bytes, returning whether they were all written
+static bool write_full (int fd, const void *buf, size_t n) {
+    size_t put = 0;
+    while ( put < n ) {
+        ssize_t r = write(fd, (const char*)buf + put, n - put);
+        if ( r < 0 ) {
+            if ( errno == EINTR ) continue;
+            return(false);
+        }
+        put += r;
+    }
+    return(true);
+}
+
+//------------------------------------------------------------------------------
+//server
+
+BatchServer::BatchServer (bool mixed) :
+    mixed_ (mixed),
+    nthread_ (omp_get_max_threads()),
+    nset_ (0) {
+
+    sys_ = new MscGcv[nthread_];
+}
+
+BatchServer::~BatchServer () {
+    delete [] sys_;
+}
+
+void BatchServer::classify (const std::vector<double> &par, std::vector<int32_t> &cla) {
+
+    long nrow = cla.size();
+    #pragma omp parallel for schedule(dynamic)
+    for (long i=0; i<nrow; i++) {
+        int n = omp_get_thread_num();
+        const double *p = &par[i*NPARAM];
+        //reject parameters that can't be integrated
+        bool finite = true;
+        for (int j=0; j<NPARAM; j++)
+            if ( !std::isfinite(p[j]) ) finite = false;
+        if ( !finite ) {
+            cla[i] = SERVER_INVALID;
+            continue;
+        }
+        for (int j=0; j<NPARAM; j++) sys_[n].set_param(j, p[j]);
+        if ( mixed_ ) {
+            bool fallback;
+            cla[i] = has_oscillation_mixed(&sys_[n], &fallback);
+        } else {
+            cla[i] = sys_[n].has_oscillation();
+        }
+    }
+}
+
+int BatchServer::serve (int fdin, int fdout) {
+
+    std::vector<double> par;
+    std::vector<int32_t> cla;
+    while ( true ) {
+        //header
+        char magic[4];
+        uint32_t nrow;
+        uint64_t tag;
+        size_t got = read_full(fdin, magic, 4);
+        if ( got == 0 ) return(0);
+        double ts = omp_get_wtime();
+        if ( (got < 4) || (memcmp(magic, "MSCQ", 4) != 0) ) {
+            fprintf(stderr, "invalid request header, closing stream\n");
+            return(1);
+        }
+        if ( (read_full(fdin, &nrow, 4) < 4) || (read_full(fdin, &tag, 8) < 8) ) {
+            fprintf(stderr, "incomplete request header, closing stream\n");
+            return(1);
+        }
+        if ( nrow > SERVER_MAX_SETS ) {
+            fprintf(stderr, "request with tag %lu has too many parameter sets, closing stream\n", (unsigned long)tag);
+            return(1);
+        }
+        //parameter sets
+        par.resize((size_t)nrow*NPARAM);
+        cla.resize(nrow);
+        if ( read_full(fdin, par.data(), par.size()*sizeof(double)) < par.size()*sizeof(double) ) {
+            fprintf(stderr, "incomplete request with tag %lu, closing stream\n", (unsigned long)tag);
+            return(1);
+        }
+        classify(par, cla);
+        //response
+        double lat = omp_get_wtime() - ts;
+        bool ok = write_full(fdout, "MSCR", 4)
+               && write_full(fdout, &nrow, 4)
+               && write_full(fdout, &tag, 8)
+               && write_full(fdout, &lat, 8)
+               && write_full(fdout, cla.data(), cla.size()*sizeof(int32_t));
+        if ( !ok ) {
+            fprintf(stderr, "failed to write response with tag %lu, closing stream\n", (unsigned long)tag);
+            return(1);
+        }
+        lat_.push_back(lat);
+        nset_ += nrow;
+    }
+}
+
+void BatchServer::print_stats (FILE *f) {
+
+    fprintf(f, "%lu requests with %lu parameter sets served\n", (unsigned long)lat_.size(), nset_);
+    if ( lat_.empty() ) return;
+    std::vector<double> lat = lat_;
+    std::sort(lat.begin(), lat.end());
+    double sum = 0.0;
+    for (unsigned long i=0; i<lat.size(); i++) sum += lat[i];
+    fprintf(f, "request latency [ms]:\n");
+    fprintf(f, "  mean = %g\n", 1e3*sum/lat.size());
+    fprintf(f, "  min  = %g\n", 1e3*lat[0]);
+    fprintf(f, "  50%%  = %g\n", 1e3*lat[lat.size()/2]);
+    fprintf(f, "  95%%  = %g\n", 1e3*lat[(95*lat.size())/100]);
+    fprintf(f, "  max  = %g\n", 1e3*lat[lat.size()-1]);
+}
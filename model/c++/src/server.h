@@ -0,0 +1,76 @@
+#ifndef SERVER_H_
+#define SERVER_H_
+
+//! \file server.h
+
+#include <cmath>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#include "omp.h"
+
+#include "util.h"
+#include "msc_gcv.h"
+
+//!oscillation code returned for parameter sets that can't be classified
+#define SERVER_INVALID 2
+//!largest number of parameter sets in a request
+#define SERVER_MAX_SETS 16777216
+
+//!long running classification of parameter set batches received over a byte stream
+/*!
+Requests and responses are binary frames in native byte order. A request is
++ the characters "MSCQ"
++ a uint32 number of parameter sets
++ a uint64 request tag chosen by the client
++ the parameter sets as float64 rows of all NPARAM parameters, in the order and units of MscGcv::set_param
+
+A response, sent for every request in the order received, is
++ the characters "MSCR"
++ a uint32 number of parameter sets
++ the uint64 request tag
++ a float64 latency, the seconds between receiving the first byte of the request and sending the response
++ an int32 oscillation code for each parameter set, as returned by MscGcv::has_oscillation, or SERVER_INVALID for parameter sets that aren't finite
+
+The model objects are created once, one per thread, and reused for every batch, and the OpenMP threads stay alive between parallel loops, so a batch costs little more than its classifications.
+*/
+class BatchServer {
+
+public:
+
+    //!constructs
+    /*!
+    \param[in] mixed whether to classify with has_oscillation_mixed instead of MscGcv::has_oscillation
+    */
+    BatchServer (bool mixed=false);
+    //!destructs
+    ~BatchServer ();
+
+    //!answers requests from one stream until it ends
+    /*!
+    \param[in] fdin file descriptor requests are read from
+    \param[in] fdout file descriptor responses are written to
+    \return zero if the stream ended cleanly between requests
+    */
+    int serve (int fdin, int fdout);
+
+    //!prints the number of requests served and latency statistics
+    void print_stats (FILE *f);
+
+private:
+
+    //classification method
+    bool mixed_;
+    //model objects, one per thread
+    int nthread_;
+    MscGcv *sys_;
+    //latency of every request and number of parameter sets
+    std::vector<double> lat_;
+    unsigned long nset_;
+    //classifies a batch in parallel
+    void classify (const std::vector<double> &par, std::vector<int32_t> &cla);
+};
+
+#endif
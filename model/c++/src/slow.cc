@@ -0,0 +1,154 @@
+//! \file slow.cc
+
+#include "slow.h"
+
+//Dormand-Prince 5(4) tableau
+static const double dpa[7][6] = {
+    {0},
+    {1.0/5},
+    {3.0/40, 9.0/40},
+    {44.0/45, -56.0/15, 32.0/9},
+    {19372.0/6561, -25360.0/2187, 64448.0/6561, -212.0/729},
+    {9017.0/3168, -355.0/33, 46732.0/5247, 49.0/176, -5103.0/18656},
+    {35.0/384, 0.0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84}
+};
+static const double dpe[7] = {
+    71.0/57600, 0.0, -71.0/16695, 71.0/1920, -17253.0/339200, 22.0/525, -1.0/40
+};
+
+SlowManifold::SlowManifold (MscGcv *sys) :
+    Newton (1),
+    sys_ (sys),
+    zs_ (NAN),
+    scale_ (1.0),
+    fs_ (NAN),
+    ready_ (false),
+    nstep_ (0),
+    nrej_ (0) {
+
+    //a single Jacobian per solve, since every guess is close to the manifold
+    set_modified(true);
+    set_tol_Newton(1e-9);
+    set_iter_Newton(20);
+}
+
+void SlowManifold::f_Newton (double *x, double *f) {
+    double z[2] = {zs_, x[0]}, fout[2];
+    sys_->ode_fun_prec(z, fout);
+    fs_ = fout[0];
+    f[0] = fout[1]/scale_;
+}
+
+void SlowManifold::J_Newton (double *x, double **J) {
+    double z[2] = {zs_, x[0]}, dfdp[2][NSENS];
+    sys_->ode_partials(z, dfdx_, dfdp);
+    //the residual is a distance in meters where the fast rate is known
+    scale_ = (dfdx_[1][1] < 0) ? -dfdx_[1][1] : 1.0/YRSEC;
+    J[0][0] = dfdx_[1][1]/scale_;
+}
+
+int SlowManifold::level (double zs, double *zm) {
+    zs_ = zs;
+    return( solve_Newton(zm) );
+}
+
+int SlowManifold::eval (double zs, double guess, double *zm0, double *c, double *g,
+                        double *slope, double *lf, double *eps) {
+
+    *zm0 = guess;
+    int suc = level(zs, zm0);
+    if ( suc != 0 ) return(suc);
+    //rates from the Jacobian at the guess, which is close enough for the correction
+    *lf = dfdx_[1][1];
+    *slope = -dfdx_[1][0]/dfdx_[1][1];
+    *eps = fabs((dfdx_[0][0] + dfdx_[0][1]*(*slope))/dfdx_[1][1]);
+    //lag behind the moving manifold and the sill rate at the corrected level
+    *c = (*slope)*fs_/(*lf);
+    *g = fs_ + dfdx_[0][1]*(*c);
+    return(0);
+}
+
+bool SlowManifold::enter (const double *z) {
+
+    double fout[2], dfdx[2][2], dfdp[2][NSENS];
+    sys_->ode_fun_prec(z, fout);
+    sys_->ode_partials(z, dfdx, dfdp);
+    double lf = dfdx[1][1];
+    if ( !(lf < 0) ) return(false);
+    double slope = -dfdx[1][0]/lf,
+           eps = fabs((dfdx[0][0] + dfdx[0][1]*slope)/lf),
+           d = fout[1]/lf,         //distance above the manifold
+           c = slope*fout[0]/lf;   //distance above the manifold of the corrected manifold
+    if ( (eps > SLOW_EPS) || (fabs(d - c) > SLOW_TOLFAC*sys_->get_tol()*(1 + fabs(z[1]))) ) return(false);
+    //the reduced state at the entry, keeping the sill level
+    double e;
+    if ( eval(z[0], z[1] - d, &zm0_, &c_, &g_, &slope_, &lf_, &e) != 0 ) return(false);
+    ready_ = true;
+    return(true);
+}
+
+int SlowManifold::step (double *t, double *zs, double *zm, double *h, double tend) {
+
+    if ( !ready_ ) return(1);
+    double tol = sys_->get_tol(),
+           k[7], zm0[7], c[7], slope, lf, eps, inc, zss, guess, err, fac, hh;
+    bool last;
+    k[0] = g_;
+    while ( true ) {
+        //too short to be worth it, compared with the fast time scale
+        if ( *h < SLOW_HMIN/fabs(lf_) ) {
+            ready_ = false;
+            return(1);
+        }
+        hh = *h;
+        last = false;
+        if ( *t + hh >= tend ) {
+            hh = tend - *t;
+            last = true;
+        }
+        //stages, with guesses along the manifold's slope from the start of the step
+        //and a bound on Newton's correction so that a long step can't land on another branch
+        bool ok = true;
+        for (int s=1; (s<7) && ok; s++) {
+            inc = 0.0;
+            for (int j=0; j<s; j++) inc += dpa[s][j]*k[j];
+            zss = *zs + hh*inc;
+            guess = zm0_ + slope_*hh*inc;
+            ok = (eval(zss, guess, &zm0[s], &c[s], &k[s], &slope, &lf, &eps) == 0)
+              && (fabs(zm0[s] - guess) <= SLOW_BRANCH*fabs(guess - zm0_) + tol*(1 + fabs(zm0_)));
+        }
+        if ( ok ) {
+            //error of the sill level, and of the Mediterranean level through the manifold's slope
+            double e = 0.0;
+            for (int j=0; j<7; j++) e += dpe[j]*k[j];
+            e = fabs(hh*e);
+            err = std::max(e/(tol*(1 + fabs(*zs))), fabs(slope_)*e/(tol*(1 + fabs(zm0_ + c_))));
+            //the end must still be slaved, with a negligible second order correction
+            double c2 = fabs((c[6] - c_)/(hh*lf));
+            ok = std::isfinite(err) && (lf < 0) && (eps <= SLOW_EPS) && (c2 <= SLOW_TOLFAC*tol*(1 + fabs(zm0[6])));
+        }
+        if ( !ok ) {
+            //not slaved somewhere in the step, so approach the edge of the manifold
+            nrej_++;
+            *h = hh/4;
+            continue;
+        }
+        fac = (err > 0.0) ? 0.9*pow(err, -0.2) : 10.0;
+        fac = std::min(std::max(fac, 1e-2), 1e1);
+        if ( err <= 1.0 ) {
+            *zs += hh*inc;
+            *t = last ? tend : *t + hh;
+            zm0_ = zm0[6];
+            c_ = c[6];
+            g_ = k[6];
+            slope_ = slope;
+            lf_ = lf;
+            *zm = zm0_ + c_;
+            if ( !last ) *h = hh*fac;
+            nstep_++;
+            return(0);
+        }
+        nrej_++;
+        *h = hh*fac;
+    }
+}
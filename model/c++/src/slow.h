@@ -0,0 +1,110 @@
+#ifndef SLOW_H_
+#define SLOW_H_
+
+//! \file slow.h
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "util.h"
+#include "newton.h"
+#include "msc_gcv.h"
+
+//!largest ratio of the slow to the fast rate for a state to be treated as slaved
+#define SLOW_EPS 0.05
+//!number of full steps between checks for slaving
+#define SLOW_PROBE 16.0
+//!largest number of full steps between checks for slaving, which doubles from SLOW_PROBE after every failed check with rejected steps since the last one
+#define SLOW_PROBE_MAX 1024.0
+//!factor of the integrator's tolerance allowed for the lag of the Mediterranean level off the corrected manifold
+#define SLOW_TOLFAC 100.0
+//!largest Newton correction of the manifold level at a stage, relative to its change extrapolated along the manifold's slope
+#define SLOW_BRANCH 0.5
+//!shortest reduced step, in fast time scales, before handing back to the full system
+#define SLOW_HMIN 10.0
+
+//!integration of the reduced system on the slow manifold of the model, where the Mediterranean level is slaved to the sill level
+/*!
+The Mediterranean level relaxes toward the level where its time derivative vanishes at a rate `lf = d(dzm/dt)/dzm`, which is often far faster than the sill level changes, at the rate `ls` of the sill equation along that level. While `|ls/lf|` is small, the Mediterranean level is slaved to the sill level and stays within a small lag of the slow manifold `zm = M(zs)` defined by `dzm/dt(zs, M(zs)) = 0`, so the full system is stiff and the adaptive integrator is held to steps of a few fast time scales for stability. On the manifold, only the sill equation is integrated,
+
+    dzs/dt = g(zs) = dzs/dt(zs, M(zs) + c)
+
+where `M(zs)` is found with Newton's method from a guess extrapolated along the manifold, and `c = M'(zs) g/lf` is the first order correction for the lag of the Mediterranean level behind the moving manifold. The reduced equation is integrated with Dormand-Prince 5(4) steps and the error control of the model's tolerance, in steps limited only by the slow dynamics.
+
+A reduced step is only accepted if Newton's method follows the same branch of the manifold at every stage, correcting the level extrapolated along the manifold's slope by at most SLOW_BRANCH times the extrapolated change, and if its end is still slaved: the manifold must attract (`lf < 0`), the rate ratio must be below SLOW_EPS, and the second order correction, estimated from the change of `c` over the step, must be within SLOW_TOLFAC times the integrator's tolerance of the Mediterranean level. The factor is loose because the full system, late in a slaved phase, legitimately lags the first order manifold by more than its own tolerance, while the sill level it controls is still integrated to tolerance. Otherwise the step is shortened, and once it is shorter than SLOW_HMIN fast time scales the manifold is abandoned for the full system. This happens approaching a fold of the manifold, where `lf` vanishes and the level jumps, and at the onset of erosion, where the sill rate changes abruptly.
+
+The full system checks for slaving every SLOW_PROBE steps, restarting the integrator each time. Where the step size is held at its stability limit, every restart costs about one rejected step, so the checks are spread out, up to SLOW_PROBE_MAX steps apart, while they fail with rejected steps in between. The reduction pays off only for long slaved phases, as in relaxation oscillations, where it can halve the cost of a trial. Where the Mediterranean level is slaved only briefly, as in the default `single.exe` run, it takes about as long as the full system.
+
++ [Fenichel, N. Geometric singular perturbation theory for ordinary differential equations. J. Differ. Equ. 31, 53–98 (1979).](https://doi.org/10.1016/0022-0396(79)90152-9)
+*/
+class SlowManifold : public Newton {
+
+public:
+
+    //!constructs
+    /*!
+    \param[in] sys model object whose equations are reduced, with its tolerance set
+    */
+    SlowManifold (MscGcv *sys);
+
+    //!finds the level of the slow manifold at a sill level
+    /*!
+    \param[in] zs sill level
+    \param[in,out] zm guess for the Mediterranean level and the level where its time derivative vanishes
+    \return zero for success, or the failure code of Newton::solve_Newton
+    */
+    int level (double zs, double *zm);
+
+    //!checks whether a state of the full system is slaved and close to the slow manifold, preparing a reduced integration from it
+    /*!
+    The distance of the Mediterranean level from the corrected manifold is estimated from its time derivative, without solving for the manifold, so the check costs two evaluations of the right-hand side.
+    \param[in] z sill and Mediterranean levels
+    \return whether the reduced system can be integrated from the state
+    */
+    bool enter (const double *z);
+
+    //!takes a reduced step on the slow manifold, with error control
+    /*!
+    \param[in,out] t time
+    \param[in,out] zs sill level
+    \param[out] zm Mediterranean level on the corrected manifold
+    \param[in,out] h trial step size, and the proposed size of the next step
+    \param[in] tend time not to step past
+    \return zero if a step was taken, or one if the state is no longer slaved, in which case nothing is changed except `h`
+    */
+    int step (double *t, double *zs, double *zm, double *h, double tend);
+
+    //!number of reduced steps taken
+    long get_nstep () { return(nstep_); }
+    //!number of reduced steps rejected, for error or because their end wasn't slaved
+    long get_nrej () { return(nrej_); }
+
+protected:
+
+    //time derivative of the Mediterranean level, scaled by the fast rate to a distance from the manifold [m]
+    void f_Newton (double *x, double *f);
+    //its analytic derivative
+    void J_Newton (double *x, double **J);
+
+private:
+
+    //model object
+    MscGcv *sys_;
+    //sill level of the current solve and the scale of the residual
+    double zs_, scale_;
+    //rates at the last Jacobian evaluation
+    double dfdx_[2][2];
+    //sill rate at the last function evaluation
+    double fs_;
+    //reduced state at the start of the step: manifold level, correction, sill rate, slope of the manifold, and fast rate
+    double zm0_, c_, g_, slope_, lf_;
+    bool ready_;
+    //statistics
+    long nstep_, nrej_;
+    //evaluates the reduced system at a sill level, returning Newton's code
+    int eval (double zs, double guess, double *zm0, double *c, double *g,
+              double *slope, double *lf, double *eps);
+};
+
+#endif
@@ -0,0 +1,119 @@
+//! \file stats.cc
+
+#include "stats.h"
+
+void RunningStats::add (double x) {
+    n_++;
+    double d = x - mean_;
+    mean_ += d/double(n_);
+    m2_ += d*(x - mean_);
+    if ( x < lo_ ) lo_ = x;
+    if ( x > hi_ ) hi_ = x;
+}
+
+void RunningStats::merge (const RunningStats &o) {
+    if ( o.n_ == 0 ) return;
+    if ( n_ == 0 ) {
+        *this = o;
+        return;
+    }
+    double na = double(n_), nb = double(o.n_), n = na + nb, d = o.mean_ - mean_;
+    mean_ += d*nb/n;
+    m2_ += o.m2_ + d*d*na*nb/n;
+    n_ += o.n_;
+    if ( o.lo_ < lo_ ) lo_ = o.lo_;
+    if ( o.hi_ > hi_ ) hi_ = o.hi_;
+}
+
+//------------------------------------------------------------------------------
+
+QuantileSketch::QuantileSketch (double alpha) :
+    alpha_ (alpha),
+    lg_ (log((1 + alpha)/(1 - alpha))),
+    nzero_ (0),
+    n_ (0),
+    lo_ (INFINITY),
+    hi_ (-INFINITY) {
+
+    if ( !(alpha > 0) || !(alpha < 1) ) {
+        printf("FAILURE: quantile sketch accuracy must be between zero and one, not %g\n", alpha);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void QuantileSketch::add (double x) {
+    if ( std::isnan(x) ) return;
+    n_++;
+    if ( x < lo_ ) lo_ = x;
+    if ( x > hi_ ) hi_ = x;
+    if ( x > STATS_ZERO ) pos_[bucket(x)]++;
+    else if ( x < -STATS_ZERO ) neg_[bucket(-x)]++;
+    else nzero_++;
+}
+
+void QuantileSketch::merge (const QuantileSketch &o) {
+    if ( o.alpha_ != alpha_ ) {
+        printf("FAILURE: can't merge quantile sketches with accuracies %g and %g\n", alpha_, o.alpha_);
+        exit(EXIT_FAILURE);
+    }
+    for (std::map<int,int64_t>::const_iterator it=o.pos_.begin(); it!=o.pos_.end(); it++)
+        pos_[it->first] += it->second;
+    for (std::map<int,int64_t>::const_iterator it=o.neg_.begin(); it!=o.neg_.end(); it++)
+        neg_[it->first] += it->second;
+    nzero_ += o.nzero_;
+    n_ += o.n_;
+    if ( o.lo_ < lo_ ) lo_ = o.lo_;
+    if ( o.hi_ > hi_ ) hi_ = o.hi_;
+}
+
+double QuantileSketch::quantile (double q) const {
+    if ( n_ == 0 ) return(NAN);
+    return( std::min(std::max(estimate(q), lo_), hi_) );
+}
+
+double QuantileSketch::estimate (double q) const {
+    q = std::min(std::max(q, 0.0), 1.0);
+    int64_t rank = (int64_t)floor(q*double(n_ - 1)), seen = 0;
+    //negative values in increasing order are the largest magnitudes first
+    for (std::map<int,int64_t>::const_reverse_iterator it=neg_.rbegin(); it!=neg_.rend(); it++) {
+        seen += it->second;
+        if ( seen > rank ) return(-value(it->first));
+    }
+    seen += nzero_;
+    if ( seen > rank ) return(0.0);
+    for (std::map<int,int64_t>::const_iterator it=pos_.begin(); it!=pos_.end(); it++) {
+        seen += it->second;
+        if ( seen > rank ) return(value(it->first));
+    }
+    return(value(pos_.rbegin()->first));
+}
+
+//------------------------------------------------------------------------------
+
+void wilson_interval (int64_t k, int64_t n, double z, double *lo, double *hi) {
+    if ( n <= 0 ) {
+        *lo = 0.0;
+        *hi = 1.0;
+        return;
+    }
+    double nn = double(n), p = double(k)/nn, z2 = z*z,
+           c = (p + z2/(2*nn))/(1 + z2/nn),
+           h = z*sqrt(p*(1 - p)/nn + z2/(4*nn*nn))/(1 + z2/nn);
+    //exact bounds when every trial fails or succeeds, which rounding would miss
+    *lo = (k > 0) ? std::max(c - h, 0.0) : 0.0;
+    *hi = (k < n) ? std::min(c + h, 1.0) : 1.0;
+}
+
+double normal_quantile (double conf) {
+    if ( !(conf > 0) || !(conf < 1) ) {
+        printf("FAILURE: confidence level must be between zero and one, not %g\n", conf);
+        exit(EXIT_FAILURE);
+    }
+    //bisection of the two sided tail probability, which is monotone in z
+    double lo = 0.0, hi = 40.0, z = 0.0;
+    for (int i=0; i<200; i++) {
+        z = (lo + hi)/2;
+        if ( erfc(z/sqrt(2.0)) > 1 - conf ) lo = z; else hi = z;
+    }
+    return(z);
+}
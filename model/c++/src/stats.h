@@ -0,0 +1,120 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+//! \file stats.h
+
+#include <cmath>
+#include <map>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+//!smallest magnitude counted by QuantileSketch as nonzero
+#define STATS_ZERO 1e-12
+
+//!running count, mean, variance, and range of a stream of values, mergeable with others
+/*!
+The mean and the sum of squared deviations are updated with Welford's method, and two streams are merged with the pairwise formula of Chan, Golub, and LeVeque, so partial statistics kept by separate threads can be combined without storing any values.
+*/
+class RunningStats {
+
+public:
+
+    //!constructs empty
+    RunningStats () { clear(); }
+
+    //!empties
+    void clear () { n_ = 0; mean_ = 0.0; m2_ = 0.0; lo_ = INFINITY; hi_ = -INFINITY; }
+    //!adds a value
+    void add (double x);
+    //!adds all the values of another stream
+    void merge (const RunningStats &o);
+
+    //!number of values
+    int64_t get_n () const { return(n_); }
+    //!mean, or NAN without values
+    double get_mean () const { return((n_ > 0) ? mean_ : NAN); }
+    //!sample variance, or NAN with fewer than two values
+    double get_var () const { return((n_ > 1) ? m2_/double(n_ - 1) : NAN); }
+    //!standard error of the mean, or NAN with fewer than two values
+    double get_sem () const { return((n_ > 1) ? sqrt(get_var()/double(n_)) : NAN); }
+    //!smallest value
+    double get_min () const { return((n_ > 0) ? lo_ : NAN); }
+    //!largest value
+    double get_max () const { return((n_ > 0) ? hi_ : NAN); }
+
+private:
+
+    int64_t n_;
+    double mean_, m2_, lo_, hi_;
+};
+
+//!quantile sketch with a bounded relative error, mergeable with others
+/*!
+Values are counted in logarithmic buckets, separately for positive and negative values, with bucket `i` holding magnitudes in `(g^(i-1), g^i]` for `g = (1 + alpha)/(1 - alpha)`. Any quantile is then estimated within a relative error `alpha` of a value of the stream at the right rank, and sketches with the same `alpha` merge exactly by adding their bucket counts. Magnitudes below STATS_ZERO are counted as zero. The number of buckets grows only with the logarithm of the range of magnitudes, about 700 for six decades at the default 1 % error, no matter how many values are added.
+
++ [Masson, C., Rim, J. E. & Lee, H. K. DDSketch: a fast and fully-mergeable quantile sketch with relative-error guarantees. Proc. VLDB Endow. 12, 2195–2205 (2019).](https://doi.org/10.14778/3352063.3352135)
+*/
+class QuantileSketch {
+
+public:
+
+    //!constructs empty
+    /*!
+    \param[in] alpha relative accuracy of the quantiles
+    */
+    QuantileSketch (double alpha=0.01);
+
+    //!empties
+    void clear () { pos_.clear(); neg_.clear(); nzero_ = 0; n_ = 0; lo_ = INFINITY; hi_ = -INFINITY; }
+    //!adds a value, ignoring NAN
+    void add (double x);
+    //!adds all the values of another sketch with the same accuracy
+    void merge (const QuantileSketch &o);
+    //!estimates a quantile
+    /*!
+    \param[in] q quantile, between zero and one
+    \return estimate of the value at rank `q*(n - 1)`, within the range of the values, or NAN without values
+    */
+    double quantile (double q) const;
+
+    //!number of values
+    int64_t get_n () const { return(n_); }
+    //!number of buckets in use
+    long get_nbucket () const { return((long)(pos_.size() + neg_.size())); }
+
+private:
+
+    //accuracy and bucket base
+    double alpha_, lg_;
+    //bucket counts of positive and negative magnitudes, and the zero count
+    std::map<int,int64_t> pos_, neg_;
+    int64_t nzero_, n_;
+    //range of the values, which bounds the estimates
+    double lo_, hi_;
+    //bucket of a magnitude and the representative magnitude of a bucket
+    int bucket (double x) const { return( (int)ceil(log(x)/lg_) ); }
+    double value (int i) const { return( 2*exp(i*lg_)/(exp(lg_) + 1) ); }
+    //quantile from the buckets alone
+    double estimate (double q) const;
+};
+
+//!Wilson score interval of a binomial proportion
+/*!
+\param[in] k number of successes
+\param[in] n number of trials
+\param[in] z standard normal quantile of the interval, like 1.96 for 95 %
+\param[out] lo lower bound
+\param[out] hi upper bound
+*/
+void wilson_interval (int64_t k, int64_t n, double z, double *lo, double *hi);
+
+//!standard normal quantile of a two sided interval
+/*!
+\param[in] conf confidence level, between zero and one
+\return `z` such that a standard normal value is within `[-z, z]` with probability `conf`
+*/
+double normal_quantile (double conf);
+
+#endif
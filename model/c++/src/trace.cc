@@ -0,0 +1,80 @@
+//! \file trace.cc
+
+#include "trace.h"
+
+#ifdef MSC_TRACE
+
+long Trace::every_ = -1;
+std::chrono::steady_clock::time_point Trace::t0_ = std::chrono::steady_clock::now();
+std::vector<Trace::Local*> Trace::threads_;
+std::mutex Trace::mtx_;
+
+void Trace::init (long every) {
+    every_ = every;
+    t0_ = std::chrono::steady_clock::now();
+}
+
+Trace::Local *Trace::add_thread () {
+    Local *l = new Local;
+    l->ring = new TraceEvent[TRACE_RING];
+    l->n = 0;
+    l->active = false;
+    l->trial = -1;
+    l->ttrial = 0;
+    l->tlast = -1;
+    l->tstep = -1;
+    l->nrej = 0;
+    std::lock_guard<std::mutex> lock(mtx_);
+    l->tid = threads_.size();
+    threads_.push_back(l);
+    return(l);
+}
+
+void Trace::idle () {
+    int64_t t = now();
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (unsigned long i=0; i<threads_.size(); i++) {
+        Local &l = *threads_[i];
+        if ( l.tlast < 0 ) continue;
+        TraceEvent e = event(l, "idle", NULL, l.tlast, t - l.tlast, 0);
+        e.trial = -1;
+        l.spans.push_back(e);
+        l.tlast = t;
+    }
+}
+
+void Trace::write_event (FILE *ofile, int tid, const TraceEvent &e) {
+    fprintf(ofile, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"trial\":%ld",
+        e.name, tid, e.ts/1e3, e.dur/1e3, e.trial);
+    if ( e.argname ) fprintf(ofile, ",\"%s\":%.10g", e.argname, e.arg);
+    fprintf(ofile, "}}");
+}
+
+void Trace::write (const char *fn) {
+
+    check_file_write(fn);
+    FILE *ofile = fopen(fn, "w");
+    fprintf(ofile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::lock_guard<std::mutex> lock(mtx_);
+    bool first = true;
+    uint64_t nlost = 0;
+    for (unsigned long i=0; i<threads_.size(); i++) {
+        const Local &l = *threads_[i];
+        fprintf(ofile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+            first ? "" : ",\n", l.tid, l.tid);
+        first = false;
+        //every trial and idle span
+        for (unsigned long k=0; k<l.spans.size(); k++) write_event(ofile, l.tid, l.spans[k]);
+        //the zones, of which the oldest have been overwritten if the ring wrapped around
+        uint64_t k0 = (l.n > TRACE_RING) ? l.n - TRACE_RING : 0;
+        nlost += k0;
+        for (uint64_t k=k0; k<l.n; k++) write_event(ofile, l.tid, l.ring[k & (TRACE_RING - 1)]);
+    }
+    fprintf(ofile, "\n]}\n");
+    fclose(ofile);
+    if ( nlost > 0 )
+        printf("%lu of the oldest zone events were overwritten, sample fewer trials to keep them\n",
+            (unsigned long)nlost);
+}
+
+#endif
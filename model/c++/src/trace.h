@@ -0,0 +1,221 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+//! \file trace.h
+
+//!whether scoped tracing is compiled in, by adding `-DMSC_TRACE` to the flags in `config.mk`
+#ifdef MSC_TRACE
+#define TRACE_ENABLED 1
+#else
+#define TRACE_ENABLED 0
+#endif
+
+#ifdef MSC_TRACE
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "util.h"
+
+//!number of zone events kept by each thread, a power of two, after which the oldest are overwritten
+#define TRACE_RING 65536
+
+//!one traced span of wall time
+struct TraceEvent {
+    //!name of the zone, a string literal
+    const char *name;
+    //!name of the value, a string literal, or NULL if there isn't one
+    const char *argname;
+    //!start and duration [ns since Trace::init]
+    int64_t ts, dur;
+    //!trial being worked on, or -1
+    long trial;
+    //!value attached to the event
+    double arg;
+};
+
+//!scoped tracing of the hot paths into per-thread buffers, exported as Chrome trace events
+/*!
+Tracing is compiled in only when `MSC_TRACE` is defined. Otherwise the TRACE_ macros expand to nothing, so the traced code is exactly the untraced code, and nothing from this file is used.
+
+Every thread records into its own buffers, allocated on the thread's first event, without locks or atomics, and nothing is read until write, after the traced threads have finished. The spans of trials, recorded by TRACE_TRIAL_BEGIN and TRACE_TRIAL_END, and the idle time at the end of a parallel loop go into a growable list that is never overwritten, so the load balance of a sweep can be seen for all trials, at 48 bytes per trial. The zones inside a trial (integration, steps, checks, Newton iterations, and LU solves) are only recorded for trials sampled by Trace::init, since a long trial has many thousands of steps, and they go into a ring of TRACE_RING events, whose oldest events are overwritten and counted by write.
+
+The output of write is a Chrome trace-event JSON file, which can be opened in `chrome://tracing` or [Perfetto](https://ui.perfetto.dev) to see every thread's trials and zones on a time line. Each event has the trial index and its value in its arguments.
+*/
+class Trace {
+
+public:
+
+    //!starts tracing
+    /*!
+    \param[in] every trials with indices divisible by this number have all their zones recorded, and zero records only trial spans
+    */
+    static void init (long every);
+
+    //!whether init has been called, without which nothing is recorded
+    static bool on () { return(every_ >= 0); }
+
+    //!starts a trial on the calling thread, deciding whether its zones are recorded
+    static void trial_begin (long trial) {
+        if ( !on() ) return;
+        Local &l = local();
+        l.trial = trial;
+        l.active = (every_ > 0) && (trial % every_ == 0);
+        l.ttrial = now();
+    }
+    //!ends the trial on the calling thread, recording its span
+    static void trial_end () {
+        if ( !on() ) return;
+        Local &l = local();
+        int64_t t = now();
+        l.spans.push_back(event(l, "trial", "sampled", l.ttrial, t - l.ttrial, l.active));
+        l.tlast = t;
+        l.active = false;
+        l.trial = -1;
+    }
+    //!whether zones are being recorded on the calling thread
+    static bool active () { return( on() && local().active ); }
+    //!wall time since init [ns]
+    static int64_t now () {
+        return( std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0_).count() );
+    }
+
+    //!records a span that started at a given time and ends now
+    static void span (const char *name, int64_t ts, const char *argname=NULL, double arg=0) {
+        Local &l = local();
+        if ( l.active ) push(l, name, argname, ts, now() - ts, arg);
+    }
+    //!records an integration step, spanning the time since the previous step and counting the rejected attempts in between
+    /*!
+    \param[in] nrej total number of rejected steps of the integrator so far
+    */
+    static void step (unsigned long nrej) {
+        if ( !active() ) return;
+        Local &l = local();
+        int64_t t = now();
+        if ( l.tstep >= 0 ) push(l, "step", "rejected", l.tstep, t - l.tstep, double(nrej - l.nrej));
+        l.tstep = t;
+        l.nrej = nrej;
+    }
+    //!restarts the step spans, at the start of an integration
+    static void step_reset (unsigned long nrej) {
+        if ( !on() ) return;
+        Local &l = local();
+        l.tstep = now();
+        l.nrej = nrej;
+    }
+
+    //!records the time every thread spent waiting between its last trial and now, as at the end of a parallel loop
+    static void idle ();
+
+    //!writes every recorded event to a Chrome trace-event JSON file
+    static void write (const char *fn);
+
+private:
+
+    //buffers and state of one thread
+    struct Local {
+        std::vector<TraceEvent> spans;
+        TraceEvent *ring;
+        uint64_t n;
+        int tid;
+        bool active;
+        long trial;
+        int64_t ttrial, tlast, tstep;
+        unsigned long nrej;
+    };
+    //sampling interval, which is negative before init, and start
+    static long every_;
+    static std::chrono::steady_clock::time_point t0_;
+    //every thread's state, only locked when a thread records its first event and when writing
+    static std::vector<Local*> threads_;
+    static std::mutex mtx_;
+    //the calling thread's state, registered on first use
+    static Local &local () {
+        static thread_local Local *l = NULL;
+        if ( !l ) l = add_thread();
+        return(*l);
+    }
+    static Local *add_thread ();
+    //makes an event of a thread's current trial
+    static TraceEvent event (const Local &l, const char *name, const char *argname,
+                             int64_t ts, int64_t dur, double arg) {
+        TraceEvent e;
+        e.name = name;
+        e.argname = argname;
+        e.ts = ts;
+        e.dur = dur;
+        e.trial = l.trial;
+        e.arg = arg;
+        return(e);
+    }
+    //adds a zone event to a thread's ring
+    static void push (Local &l, const char *name, const char *argname,
+                      int64_t ts, int64_t dur, double arg) {
+        l.ring[l.n & (TRACE_RING - 1)] = event(l, name, argname, ts, dur, arg);
+        l.n++;
+    }
+    //writes one event of a thread
+    static void write_event (FILE *ofile, int tid, const TraceEvent &e);
+};
+
+//!records the rest of the enclosing scope as a zone, if the thread is recording
+class TraceZone {
+
+public:
+
+    //!starts the zone
+    TraceZone (const char *name, const char *argname=NULL, double arg=0) :
+        name_ (name), argname_ (argname), arg_ (arg),
+        ts_ (Trace::active() ? Trace::now() : -1) {}
+    //!ends the zone
+    ~TraceZone () { if ( ts_ >= 0 ) Trace::span(name_, ts_, argname_, arg_); }
+
+private:
+
+    const char *name_, *argname_;
+    double arg_;
+    int64_t ts_;
+};
+
+#define TRACE_CAT_(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT_(a, b)
+//!records the rest of the enclosing scope as a zone with a name
+#define TRACE_ZONE(name) TraceZone TRACE_CAT(trace_zone_, __LINE__)(name)
+//!records the rest of the enclosing scope as a zone with a name and a named value
+#define TRACE_ZONE_ARG(name, argname, arg) TraceZone TRACE_CAT(trace_zone_, __LINE__)(name, argname, arg)
+//!records an integration step (see Trace::step)
+#define TRACE_STEP(nrej) Trace::step(nrej)
+//!restarts the step spans (see Trace::step_reset)
+#define TRACE_STEP_RESET(nrej) Trace::step_reset(nrej)
+//!starts a trial (see Trace::trial_begin)
+#define TRACE_TRIAL_BEGIN(trial) Trace::trial_begin(trial)
+//!ends a trial (see Trace::trial_end)
+#define TRACE_TRIAL_END() Trace::trial_end()
+//!starts tracing (see Trace::init)
+#define TRACE_INIT(every) Trace::init(every)
+//!records the idle time of every thread (see Trace::idle)
+#define TRACE_IDLE() Trace::idle()
+//!writes the trace (see Trace::write)
+#define TRACE_WRITE(fn) Trace::write(fn)
+
+#else
+
+#define TRACE_ZONE(name)
+#define TRACE_ZONE_ARG(name, argname, arg)
+#define TRACE_STEP(nrej)
+#define TRACE_STEP_RESET(nrej)
+#define TRACE_TRIAL_BEGIN(trial)
+#define TRACE_TRIAL_END()
+#define TRACE_INIT(every)
+#define TRACE_IDLE()
+#define TRACE_WRITE(fn)
+
+#endif
+
+#endif
@@ -0,0 +1,98 @@
+//! \file trials.cc
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trials.h"
+
+//size of the fixed part of the header [bytes]
+#define TRIAL_HEADER 32
+//size of a column name [bytes]
+#define TRIAL_NAME 16
+//version of the binary layout
+#define TRIAL_FORMAT 1
+
+TrialList::TrialList (const char *fn) :
+    ncol_ (0),
+    nrow_ (0),
+    row_ (NULL),
+    map_ (NULL),
+    mapsize_ (0) {
+
+    int fd = open(fn, O_RDONLY);
+    struct stat st;
+    if ( (fd < 0) || (fstat(fd, &st) != 0) ) {
+        printf("FAILURE: cannot open file %s\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    if ( st.st_size < TRIAL_HEADER ) {
+        printf("FAILURE: %s is not a trial list\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    mapsize_ = st.st_size;
+    map_ = mmap(NULL, mapsize_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if ( map_ == MAP_FAILED ) {
+        printf("FAILURE: cannot map trial list %s\n", fn);
+        exit(EXIT_FAILURE);
+    }
+
+    //header
+    const char *p = (const char*)map_;
+    uint32_t version, ncol;
+    uint64_t nrow;
+    memcpy(&version, p + 8, 4);
+    memcpy(&ncol, p + 12, 4);
+    memcpy(&nrow, p + 16, 8);
+    if ( (memcmp(p, "MSCTRIAL", 8) != 0) || (version != TRIAL_FORMAT) ) {
+        printf("FAILURE: %s is not a trial list or has an incompatible format\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    if ( (ncol < 1) || (ncol > NPARAM + 2)
+      || (mapsize_ != TRIAL_HEADER + TRIAL_NAME*ncol + 8*ncol*nrow) ) {
+        printf("FAILURE: trial list %s is corrupt\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    ncol_ = ncol;
+    nrow_ = nrow;
+
+    //columns
+    for (int j=0; j<ncol_; j++) {
+        name_[j] = p + TRIAL_HEADER + TRIAL_NAME*j;
+        if ( memchr(name_[j], 0, TRIAL_NAME) == NULL ) {
+            printf("FAILURE: column %d of trial list %s has no terminating zero byte\n", j, fn);
+            exit(EXIT_FAILURE);
+        }
+        if ( strcmp(name_[j], "zs0") == 0 ) col_[j] = TRIAL_ZS0;
+        else if ( strcmp(name_[j], "zm0") == 0 ) col_[j] = TRIAL_ZM0;
+        else col_[j] = param_index(name_[j]);
+        if ( col_[j] < 0 ) {
+            printf("FAILURE: column '%s' of trial list %s is not a model parameter, zs0, or zm0\n", name_[j], fn);
+            exit(EXIT_FAILURE);
+        }
+        for (int k=0; k<j; k++) {
+            if ( col_[k] == col_[j] ) {
+                printf("FAILURE: column '%s' appears twice in trial list %s\n", name_[j], fn);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    //the rows are used in place, but checked first
+    row_ = (const double*)(p + TRIAL_HEADER + TRIAL_NAME*ncol_);
+    for (long i=0; i<nrow_; i++) {
+        for (int j=0; j<ncol_; j++) {
+            if ( !std::isfinite(row_[ncol_*i + j]) ) {
+                printf("FAILURE: trial %ld of trial list %s has a value of '%s' that isn't finite\n", i, fn, name_[j]);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+}
+
+TrialList::~TrialList () {
+    if ( map_ ) munmap(map_, mapsize_);
+}
@@ -0,0 +1,81 @@
+#ifndef TRIALS_H_
+#define TRIALS_H_
+
+//! \file trials.h
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#include "util.h"
+#include "msc_gcv.h"
+
+//!column index, returned by TrialList::get_column, of the initial sill level
+#define TRIAL_ZS0 NPARAM
+//!column index, returned by TrialList::get_column, of the initial Mediterranean level
+#define TRIAL_ZM0 (NPARAM + 1)
+
+//!memory mapped list of trials, each a set of parameters and optionally an initial condition
+/*!
+A trial list lets `sweep.exe` classify any selection of parameter sets, like the undetermined trials of an earlier sweep or a design made in Python by `scripts/write_trials.py`, instead of its own grid. The file is, in native byte order,
++ a 32 byte header: the characters "MSCTRIAL", a uint32 format version, a uint32 column count, a uint64 row count, and 8 zero bytes
++ the name of every column in 16 bytes, padded with zero bytes, which is one of param_names or `zs0` or `zm0` for the initial sill and Mediterranean levels, each at most once
++ the trials as float64 rows of all the columns, with parameters in the units of MscGcv::set_param and levels in meters
+
+Parameters without a column keep the values of the model object and the initial condition without a column keeps the default of the sweep. The file is memory mapped read-only and the rows are used in place, so a list of any length costs nothing to load beyond the check of its values.
+*/
+class TrialList {
+
+public:
+
+    //!maps and checks a trial list
+    /*!
+    \param[in] fn path to the file
+    */
+    TrialList (const char *fn);
+    //!destructs, unmapping the file
+    ~TrialList ();
+
+    //!number of trials
+    long get_nrow () const { return(nrow_); }
+    //!number of columns
+    int get_ncol () const { return(ncol_); }
+    //!name of a column
+    const char *get_name (int j) const { return(name_[j]); }
+    //!index of a column's parameter in param_names, or TRIAL_ZS0 or TRIAL_ZM0 for the initial condition
+    int get_column (int j) const { return(col_[j]); }
+    //!values of a trial's columns
+    const double *get_row (long i) const { return(row_ + ncol_*i); }
+
+    //!sets the parameters and initial condition of a trial
+    /*!
+    \param[in] i index of the trial
+    \param[out] sys model object getting the parameters with columns
+    \param[in,out] zs0 initial sill level, changed only if it has a column
+    \param[in,out] zm0 initial Mediterranean level, changed only if it has a column
+    */
+    void set (long i, MscGcv *sys, double *zs0, double *zm0) const {
+        const double *r = get_row(i);
+        for (int j=0; j<ncol_; j++) {
+            if ( col_[j] == TRIAL_ZS0 ) *zs0 = r[j];
+            else if ( col_[j] == TRIAL_ZM0 ) *zm0 = r[j];
+            else sys->set_param(col_[j], r[j]);
+        }
+    }
+
+private:
+
+    //columns, with names pointing into the map
+    int ncol_;
+    long nrow_;
+    const char *name_[NPARAM+2];
+    int col_[NPARAM+2];
+    //rows, in the map
+    const double *row_;
+    //memory map
+    void *map_;
+    size_t mapsize_;
+};
+
+#endif
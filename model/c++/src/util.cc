@@ -96,3 +96,40 @@ void write_int (const char *fn, int *a, long size) {
     fwrite(a, sizeof(int), size, ofile);
     fclose(ofile);
 }
+
+void read_csv (const char *fn,
+               std::vector<std::string> &cols,
+               std::vector< std::vector<double> > &rows) {
+
+    std::ifstream ifile(fn);
+    std::string line, entry;
+    char *end;
+    if ( !ifile.is_open() ) {
+        std::cout << "FAILURE: cannot open file " << fn << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    //header line
+    cols.clear();
+    rows.clear();
+    if ( std::getline(ifile, line) ) {
+        std::stringstream ss(line);
+        while ( std::getline(ss, entry, ',') )
+            cols.push_back(entry.substr(0, entry.find_last_not_of(" \r") + 1));
+    }
+    //rows of numbers
+    while ( std::getline(ifile, line) ) {
+        if ( line.find_first_not_of(" \r") == std::string::npos ) continue;
+        std::stringstream ss(line);
+        std::vector<double> row;
+        while ( std::getline(ss, entry, ',') ) {
+            double x = strtod(entry.c_str(), &end);
+            row.push_back( (end == entry.c_str()) ? NAN : x );
+        }
+        if ( row.size() != cols.size() ) {
+            std::cout << "FAILURE: row " << rows.size() + 1 << " of " << fn
+                      << " has the wrong number of entries" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        rows.push_back(row);
+    }
+}
@@ -8,6 +8,8 @@
 #include <vector>
 #include <cstdio>
 #include <iostream>
+#include <fstream>
+#include <sstream>
 
 //!max of two numbers
 double max (double a, double b);
@@ -35,4 +37,15 @@ void write_double (const std::string &fn, std::vector<double> a);
 //!writes an int array to a binary file
 void write_int (const char *fn, int *a, long size);
 
+//!reads a comma separated table of numbers with a single header line
+/*!
+Entries that can't be read as numbers are stored as NAN.
+\param[in] fn path to file
+\param[out] cols column names from the header line
+\param[out] rows table values, one vector per row
+*/
+void read_csv (const char *fn,
+               std::vector<std::string> &cols,
+               std::vector< std::vector<double> > &rows);
+
 #endif
@@ -0,0 +1,62 @@
+//! \file variants.cc
+
+#include <string>
+
+#include "msc_gcv_kernel.h"
+#include "variants.h"
+
+template<class Policy> void MscGcvPolicy<Policy>::check_policy () {
+    if ( Policy::Erosion::fixed && (a != Policy::Erosion::exponent) ) {
+        printf("FAILURE: the erosion law '%s' requires a = %g, not %g\n",
+            Policy::Erosion::name, Policy::Erosion::exponent, a);
+        exit(EXIT_FAILURE);
+    }
+    if ( (Policy::Hyps::table != 2) && ((get_hypsometry() != NULL) != (Policy::Hyps::table == 1)) ) {
+        printf("FAILURE: a model built for the %s hypsometry has %s\n", Policy::Hyps::name,
+            get_hypsometry() ? "a tabulated hypsometry" : "no tabulated hypsometry");
+        exit(EXIT_FAILURE);
+    }
+}
+
+//makes a model with the policies chosen so far, given the name of the remaining one
+template<class E, class W> static MscGcv *new_hyps (const Hypsometry *hyps, bool clock) {
+    MscGcv *sys;
+    if ( hyps ) sys = new MscGcvPolicy< MscPolicy<E,W,HypsTable> >(clock);
+    else sys = new MscGcvPolicy< MscPolicy<E,W,HypsFit> >(clock);
+    sys->set_hypsometry(hyps);
+    return(sys);
+}
+
+template<class E> static MscGcv *new_width (const char *width, const Hypsometry *hyps, bool clock) {
+    if ( std::string(width) == WidthTurowski::name ) return( new_hyps<E,WidthTurowski>(hyps, clock) );
+    if ( std::string(width) == WidthConstant::name ) return( new_hyps<E,WidthConstant>(hyps, clock) );
+    printf("FAILURE: unknown channel width law '%s', must be %s or %s\n", width,
+        WidthTurowski::name, WidthConstant::name);
+    exit(EXIT_FAILURE);
+}
+
+MscGcv *new_model (const char *erosion, const char *width, const Hypsometry *hyps, bool clock) {
+
+    std::string e = erosion;
+    //the default laws keep the plain model, with its branch on the hypsometry
+    if ( (e == ErosionPower::name) && (std::string(width) == WidthTurowski::name) ) {
+        MscGcv *sys = new MscGcv(clock);
+        sys->set_hypsometry(hyps);
+        return(sys);
+    }
+    if ( e == ErosionPower::name ) return( new_width<ErosionPower>(width, hyps, clock) );
+    if ( e == ErosionLinear::name ) return( new_width<ErosionLinear>(width, hyps, clock) );
+    if ( e == ErosionThreeHalves::name ) return( new_width<ErosionThreeHalves>(width, hyps, clock) );
+    if ( e == ErosionSquare::name ) return( new_width<ErosionSquare>(width, hyps, clock) );
+    printf("FAILURE: unknown erosion law '%s', must be %s, %s, %s, or %s\n", erosion,
+        ErosionPower::name, ErosionLinear::name, ErosionThreeHalves::name, ErosionSquare::name);
+    exit(EXIT_FAILURE);
+}
+
+double erosion_exponent (const char *erosion) {
+    std::string e = erosion;
+    if ( e == ErosionLinear::name ) return( ErosionLinear::exponent );
+    if ( e == ErosionThreeHalves::name ) return( ErosionThreeHalves::exponent );
+    if ( e == ErosionSquare::name ) return( ErosionSquare::exponent );
+    return(NAN);
+}
@@ -0,0 +1,57 @@
+#ifndef VARIANTS_H_
+#define VARIANTS_H_
+
+//! \file variants.h
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "util.h"
+#include "policy.h"
+#include "msc_gcv.h"
+
+//!model with its erosion, channel width, and hypsometry laws chosen at compile time
+/*!
+Every function of the right-hand side is overridden with the MscGcv kernel for the policies in `Policy` (see `policy.h` and `msc_gcv_kernel.h`), so the laws are inlined and no branch on them is left in the integration loop. A fixed erosion exponent is applied exactly, like `e*sqrt(e)` for 1.5, which avoids the general power function, and a fixed hypsometry removes the check of whether a table is set. Everything else, including the classification, is inherited. The objects are made by new_model, which is instantiated for every combination of the erosion and width laws with a fixed hypsometry.
+*/
+template<class Policy> class MscGcvPolicy : public MscGcv {
+
+public:
+
+    //!constructs, with the clock of the forcing if `clock`
+    MscGcvPolicy (bool clock=false) : MscGcv (clock) {}
+
+    void ode_fun (double *solin, double *fout) { ode_fun_kernel<Policy>(solin, fout); }
+    void ode_partials (const double *solin, double dfdx[2][2], double dfdp[2][NSENS]) {
+        partials_kernel<Policy>(solin, dfdx, dfdp);
+    }
+    void ode_fun_row (double zm, const double *zs, long nzs, double *dzs, double *dzm) {
+        row_kernel<Policy>(zm, zs, nzs, dzs, dzm);
+    }
+    int get_policy () { return(Policy::id); }
+    void check_policy ();
+
+protected:
+
+    void rhs (const double *solin, double *fout) { rhs_kernel<Policy>(solin, fout); }
+    void rhs (const float *solin, float *fout) { rhs_kernel<Policy>(solin, fout); }
+    double fixed_residual (double zm, double *zs) { return( residual_kernel<Policy>(zm, zs) ); }
+    void f_Newton (double *x, double *f) { newton_kernel<Policy>(x, f); }
+};
+
+//!makes a model object with the named erosion and channel width laws
+/*!
+The names are those of the policies in `policy.h`: "pow", "1", "1.5", or "2" for the erosion law and "turowski" or "constant" for the channel width. The default laws with either hypsometry give a plain MscGcv. With a fixed erosion exponent, the model's `a` must be set to that exponent before classifying, which is checked by MscGcv::check_policy. Unknown names stop the program.
+\param[in] erosion name of the erosion law
+\param[in] width name of the channel width law
+\param[in] hyps tabulated hypsometry, or NULL for the two exponential fit, which is set in the new object and may not be changed
+\param[in] clock whether the model integrates the clock needed by a forcing
+\return new model object, to be deleted by the caller
+*/
+MscGcv *new_model (const char *erosion, const char *width, const Hypsometry *hyps, bool clock=false);
+
+//!exponent of a named erosion law, or NAN for the general power law
+double erosion_exponent (const char *erosion);
+
+#endif